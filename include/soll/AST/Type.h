@@ -57,12 +57,29 @@ public:
   virtual bool isDynamic() const = 0;
   virtual bool shouldEndianLess() const = 0;
   virtual unsigned getABIStaticSize() const = 0;
+  /// Bytes occupied in contract storage. Value types smaller than a slot
+  /// report their packed size, everything else a multiple of 32.
   virtual unsigned getStorageSize() const { return 32; }
   virtual bool isEqual(Type const &Ty) const {
     return Ty.getCategory() == getCategory();
   }
 };
 
+/// Assigns storage locations following solc's layout rules. Value types are
+/// packed into the low-order bytes of a slot while they fit; structs,
+/// arrays and values that fill a slot always start and end on a slot
+/// boundary.
+class StorageAllocator {
+  std::size_t Slot = 0;
+  unsigned Offset = 0;
+
+public:
+  /// Returns the slot and the byte offset within it of the next \p Ty.
+  std::pair<std::size_t, unsigned> allocate(const Type &Ty);
+  /// Number of slots used so far.
+  std::size_t getSlotCount() const { return Slot + (Offset != 0); }
+};
+
 class AddressType : public Type {
   StateMutability SM;
 
@@ -75,6 +92,7 @@ public:
   bool isDynamic() const override { return false; }
   bool shouldEndianLess() const override { return true; }
   unsigned getABIStaticSize() const override { return 32; }
+  unsigned getStorageSize() const override { return 20; }
 };
 
 class BooleanType : public Type {
@@ -84,6 +102,7 @@ public:
   bool isDynamic() const override { return false; }
   bool shouldEndianLess() const override { return true; }
   unsigned getABIStaticSize() const override { return 32; }
+  unsigned getStorageSize() const override { return 1; }
   unsigned int getBitNum() const override { return 1; }
 };
 
@@ -189,6 +208,7 @@ public:
   bool isDynamic() const override { return false; }
   bool shouldEndianLess() const override { return true; }
   unsigned getABIStaticSize() const override { return 32; }
+  unsigned getStorageSize() const override { return getBitNum() / 8; }
   bool isEqual(Type const &Ty) const override {
     return Type::isEqual(Ty) &&
            static_cast<IntegerType const &>(Ty).getKind() == getKind();
@@ -249,6 +269,7 @@ public:
   bool isDynamic() const override { return false; }
   bool shouldEndianLess() const override { return false; }
   unsigned getABIStaticSize() const override { return 32; }
+  unsigned getStorageSize() const override { return getBitNum() / 8; }
   bool isEqual(Type const &Ty) const override {
     return Type::isEqual(Ty) &&
            static_cast<FixedBytesType const &>(Ty).getKind() == getKind();
@@ -363,9 +384,12 @@ public:
     if (isDynamicSized()) {
       return 32;
     } else {
-      unsigned BitPerElement = getElementType()->getBitNum();
-      unsigned ElementPerSlot = 256 / BitPerElement;
-      unsigned Length = getLength().getLimitedValue();
+      const unsigned ElementSize = getElementType()->getStorageSize();
+      const unsigned Length = getLength().getLimitedValue();
+      if (ElementSize >= 32) {
+        return Length * ElementSize;
+      }
+      const unsigned ElementPerSlot = 32 / ElementSize;
       return (Length / ElementPerSlot + (Length % ElementPerSlot != 0)) * 32;
     }
   }
@@ -493,14 +517,26 @@ public:
     return Size;
   }
   unsigned getStorageSize() const override {
-    return getStoragePos(getElementSize());
+    StorageAllocator Allocator;
+    for (const auto &ETy : ElementTypes) {
+      Allocator.allocate(*ETy);
+    }
+    return Allocator.getSlotCount() * 32;
   }
+  /// Slot of an element relative to the first slot of the tuple.
   size_t getStoragePos(size_t ElementIndex) const {
-    size_t Pos = 0;
+    return getStorageLocation(ElementIndex).first;
+  }
+  /// Byte offset of an element within its slot.
+  unsigned getStorageOffset(size_t ElementIndex) const {
+    return getStorageLocation(ElementIndex).second;
+  }
+  std::pair<size_t, unsigned> getStorageLocation(size_t ElementIndex) const {
+    StorageAllocator Allocator;
     for (size_t I = 0; I < ElementIndex; ++I) {
-      Pos += ElementTypes[I]->getStorageSize() / 32;
+      Allocator.allocate(*ElementTypes[I]);
     }
-    return Pos;
+    return Allocator.allocate(*ElementTypes[ElementIndex]);
   }
   size_t getElementSize() const { return ElementTypes.size(); }
   bool isEqual(Type const &Ty) const override {
@@ -590,6 +626,7 @@ public:
   const ContractDecl *getDecl() const { return D; }
   Category getCategory() const override { return Category::Contract; }
   unsigned int getBitNum() const override { return 160; }
+  unsigned getStorageSize() const override { return 20; }
   std::string getName() const override { return "contract"; }
   std::string getSignatureEncoding() const override { return "address"; }
   std::string getUniqueName() const override;
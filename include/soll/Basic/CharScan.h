@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+
+namespace soll {
+
+/// Scanners for the lexer's hot loops. Each looks for the first character in
+/// [Ptr, End) that ends a run of one character class, 16 or 32 bytes at a
+/// time where the host supports it, and returns End if there is none. They
+/// never read at or past End, and agree with the predicates of CharInfo.h.
+
+/// First character that is not isIdentifierBody.
+const char *skipIdentifierBody(const char *Ptr, const char *End);
+
+/// First character that is not isWhitespace.
+const char *skipWhitespace(const char *Ptr, const char *End);
+
+/// First '\\n', '\\r' or '\\0'.
+const char *findLineEnd(const char *Ptr, const char *End);
+
+/// First '/'.
+const char *findSlash(const char *Ptr, const char *End);
+
+/// Name of the implementation picked for this host: "avx2", "sse2" or
+/// "scalar".
+const char *getCharScanKind();
+
+} // namespace soll
@@ -1,9 +1,13 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 #pragma once
 
+#include <string>
+
 namespace soll {
 
 enum OptLevel { O0, O1, O2, O3, Os, Oz };
+enum class KeccakKind { Inline, Precompile, Auto };
+enum class DispatchKind { Switch, PHF, Linear, Auto };
 
 class CodeGenOptions {
 public:
@@ -11,6 +15,22 @@ public:
   OptLevel OptimizationLevel;
   /// Generate for runtime only.
   bool Runtime;
+  /// Number of inputs, and of contract entries within an input, to compile
+  /// in parallel, 0 for all cores.
+  unsigned NumThreads = 1;
+  /// Report per-pass wall time and IR instruction counts.
+  bool TimePasses = false;
+  /// How keccak256 is computed on Ewasm.
+  KeccakKind Keccak = KeccakKind::Precompile;
+  /// How the dispatcher finds the function for a selector.
+  DispatchKind Dispatch = DispatchKind::Auto;
+  /// Multipliers to try per table size before a perfect hash dispatcher
+  /// falls back to a switch.
+  unsigned DispatchPHFTries = 1u << 16;
+  /// Record function entries and dispatched selectors through debug.print32.
+  bool ProfileGenerate = false;
+  /// Call trace recorded by a -fprofile-generate build to optimize for.
+  std::string ProfileUse;
 };
 
 } // namespace soll
@@ -147,6 +147,10 @@ public:
   DiagnosticConsumer *getClient() { return Client; }
   const DiagnosticConsumer *getClient() const { return Client; }
 
+  /// Return the current diagnostic client along with ownership of that
+  /// client, or null if the engine does not own it.
+  std::unique_ptr<DiagnosticConsumer> takeClient() { return std::move(Owner); }
+
   bool hasSourceManager() const { return SourceMgr != nullptr; }
   SourceManager &getSourceManager() const {
     assert(SourceMgr && "SourceManager not set!");
@@ -3,6 +3,7 @@
 #include "soll/Basic/FileSystemOptions.h"
 #include <llvm/ADT/IntrusiveRefCntPtr.h>
 #include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
 #include <map>
 #include <memory>
 #include <string>
@@ -99,6 +100,8 @@ public:
   getBufferForFile(llvm::StringRef Filename, bool isVolatile = false);
 
   bool FixupRelativePath(llvm::SmallVectorImpl<char> &path) const;
+
+  void PrintStats(llvm::raw_ostream &OS) const;
 };
 
 } // namespace soll
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+
+namespace soll {
+
+/// Reduce the bookkeeping behind msize on Ewasm. Every Yul memory access
+/// calls solidity.updateMemorySize to grow the memory.size global. When no
+/// code reads memory.size the calls are dropped. Otherwise calls on the same
+/// base with constant offsets are merged into one that covers the largest
+/// end, and loops that cannot observe memory.size keep the largest end in a
+/// local and update the global once on exit.
+class CoalesceMemorySize : public llvm::PassInfoMixin<CoalesceMemorySize> {
+public:
+  llvm::PreservedAnalyses run(llvm::Module &M,
+                              llvm::ModuleAnalysisManager &MAM);
+};
+
+} // namespace soll
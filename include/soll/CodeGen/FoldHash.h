@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/PassManager.h>
+
+namespace soll {
+
+/// Evaluate keccak256 and sha256 helper calls whose input bytes are known at
+/// compile time, such as event signatures, role constants and the storage
+/// slots of mapping entries with constant keys, so that no host call is made
+/// for them.
+class FoldHash : public llvm::PassInfoMixin<FoldHash> {
+public:
+  llvm::PreservedAnalyses run(llvm::Function &F,
+                              llvm::FunctionAnalysisManager &FAM);
+};
+
+} // namespace soll
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+
+namespace soll {
+
+/// Lower the storage slot hash markers once optimization is done. Slot
+/// hashes are emitted on Ewasm as calls to solidity.slothash1 and
+/// solidity.slothash2, readnone declarations that let LLVM common up and
+/// hoist them. Their real bodies, which write memory and call the host,
+/// are kept alive as solidity.slothash1.body and solidity.slothash2.body
+/// through llvm.compiler.used. This pass points the calls at the bodies and
+/// drops the markers, and the bodies that end up unused.
+class LowerSlotHash : public llvm::PassInfoMixin<LowerSlotHash> {
+public:
+  llvm::PreservedAnalyses run(llvm::Module &M,
+                              llvm::ModuleAnalysisManager &MAM);
+};
+
+} // namespace soll
@@ -17,6 +17,14 @@ class LoweringInteger : public llvm::PassInfoMixin<LoweringInteger> {
 
   llvm::DenseMap<unsigned int, llvm::Function *> MulFunction;
   llvm::Function *GetMulFunction(const unsigned int BitWidth);
+  /// 256-bit multiply on 64-bit limbs.
+  llvm::Function *CreateMul256Function();
+
+  /// 256-bit quotient and remainder with Knuth's algorithm D.
+  llvm::Function *UDivRem256Function = nullptr;
+  llvm::Function *GetUDivRem256Function();
+  llvm::Function *CreateUDivRem256Wrapper(llvm::StringRef Name,
+                                          bool Remainder);
 
   llvm::DenseMap<unsigned int, llvm::Function *> UDivFunction;
   llvm::Function *GetUDivFunction(const unsigned int BitWidth);
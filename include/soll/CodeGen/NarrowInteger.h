@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/PassManager.h>
+
+namespace soll {
+
+/// Shrink wide multiply, divide and remainder instructions before they are
+/// handed to LoweringInteger. Operations whose operands are known to fit in
+/// 64 or 128 bits are rewritten at that width. When \p Versioning is enabled,
+/// the remaining ones inside loops get a runtime check that dispatches to a
+/// 64-bit fast path when the high limbs of both operands are zero.
+class NarrowInteger : public llvm::PassInfoMixin<NarrowInteger> {
+  bool Versioning;
+
+public:
+  explicit NarrowInteger(bool Versioning = false) : Versioning(Versioning) {}
+
+  llvm::PreservedAnalyses run(llvm::Function &F,
+                              llvm::FunctionAnalysisManager &FAM);
+};
+
+} // namespace soll
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/PassManager.h>
+
+namespace soll {
+
+/// Peephole for the endian conversions around storage, calldata and ABI
+/// accesses. Pairs of byte swaps cancel, constants are swapped at compile
+/// time, and a swap shifted right by whole bytes only swaps the bytes it
+/// keeps. When \p ExpandLimbs is enabled, a 256-bit swap next to a load or
+/// store is done limb by limb in memory instead of calling the helper. Wasm
+/// has no byte swap instruction, so this trades code size for speed.
+class SimplifyBswap : public llvm::PassInfoMixin<SimplifyBswap> {
+  bool ExpandLimbs;
+
+public:
+  explicit SimplifyBswap(bool ExpandLimbs = false) : ExpandLimbs(ExpandLimbs) {}
+
+  llvm::PreservedAnalyses run(llvm::Function &F,
+                              llvm::FunctionAnalysisManager &FAM);
+};
+
+} // namespace soll
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/PassManager.h>
+
+namespace soll {
+
+/// Specialize calls to the solidity.expi256 helper on constant operands.
+/// A constant exponent is expanded into a chain of multiplications, a base
+/// that is a power of two becomes a shift, and other small constant bases
+/// look their result up in a table of powers.
+class SimplifyExp : public llvm::PassInfoMixin<SimplifyExp> {
+public:
+  llvm::PreservedAnalyses run(llvm::Function &F,
+                              llvm::FunctionAnalysisManager &FAM);
+};
+
+} // namespace soll
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/PassManager.h>
+
+namespace soll {
+
+/// Remove redundant contract storage accesses on Ewasm. The storageLoad and
+/// storageStore host functions are treated as memory operations on a space
+/// of slots keyed by SSA values: stored and loaded values are forwarded to
+/// later loads of the same slot, a store overwritten by a later store to the
+/// same slot is dropped, and loop-invariant loads in loops without stores
+/// are hoisted into the preheader when they run on every iteration. That
+/// needs rotated loops: the body of a loop tested at the top does not run on
+/// the way out of it. Calls that may run other code, such as external calls
+/// and calls to functions that are not known to leave storage alone,
+/// invalidate everything.
+class StorageCache : public llvm::PassInfoMixin<StorageCache> {
+public:
+  llvm::PreservedAnalyses run(llvm::Function &F,
+                              llvm::FunctionAnalysisManager &FAM);
+};
+
+} // namespace soll
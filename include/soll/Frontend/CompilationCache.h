@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+#include "soll/CodeGen/BackendUtil.h"
+#include <cstdint>
+#include <list>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+
+namespace soll {
+
+class CompilerInvocation;
+
+/// Content-addressed store for the outputs of earlier compilations, kept as
+/// one file per key in a cache directory. Writes go through a temporary file
+/// that is renamed into place, so concurrent compilers never see a partial
+/// entry. Entries are touched when used and the least recently used ones are
+/// evicted once the directory outgrows its size limit.
+class CompilationCache {
+public:
+  /// One output stream opened by an action.
+  struct Output {
+    /// Whether the action printed to standard output instead of opening an
+    /// output file.
+    bool Printed = false;
+    BackendAction Action = BackendAction::EmitNothing;
+    /// Output file name requested by the backend, usually a contract name.
+    std::string OutName;
+    std::string Data;
+  };
+  using OutputList = std::list<Output>;
+  /// What a compilation left behind: its outputs, and the diagnostics and
+  /// reports it wrote to standard error, rendered without colors.
+  struct Entry {
+    OutputList Outputs;
+    std::string Diagnostics;
+  };
+
+  CompilationCache(llvm::StringRef Dir, std::uint64_t SizeLimit);
+
+  /// Key for compiling \p InFile with contents \p Buffers under
+  /// \p Invocation, where the buffers also hold the names and contents of
+  /// imported files. Everything that can change the outputs takes part: the
+  /// soll and LLVM versions, the options and the contents of the profile.
+  static std::string computeKey(const CompilerInvocation &Invocation,
+                                llvm::StringRef InFile,
+                                llvm::ArrayRef<llvm::StringRef> Buffers);
+
+  llvm::Optional<Entry> lookup(llvm::StringRef Key);
+  void store(llvm::StringRef Key, const OutputList &Outputs,
+             llvm::StringRef Diagnostics);
+
+  void printStats(llvm::raw_ostream &OS) const;
+
+private:
+  std::string Dir;
+  std::uint64_t SizeLimit;
+  unsigned Hits = 0;
+  unsigned Misses = 0;
+  unsigned Stores = 0;
+  unsigned Evictions = 0;
+
+  std::string getEntryPath(llvm::StringRef Key) const;
+  void prune();
+};
+
+} // namespace soll
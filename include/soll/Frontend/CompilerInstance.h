@@ -4,6 +4,7 @@
 #include "soll/AST/ASTContext.h"
 #include "soll/Basic/DiagnosticOptions.h"
 #include "soll/CodeGen/CodeGenAction.h"
+#include "soll/Frontend/CompilationCache.h"
 #include "soll/Frontend/CompilerInvocation.h"
 #include "soll/Frontend/DiagnosticRenderer.h"
 #include "soll/Lex/Lexer.h"
@@ -46,9 +47,33 @@ class CompilerInstance {
   std::unique_ptr<llvm::raw_fd_ostream> NonSeekStream;
   std::list<OutputFile> OutputFiles;
 
+  std::unique_ptr<CompilationCache> Cache;
+  /// Outputs of the current input, recorded for the cache.
+  CompilationCache::OutputList *CacheRecord = nullptr;
+  /// Outputs kept in memory instead of being written out.
+  CompilationCache::OutputList *CapturedOutputs = nullptr;
+  std::unique_ptr<llvm::raw_ostream> PrintStream;
+  llvm::raw_ostream *ErrorStream = nullptr;
+
   CompilerInstance(const CompilerInstance &) = delete;
   CompilerInstance &operator=(const CompilerInstance &) = delete;
 
+  std::unique_ptr<llvm::raw_pwrite_stream>
+  createBackendOutputFile(llvm::StringRef InFile, BackendAction Action,
+                          llvm::StringRef OutName);
+  CompilationCache::OutputList *getOutputRecord() const {
+    return CacheRecord ? CacheRecord : CapturedOutputs;
+  }
+  std::string getCacheKey(const FrontendInputFile &Input);
+  unsigned getNumInputThreads() const;
+  void executeSequentially(FrontendAction &Act);
+  bool executeConcurrently(
+      const std::function<std::unique_ptr<FrontendAction>(CompilerInstance &)>
+          &CreateAction,
+      unsigned NumThreads);
+  void replayOutputs(const FrontendInputFile &Input,
+                     const CompilationCache::OutputList &Outputs);
+
 public:
   explicit CompilerInstance();
   CompilerInvocation &getInvocation();
@@ -61,6 +86,24 @@ public:
   std::function<std::unique_ptr<llvm::raw_pwrite_stream>(
       llvm::StringRef, BackendAction, llvm::StringRef)>
   GetOutputStreamFunc();
+
+  /// Stream for actions that print their results: standard output, teed
+  /// into the cache entry while one is being recorded.
+  llvm::raw_ostream &getPrintStream();
+
+  /// Stream for reports that go to standard error next to diagnostics, such
+  /// as the import graph.
+  llvm::raw_ostream &getErrorStream() {
+    return ErrorStream ? *ErrorStream : llvm::errs();
+  }
+  void setErrorStream(llvm::raw_ostream *OS) { ErrorStream = OS; }
+
+  /// Keep the outputs of the following actions in \p Outputs instead of
+  /// writing them to files and standard output. Null writes them out again.
+  void captureOutputs(CompilationCache::OutputList *Outputs) {
+    CapturedOutputs = Outputs;
+  }
+
   FileSystemOptions &getFileSystemOpts() {
     return Invocation->getFileSystemOpts();
   }
@@ -179,7 +222,14 @@ public:
 
   bool InitializeSourceManager(const FrontendInputFile &Input);
 
-  bool ExecuteAction(FrontendAction &action);
+  using ActionFactory =
+      std::function<std::unique_ptr<FrontendAction>(CompilerInstance &)>;
+
+  /// Runs \p Act on every input. Given \p CreateAction, inputs are compiled
+  /// concurrently as -j allows, each with an action and compiler instance of
+  /// its own.
+  bool ExecuteAction(FrontendAction &Act, ActionFactory CreateAction = nullptr);
+
 };
 
 } // namespace soll
@@ -8,6 +8,7 @@
 #include "soll/Frontend/FrontendOptions.h"
 #include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/Support/raw_ostream.h>
 #include <memory>
 
 namespace soll {
@@ -25,8 +26,11 @@ class CompilerInvocation {
 
 public:
   explicit CompilerInvocation() : DiagnosticOpts(new DiagnosticOptions) {}
+  /// Errors are printed to \p Errs if given, otherwise they end the
+  /// process.
   bool ParseCommandLineOptions(llvm::ArrayRef<const char *> Arg,
-                               DiagnosticsEngine &Diags);
+                               DiagnosticsEngine &Diags,
+                               llvm::raw_ostream *Errs = nullptr);
   DiagnosticOptions &GetDiagnosticOptions();
   DiagnosticRenderer &GetDiagnosticRenderer();
 
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 #pragma once
 #include <llvm/ADT/StringRef.h>
+#include <cstdint>
 #include <llvm/Support/MemoryBuffer.h>
 #include <vector>
 
@@ -83,6 +84,28 @@ public:
 
   /// The frontend action to perform.
   ActionKind ProgramAction = EmitLLVM;
+
+  /// Directory of the compilation cache, or empty to always compile.
+  std::string CacheDir;
+
+  /// Size in bytes the compilation cache is pruned to.
+  std::uint64_t CacheSizeLimit = std::uint64_t(1) << 30;
+
+  /// Print hit and size statistics of the compilation cache.
+  bool ShowCacheStats = false;
+
+  /// Print the import graph of each input with the time spent parsing every
+  /// module.
+  bool PrintImportGraph = false;
+
+  /// Lex every source file in full before parsing it.
+  bool PreLex = false;
+
+  /// Serve compile requests instead of compiling the inputs.
+  bool Server = false;
+
+  /// Unix socket to serve compile requests on, or empty for standard input.
+  std::string ServerSocket;
 };
 
 } // namespace soll
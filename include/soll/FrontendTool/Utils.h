@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 #pragma once
+#include <llvm/ADT/StringRef.h>
 #include <memory>
 
 namespace soll {
@@ -10,4 +11,9 @@ class FrontendAction;
 std::unique_ptr<FrontendAction> CreateFrontendAction(CompilerInstance &CI);
 bool ExecuteCompilerInvocation(CompilerInstance *Soll);
 
+/// Serve JSON compile requests on \p SocketPath, or on standard input and
+/// output if it is empty, so that one process with initialized targets
+/// handles many compiles.
+bool RunCompileServer(llvm::StringRef SocketPath);
+
 } // namespace soll
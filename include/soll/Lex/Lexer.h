@@ -4,9 +4,11 @@
 #include "soll/Basic/IdentifierTable.h"
 #include "soll/Basic/SourceManager.h"
 #include "soll/Lex/Token.h"
+#include "soll/Lex/TokenStream.h"
 #include <llvm/ADT/Optional.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <memory>
 
 namespace soll {
 
@@ -27,6 +29,7 @@ class Lexer {
   using CachedTokensTy = llvm::SmallVector<Token, 1>;
   CachedTokensTy CachedTokens;
   CachedTokensTy::size_type CachedLexPos = 0;
+  std::unique_ptr<TokenStream> Stream;
 
 public:
   Lexer(FileID FID, const llvm::MemoryBuffer *FromFile, SourceManager &SM);
@@ -65,6 +68,12 @@ public:
 
   void EnterTokenStream(const Token *Toks, unsigned NumToks);
 
+  /// Lexes the rest of the buffer, tokens cached for lookahead included, into
+  /// a TokenStream the parser then reads from. The lexer is left at the end
+  /// of the buffer.
+  const TokenStream &lexAll();
+  const TokenStream *getTokenStream() const { return Stream.get(); }
+
 private:
   llvm::Optional<Token> PeekAhead(unsigned N);
 
@@ -80,6 +89,7 @@ private:
     Result.setLength(TokLen);
     Result.setLocation(getSourceLocation(BufferPtr, TokLen));
     Result.setKind(Kind);
+    Result.setIdentifierInfo(nullptr);
     BufferPtr = TokEnd;
     return Result;
   }
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+#include "soll/Lex/Token.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace soll {
+
+/// The tokens of a whole buffer, lexed before parsing starts. Tokens are
+/// kept as separate arrays of kinds, offsets from the start of the file,
+/// lengths and identifier or literal data, so a parser scanning kinds only
+/// touches the kinds. Any token can be read back by index, which gives
+/// unbounded lookahead and lets a parser backtrack by resetting an index.
+/// The last token is always tok::eof, and reads past it return it again.
+class TokenStream {
+  SourceLocation FileLoc;
+  std::vector<tok::TokenKind> Kinds;
+  std::vector<unsigned> Offsets;
+  std::vector<unsigned> Lengths;
+  std::vector<const void *> Data;
+
+public:
+  explicit TokenStream(SourceLocation FileLoc) : FileLoc(FileLoc) {}
+
+  void reserve(size_t N) {
+    Kinds.reserve(N);
+    Offsets.reserve(N);
+    Lengths.reserve(N);
+    Data.reserve(N);
+  }
+
+  void push_back(const Token &Tok) {
+    Kinds.push_back(Tok.getKind());
+    Offsets.push_back(Tok.getLocation().getRawEncoding() -
+                      FileLoc.getRawEncoding());
+    Lengths.push_back(Tok.getLength());
+    if (Tok.isLiteral()) {
+      Data.push_back(Tok.getLiteralData());
+    } else {
+      Data.push_back(Tok.getIdentifierInfo());
+    }
+  }
+
+  size_t size() const { return Kinds.size(); }
+  bool empty() const { return Kinds.empty(); }
+
+  tok::TokenKind getKind(size_t I) const { return Kinds[clamp(I)]; }
+
+  Token operator[](size_t I) const {
+    I = clamp(I);
+    Token Result;
+    Result.setKind(Kinds[I]);
+    Result.setLocation(FileLoc.getLocWithOffset(Offsets[I]));
+    Result.setLength(Lengths[I]);
+    if (Result.isLiteral()) {
+      Result.setLiteralData(static_cast<const char *>(Data[I]));
+    } else {
+      Result.setIdentifierInfo(
+          static_cast<IdentifierInfo *>(const_cast<void *>(Data[I])));
+    }
+    return Result;
+  }
+
+private:
+  size_t clamp(size_t I) const {
+    assert(!empty() && Kinds.back() == tok::eof && "Unterminated stream!");
+    return std::min(I, size() - 1);
+  }
+};
+
+} // namespace soll
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#pragma once
+#include "soll/AST/ASTForward.h"
+#include "soll/Basic/SourceLocation.h"
+#include <chrono>
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace soll {
+
+class FileEntry;
+class Lexer;
+class Parser;
+class Sema;
+
+/// One source file of a compilation, the main file or an imported one.
+struct SourceModule {
+  /// Resolved path of the file the module was first loaded from.
+  std::string Path;
+  /// Hex MD5 of the contents.
+  std::string Hash;
+  FileID FID;
+  /// Lexer of an imported module. It owns the identifiers of the module's
+  /// declarations, so it lives as long as the graph.
+  std::unique_ptr<Lexer> Lex;
+  /// Top-level declarations, until they are linked into the source unit.
+  std::vector<DeclPtr> Nodes;
+  std::vector<const SourceModule *> Imports;
+  /// Number of import directives resolved to this module.
+  unsigned Importers = 0;
+  /// Time spent lexing and parsing this module, without its imports.
+  std::chrono::steady_clock::duration ParseTime{};
+};
+
+/// The files reachable through `import` from the main file. Every file is
+/// lexed and parsed once, however many modules import it and under whatever
+/// relative spelling, and its declarations end up once in the source unit
+/// for all importers to resolve against. Modules are keyed by resolved path,
+/// by file identity and by content hash, so a vendored copy of a library
+/// shares the parse of the original. Copies with relative imports are parsed
+/// again, as those imports resolve to different files.
+class ModuleGraph {
+  Sema &Actions;
+  const llvm::StringMap<llvm::APInt> &LibrariesAddressMap;
+  /// Lex imported files in full before parsing them.
+  bool PreLex;
+
+  std::vector<std::unique_ptr<SourceModule>> Modules;
+  llvm::StringMap<SourceModule *> ByPath;
+  std::map<llvm::sys::fs::UniqueID, SourceModule *> ByFile;
+  llvm::StringMap<SourceModule *> ByHash;
+
+  unsigned NumImports = 0;
+  unsigned NumReused = 0;
+  /// Parse time of the modules imported by the module being parsed.
+  std::chrono::steady_clock::duration NestedTime{};
+
+  SourceModule &addModule(llvm::StringRef Path, FileID FID, std::string Hash,
+                          const FileEntry *File);
+  SourceModule *load(llvm::StringRef Path, SourceLocation Loc);
+  void parseModule(SourceModule &M, Parser &P);
+  void link(SourceModule &M, llvm::SmallPtrSetImpl<SourceModule *> &Visited,
+            std::vector<DeclPtr> &Nodes);
+
+public:
+  ModuleGraph(Sema &Actions,
+              const llvm::StringMap<llvm::APInt> &LibrariesAddressMap,
+              bool PreLex = false);
+  ~ModuleGraph();
+
+  /// Parses the main file with \p P along with everything it imports.
+  /// Returns the top-level declarations of all modules, each module once and
+  /// after the modules it imports.
+  std::vector<DeclPtr> parse(Parser &P);
+
+  /// Resolves an import of \p Path by \p Importer, parsing the imported file
+  /// if no module has done so yet. Returns null after a diagnostic if the
+  /// file cannot be found.
+  const SourceModule *import(SourceModule &Importer, llvm::StringRef Path,
+                             SourceLocation Loc);
+
+  /// Prints the modules with their imports and parse times.
+  void print(llvm::raw_ostream &OS) const;
+
+  /// Resolves \p Path imported from the file \p Importer. Paths starting
+  /// with "./" or "../" are relative to the importer, others to the working
+  /// directory.
+  static std::string resolvePath(llvm::StringRef Importer,
+                                 llvm::StringRef Path);
+
+  /// The paths of the import directives in \p Source, found without a full
+  /// parse. Commented out imports are skipped.
+  static std::vector<std::string> scanImports(llvm::StringRef Source);
+};
+
+} // namespace soll
@@ -1,13 +1,20 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 #pragma once
 
+namespace llvm {
+class raw_ostream;
+} // namespace llvm
+
 namespace soll {
 
 class ASTConsumer;
 class ASTContext;
 class Sema;
 
-void ParseAST(Sema &S, ASTConsumer &C, ASTContext &Ctx,
-              bool PrintStats = false);
+/// Parses the main file of \p S and hands the source unit to \p C. With
+/// \p PreLex every file is lexed in full before it is parsed. When
+/// \p ImportGraphOS is set, the import graph is reported there.
+void ParseAST(Sema &S, ASTConsumer &C, ASTContext &Ctx, bool PrintStats = false,
+              llvm::raw_ostream *ImportGraphOS = nullptr, bool PreLex = false);
 
 } // namespace soll
@@ -19,6 +19,8 @@ class FunctionDecl;
 class VarDecl;
 class ParamList;
 class ModifierInvocation;
+class ModuleGraph;
+struct SourceModule;
 
 class Stmt;
 class Block;
@@ -33,6 +35,12 @@ class Parser {
   Token Tok;
   const llvm::StringMap<llvm::APInt> LibrariesAddressMap;
   unsigned short ParenCount = 0, BracketCount = 0, BraceCount = 0;
+  ModuleGraph *Modules = nullptr;
+  SourceModule *CurrentModule = nullptr;
+  /// Tokens of the file when it was lexed before parsing, with the index of
+  /// Tok in them.
+  const TokenStream *Stream = nullptr;
+  size_t StreamPos = 0;
 
 public:
   Parser(Lexer &TheLexer, Sema &Actions, DiagnosticsEngine &Diags,
@@ -40,6 +48,16 @@ public:
   std::unique_ptr<SourceUnit> parse();
   std::unique_ptr<SourceUnit> parseYul();
 
+  /// Resolves imports through \p Modules, as those of \p Module. The graph
+  /// registers the main file itself. Without a graph imports are skipped.
+  void setModuleGraph(ModuleGraph *Modules, SourceModule *Module = nullptr) {
+    this->Modules = Modules;
+    CurrentModule = Module;
+  }
+
+  /// Parses the top-level declarations of the file, leaving them unresolved.
+  std::vector<std::unique_ptr<Decl>> parseSourceUnitParts();
+
 private:
   struct VarDeclParserOptions {
     // This is actually not needed, but due to a defect in the C++ standard, we
@@ -71,6 +89,7 @@ private:
   // std::vector<Token> const& _tokens, std::vector<std::string> const&
   // _literals);
   std::unique_ptr<PragmaDirective> parsePragmaDirective();
+  void parseImportDirective();
   std::pair<ContractDecl::ContractKind, bool> parseContractKind();
   std::unique_ptr<ContractDecl> parseContractDefinition();
   std::unique_ptr<InheritanceSpecifier> parseInheritanceSpecifier();
@@ -192,11 +211,26 @@ private:
   Token GetLookAheadToken(unsigned N) {
     if (N == 0 || Tok.is(tok::eof))
       return Tok;
+    if (Stream)
+      return (*Stream)[StreamPos + N];
     return *TheLexer.LookAhead(N - 1);
   }
 
-  Token NextToken() const { return *TheLexer.LookAhead(0); }
-  Token NextNextToken() const { return *TheLexer.LookAhead(1); }
+  Token NextToken() const {
+    return Stream ? (*Stream)[StreamPos + 1] : *TheLexer.LookAhead(0);
+  }
+  Token NextNextToken() const {
+    return Stream ? (*Stream)[StreamPos + 2] : *TheLexer.LookAhead(1);
+  }
+
+  /// Moves on to the next token, read from the token stream when the file
+  /// was lexed up front.
+  void AdvanceToken() {
+    if (Stream)
+      Tok = (*Stream)[++StreamPos];
+    else
+      Tok = *TheLexer.CachedLex();
+  }
 
   bool isTokenParen() const { return Tok.isOneOf(tok::l_paren, tok::r_paren); }
   bool isTokenBracket() const {
@@ -215,7 +249,7 @@ private:
     assert(!isTokenSpecial() &&
            "Should consume special tokens with Consume*Token");
     auto Location = Tok.getLocation();
-    Tok = *TheLexer.CachedLex();
+    AdvanceToken();
     return Location;
   }
 
@@ -224,7 +258,7 @@ private:
       return false;
     assert(!isTokenSpecial() &&
            "Should consume special tokens with Consume*Token");
-    Tok = *TheLexer.CachedLex();
+    AdvanceToken();
     return true;
   }
 
@@ -236,7 +270,7 @@ private:
       --ParenCount; // Don't let unbalanced )'s drive the count negative.
     }
     auto Location = Tok.getLocation();
-    Tok = *TheLexer.CachedLex();
+    AdvanceToken();
     return Location;
   }
 
@@ -248,7 +282,7 @@ private:
       --BracketCount; // Don't let unbalanced ]'s drive the count negative.
     }
     auto Location = Tok.getLocation();
-    Tok = *TheLexer.CachedLex();
+    AdvanceToken();
     return Location;
   }
 
@@ -260,7 +294,7 @@ private:
       --BraceCount; // Don't let unbalanced }'s drive the count negative.
     }
     auto Location = Tok.getLocation();
-    Tok = *TheLexer.CachedLex();
+    AdvanceToken();
     return Location;
   }
 
@@ -268,7 +302,7 @@ private:
     assert(isTokenStringLiteral() &&
            "Should only consume string literals with this method");
     auto Location = Tok.getLocation();
-    Tok = *TheLexer.CachedLex();
+    AdvanceToken();
     return Location;
   }
 
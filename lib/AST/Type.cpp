@@ -4,6 +4,24 @@
 
 namespace soll {
 
+std::pair<std::size_t, unsigned> StorageAllocator::allocate(const Type &Ty) {
+  const unsigned Size = Ty.getStorageSize();
+  const Type::Category Category = Ty.getCategory();
+  const bool Packed = Size < 32 && Category != Type::Category::Struct &&
+                      Category != Type::Category::Array;
+  if (Offset != 0 && (!Packed || Offset + Size > 32)) {
+    ++Slot;
+    Offset = 0;
+  }
+  const std::pair<std::size_t, unsigned> Location(Slot, Offset);
+  if (Packed) {
+    Offset += Size;
+  } else {
+    Slot += (Size + 31) / 32;
+  }
+  return Location;
+}
+
 bool IntegerType::isImplicitlyConvertibleTo(Type const &_other) const {
   if (_other.getCategory() == Category::Integer) {
     IntegerType const &ConvertTo = dynamic_cast<IntegerType const &>(_other);
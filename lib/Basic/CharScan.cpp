@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/Basic/CharScan.h"
+#include <cstdint>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/MathExtras.h>
+
+#if defined(__x86_64__) && defined(__SSE2__) &&                               \
+    (defined(__GNUC__) || defined(__clang__))
+#define SOLL_CHARSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace soll {
+
+namespace {
+
+/// The classes scanned for, as bits of the nibble tables below.
+enum CharClass : std::uint8_t {
+  CC_Identifier = 0x1F,
+  CC_Whitespace = 0x60,
+  CC_LineEnd = 0x80,
+};
+
+/// A character belongs to a class if the entries for its low and its high
+/// nibble share one of the class bits:
+///   0x01 '$'                   0x20 '\t' '\n' '\v' '\f' '\r'
+///   0x02 '0'-'9'               0x40 ' '
+///   0x04 'A'-'O', 'a'-'o'      0x80 '\0' '\n' '\r'
+///   0x08 'P'-'Z', 'p'-'z'
+///   0x10 '_'
+/// Characters from 0x80 up have no high nibble bits, as CharInfo.h treats
+/// them as neither identifier characters nor whitespace.
+constexpr std::uint8_t LowNibbleClasses[16] = {
+    0x02 | 0x08 | 0x40 | 0x80, // 0
+    0x02 | 0x04 | 0x08,        // 1
+    0x02 | 0x04 | 0x08,        // 2
+    0x02 | 0x04 | 0x08,        // 3
+    0x01 | 0x02 | 0x04 | 0x08, // 4
+    0x02 | 0x04 | 0x08,        // 5
+    0x02 | 0x04 | 0x08,        // 6
+    0x02 | 0x04 | 0x08,        // 7
+    0x02 | 0x04 | 0x08,        // 8
+    0x02 | 0x04 | 0x08 | 0x20, // 9
+    0x04 | 0x08 | 0x20 | 0x80, // a
+    0x04 | 0x20,               // b
+    0x04 | 0x20,               // c
+    0x04 | 0x20 | 0x80,        // d
+    0x04,                      // e
+    0x04 | 0x10,               // f
+};
+constexpr std::uint8_t HighNibbleClasses[16] = {
+    0x20 | 0x80, // 0
+    0,           // 1
+    0x01 | 0x40, // 2
+    0x02,        // 3
+    0x04,        // 4
+    0x08 | 0x10, // 5
+    0x04,        // 6
+    0x08,        // 7
+    0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+bool isInClass(unsigned char C, CharClass Class) {
+  return LowNibbleClasses[C & 0x0F] & HighNibbleClasses[C >> 4] & Class;
+}
+
+template <CharClass Class, bool Member>
+const char *scanScalar(const char *Ptr, const char *End) {
+  while (Ptr < End && isInClass(*Ptr, Class) == Member) {
+    ++Ptr;
+  }
+  return Ptr;
+}
+
+const char *findSlashScalar(const char *Ptr, const char *End) {
+  while (Ptr < End && *Ptr != '/') {
+    ++Ptr;
+  }
+  return Ptr;
+}
+
+#ifdef SOLL_CHARSCAN_X86
+
+/// Bytes of \p V that are in \p Class, with plain compares since SSE2 has no
+/// byte shuffle to look the tables up with.
+template <CharClass Class> __m128i classifySSE2(__m128i V) {
+  // Unsigned X <= Max, for bytes.
+  auto AtMost = [](__m128i X, char Max) {
+    return _mm_cmpeq_epi8(_mm_min_epu8(X, _mm_set1_epi8(Max)), X);
+  };
+  auto Is = [V](char C) { return _mm_cmpeq_epi8(V, _mm_set1_epi8(C)); };
+  switch (Class) {
+  case CC_Identifier: {
+    const __m128i Lower = _mm_or_si128(V, _mm_set1_epi8(0x20));
+    const __m128i Letter = AtMost(_mm_sub_epi8(Lower, _mm_set1_epi8('a')), 25);
+    const __m128i Digit = AtMost(_mm_sub_epi8(V, _mm_set1_epi8('0')), 9);
+    return _mm_or_si128(_mm_or_si128(Letter, Digit),
+                        _mm_or_si128(Is('_'), Is('$')));
+  }
+  case CC_Whitespace:
+    return _mm_or_si128(AtMost(_mm_sub_epi8(V, _mm_set1_epi8('\t')), 4),
+                        Is(' '));
+  case CC_LineEnd:
+    return _mm_or_si128(_mm_or_si128(Is('\n'), Is('\r')), Is('\0'));
+  }
+  llvm_unreachable("Invalid class!");
+}
+
+template <CharClass Class, bool Member>
+const char *scanSSE2(const char *Ptr, const char *End) {
+  while (End - Ptr >= 16) {
+    const __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+    unsigned Mask = _mm_movemask_epi8(classifySSE2<Class>(V));
+    if (Member) {
+      Mask = ~Mask & 0xFFFF;
+    }
+    if (Mask) {
+      return Ptr + llvm::countTrailingZeros(Mask);
+    }
+    Ptr += 16;
+  }
+  return scanScalar<Class, Member>(Ptr, End);
+}
+
+const char *findSlashSSE2(const char *Ptr, const char *End) {
+  const __m128i Slashes = _mm_set1_epi8('/');
+  while (End - Ptr >= 16) {
+    const __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+    if (unsigned Mask = _mm_movemask_epi8(_mm_cmpeq_epi8(V, Slashes))) {
+      return Ptr + llvm::countTrailingZeros(Mask);
+    }
+    Ptr += 16;
+  }
+  return findSlashScalar(Ptr, End);
+}
+
+template <CharClass Class, bool Member>
+__attribute__((target("avx2"))) const char *scanAVX2(const char *Ptr,
+                                                     const char *End) {
+  const __m256i Low = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(LowNibbleClasses)));
+  const __m256i High = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(HighNibbleClasses)));
+  const __m256i Nibble = _mm256_set1_epi8(0x0F);
+  const __m256i Bits = _mm256_set1_epi8(static_cast<char>(Class));
+  while (End - Ptr >= 32) {
+    const __m256i V =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Ptr));
+    const __m256i Classes = _mm256_and_si256(
+        _mm256_shuffle_epi8(Low, _mm256_and_si256(V, Nibble)),
+        _mm256_shuffle_epi8(
+            High, _mm256_and_si256(_mm256_srli_epi16(V, 4), Nibble)));
+    // Bytes outside the class.
+    const __m256i Outside = _mm256_cmpeq_epi8(
+        _mm256_and_si256(Classes, Bits), _mm256_setzero_si256());
+    unsigned Mask = _mm256_movemask_epi8(Outside);
+    if (!Member) {
+      Mask = ~Mask;
+    }
+    if (Mask) {
+      return Ptr + llvm::countTrailingZeros(Mask);
+    }
+    Ptr += 32;
+  }
+  return scanSSE2<Class, Member>(Ptr, End);
+}
+
+__attribute__((target("avx2"))) const char *findSlashAVX2(const char *Ptr,
+                                                          const char *End) {
+  const __m256i Slashes = _mm256_set1_epi8('/');
+  while (End - Ptr >= 32) {
+    const __m256i V =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Ptr));
+    if (unsigned Mask =
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(V, Slashes))) {
+      return Ptr + llvm::countTrailingZeros(Mask);
+    }
+    Ptr += 32;
+  }
+  return findSlashSSE2(Ptr, End);
+}
+
+#endif
+
+using ScanFn = const char *(*)(const char *, const char *);
+
+struct Scanners {
+  const char *Kind;
+  ScanFn IdentifierBody;
+  ScanFn Whitespace;
+  ScanFn LineEnd;
+  ScanFn Slash;
+};
+
+Scanners selectScanners() {
+#ifdef SOLL_CHARSCAN_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return {"avx2", scanAVX2<CC_Identifier, true>,
+            scanAVX2<CC_Whitespace, true>, scanAVX2<CC_LineEnd, false>,
+            findSlashAVX2};
+  }
+  return {"sse2", scanSSE2<CC_Identifier, true>, scanSSE2<CC_Whitespace, true>,
+          scanSSE2<CC_LineEnd, false>, findSlashSSE2};
+#else
+  return {"scalar", scanScalar<CC_Identifier, true>,
+          scanScalar<CC_Whitespace, true>, scanScalar<CC_LineEnd, false>,
+          findSlashScalar};
+#endif
+}
+
+const Scanners &getScanners() {
+  static const Scanners S = selectScanners();
+  return S;
+}
+
+} // namespace
+
+const char *skipIdentifierBody(const char *Ptr, const char *End) {
+  return getScanners().IdentifierBody(Ptr, End);
+}
+
+const char *skipWhitespace(const char *Ptr, const char *End) {
+  return getScanners().Whitespace(Ptr, End);
+}
+
+const char *findLineEnd(const char *Ptr, const char *End) {
+  return getScanners().LineEnd(Ptr, End);
+}
+
+const char *findSlash(const char *Ptr, const char *End) {
+  return getScanners().Slash(Ptr, End);
+}
+
+const char *getCharScanKind() { return getScanners().Kind; }
+
+} // namespace soll
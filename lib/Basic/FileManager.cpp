@@ -283,4 +283,14 @@ FileManager::getBufferForFile(llvm::StringRef Filename, bool isVolatile) {
   return FS->getBufferForFile(FilePath.c_str(), -1, true, isVolatile);
 }
 
+void FileManager::PrintStats(llvm::raw_ostream &OS) const {
+  OS << "*** File Manager Stats:\n"
+     << UniqueRealFiles.size() << " real files found, "
+     << UniqueRealDirs.size() << " real dirs found.\n"
+     << NumDirLookups << " dir lookups, " << NumDirCacheMisses
+     << " dir cache misses.\n"
+     << NumFileLookups << " file lookups, " << NumFileCacheMisses
+     << " file cache misses.\n\n";
+}
+
 } // namespace soll
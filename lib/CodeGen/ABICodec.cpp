@@ -83,9 +83,8 @@ AbiEmitter::getDecode(llvm::Value *Int8Ptr, const Type *Ty) {
     llvm::Value *Length = LengthExprValue->load(Builder, CGM);
 
     llvm::Value *Array = Builder.CreateAlloca(CGF.Int8Ty, Length, "decode");
-    llvm::Function *Memcpy = CGM.getModule().getFunction("solidity.memcpy");
-    Builder.CreateCall(
-        Memcpy, {Builder.CreateBitCast(Array, CGM.Int8PtrTy), Int8Ptr, Length});
+    CGM.emitMemcpy(Builder.CreateBitCast(Array, CGM.Int8PtrTy), Int8Ptr,
+                   Length);
     llvm::Value *Val = llvm::ConstantAggregateZero::get(ValueTy);
     Val = Builder.CreateInsertValue(
         Val, Builder.CreateZExtOrTrunc(Length, CGF.Int256Ty), {0});
@@ -618,14 +617,13 @@ llvm::Value *AbiEmitter::emitEncode(llvm::Value *Int8Ptr,
 }
 llvm::Value *AbiEmitter::copyToInt8Ptr(llvm::Value *Int8Ptr, llvm::Value *Value,
                                        bool IncreasePtr) {
-  llvm::Function *Memcpy = CGM.getModule().getFunction("solidity.memcpy");
   llvm::Type *Ty = Value->getType();
   if (CGM.isDynamicType(Ty)) {
     llvm::Value *Length = Builder.CreateZExtOrTrunc(
         Builder.CreateExtractValue(Value, {0}), CGM.Int32Ty);
     llvm::Value *SrcBytes = Builder.CreateExtractValue(Value, {1});
-    Builder.CreateCall(Memcpy, {Builder.CreateBitCast(Int8Ptr, CGM.Int8PtrTy),
-                                SrcBytes, Length});
+    CGM.emitMemcpy(Builder.CreateBitCast(Int8Ptr, CGM.Int8PtrTy), SrcBytes,
+                   Length);
     if (IncreasePtr)
       return Builder.CreateInBoundsGEP(Int8Ptr, {Length});
   } else {
@@ -4,8 +4,19 @@
 #include "soll/Basic/Diagnostic.h"
 #include "soll/Basic/DiagnosticFrontend.h"
 #include "soll/Basic/TargetOptions.h"
+#include "soll/CodeGen/CoalesceMemorySize.h"
+#include "soll/CodeGen/FoldHash.h"
+#include "soll/CodeGen/LowerSlotHash.h"
 #include "soll/CodeGen/LoweringInteger.h"
+#include "soll/CodeGen/NarrowInteger.h"
+#include "soll/CodeGen/SimplifyBswap.h"
+#include "soll/CodeGen/SimplifyExp.h"
+#include "soll/CodeGen/StorageCache.h"
+#include <llvm/ADT/Any.h>
+#include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/LazyCallGraph.h>
+#include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/Analysis/TargetTransformInfo.h>
 #include <llvm/Bitcode/BitcodeWriterPass.h>
@@ -13,13 +24,205 @@
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/IRPrintingPasses.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/PassInstrumentation.h>
 #include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/Format.h>
 #include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/Timer.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Transforms/IPO/AlwaysInliner.h>
+#include <llvm/Transforms/Scalar/LoopPassManager.h>
+#include <llvm/Transforms/Scalar/LoopRotation.h>
+#include <llvm/Transforms/Scalar/SROA.h>
+#include <llvm/Transforms/Utils/LoopSimplify.h>
+#include <algorithm>
+#include <mutex>
 
 namespace soll {
 
+namespace {
+
+/// Collects per-pass wall time and IR instruction count changes through pass
+/// instrumentation, for -time-passes.
+class PassTimingReport {
+  struct PassRecord {
+    double WallTime = 0.0;
+    int64_t InstDelta = 0;
+    unsigned Runs = 0;
+  };
+
+  struct ActivePass {
+    std::string Name;
+    double Start;
+    double Elapsed;
+    unsigned InstsBefore;
+  };
+
+  llvm::StringMap<PassRecord> Records;
+  std::vector<std::string> Order;
+  std::vector<ActivePass> Stack;
+  unsigned InitialInsts = 0;
+  unsigned FinalInsts = 0;
+
+  static double now() {
+    return llvm::TimeRecord::getCurrentTime(true).getWallTime();
+  }
+
+  static unsigned countInstructions(const llvm::Function &F) {
+    return F.getInstructionCount();
+  }
+
+  static unsigned countInstructions(const llvm::Module &M) {
+    unsigned Count = 0;
+    for (const llvm::Function &F : M) {
+      Count += countInstructions(F);
+    }
+    return Count;
+  }
+
+  static unsigned countInstructions(llvm::Any IR) {
+    if (llvm::any_isa<const llvm::Module *>(IR)) {
+      return countInstructions(*llvm::any_cast<const llvm::Module *>(IR));
+    }
+    if (llvm::any_isa<const llvm::Function *>(IR)) {
+      return countInstructions(*llvm::any_cast<const llvm::Function *>(IR));
+    }
+    if (llvm::any_isa<const llvm::LazyCallGraph::SCC *>(IR)) {
+      unsigned Count = 0;
+      for (const llvm::LazyCallGraph::Node &N :
+           *llvm::any_cast<const llvm::LazyCallGraph::SCC *>(IR)) {
+        Count += countInstructions(N.getFunction());
+      }
+      return Count;
+    }
+    if (llvm::any_isa<const llvm::Loop *>(IR)) {
+      unsigned Count = 0;
+      for (const llvm::BasicBlock *BB :
+           llvm::any_cast<const llvm::Loop *>(IR)->blocks()) {
+        Count += BB->size();
+      }
+      return Count;
+    }
+    return 0;
+  }
+
+  /// Pass managers and adaptors only wrap other passes; their own time is
+  /// kept out of the nested passes but not reported.
+  static bool isWrapperPass(llvm::StringRef Name) {
+    return Name.contains("PassManager") || Name.contains("PassAdaptor");
+  }
+
+  void beforePass(llvm::StringRef Name, llvm::Any IR) {
+    double Now = now();
+    if (!Stack.empty()) {
+      Stack.back().Elapsed += Now - Stack.back().Start;
+    }
+    Stack.push_back({Name.str(), Now, 0.0, countInstructions(IR)});
+  }
+
+  void afterPass(unsigned InstsAfter) {
+    assert(!Stack.empty() && "unbalanced pass instrumentation");
+    double Now = now();
+    ActivePass Pass = std::move(Stack.back());
+    Stack.pop_back();
+    Pass.Elapsed += Now - Pass.Start;
+    if (!Stack.empty()) {
+      Stack.back().Start = Now;
+    }
+    record(Pass.Name, Pass.Elapsed,
+           int64_t(InstsAfter) - int64_t(Pass.InstsBefore));
+  }
+
+public:
+  void registerCallbacks(llvm::PassInstrumentationCallbacks &PIC) {
+#if LLVM_VERSION_MAJOR >= 12
+    PIC.registerBeforeNonSkippedPassCallback(
+        [this](llvm::StringRef Name, llvm::Any IR) { beforePass(Name, IR); });
+    PIC.registerAfterPassCallback(
+        [this](llvm::StringRef, llvm::Any IR, const llvm::PreservedAnalyses &) {
+          afterPass(countInstructions(IR));
+        });
+    PIC.registerAfterPassInvalidatedCallback(
+        [this](llvm::StringRef, const llvm::PreservedAnalyses &) {
+          afterPass(0);
+        });
+#else
+    PIC.registerBeforePassCallback([this](llvm::StringRef Name, llvm::Any IR) {
+      beforePass(Name, IR);
+      return true;
+    });
+    PIC.registerAfterPassCallback([this](llvm::StringRef, llvm::Any IR) {
+      afterPass(countInstructions(IR));
+    });
+    PIC.registerAfterPassInvalidatedCallback(
+        [this](llvm::StringRef) { afterPass(0); });
+#endif
+  }
+
+  void record(llvm::StringRef Name, double WallTime, int64_t InstDelta) {
+    if (isWrapperPass(Name)) {
+      return;
+    }
+    auto Inserted = Records.try_emplace(Name);
+    if (Inserted.second) {
+      Order.push_back(Name.str());
+    }
+    PassRecord &R = Inserted.first->second;
+    R.WallTime += WallTime;
+    R.InstDelta += InstDelta;
+    ++R.Runs;
+  }
+
+  /// Run \p Stage as a single opaque entry of the report.
+  template <typename StageT>
+  void timeStage(llvm::StringRef Name, StageT &&Stage) {
+    double Start = now();
+    Stage();
+    record(Name, now() - Start, 0);
+  }
+
+  void setInitialModule(const llvm::Module &M) {
+    InitialInsts = countInstructions(M);
+  }
+  void setFinalModule(const llvm::Module &M) {
+    FinalInsts = countInstructions(M);
+  }
+
+  void print(llvm::raw_ostream &OS, llvm::StringRef ModuleName) const {
+    std::vector<const std::string *> Sorted;
+    double Total = 0.0;
+    for (const auto &Name : Order) {
+      Sorted.push_back(&Name);
+      Total += Records.lookup(Name).WallTime;
+    }
+    std::stable_sort(Sorted.begin(), Sorted.end(),
+                     [this](const std::string *L, const std::string *R) {
+                       return Records.lookup(*L).WallTime >
+                              Records.lookup(*R).WallTime;
+                     });
+
+    OS << "===" << std::string(73, '-') << "===\n"
+       << "  Pass execution timing report for '" << ModuleName << "'\n"
+       << "===" << std::string(73, '-') << "===\n"
+       << llvm::format("  Total Execution Time: %.4f seconds (wall clock)\n",
+                       Total)
+       << "  IR instructions: " << InitialInsts << " -> " << FinalInsts
+       << "\n\n"
+       << "   ---Wall Time---   --Runs--  --Insts +/-- --- Name ---\n";
+    for (const std::string *Name : Sorted) {
+      const PassRecord R = Records.lookup(*Name);
+      OS << llvm::format("  %8.4f (%5.1f%%)  %8u  %+11lld  ", R.WallTime,
+                         Total > 0.0 ? R.WallTime * 100.0 / Total : 0.0,
+                         R.Runs, static_cast<long long>(R.InstDelta))
+         << *Name << '\n';
+    }
+    OS << llvm::format("  %8.4f (100.0%%)", Total) << std::string(25, ' ')
+       << "Total\n\n";
+  }
+};
+
+} // namespace
+
 class EmitAssemblyHelper {
   DiagnosticsEngine &Diags;
   const CodeGenOptions &CodeGenOpts;
@@ -142,10 +345,18 @@ void EmitAssemblyHelper::EmitAssembly(
     TheModule->setDataLayout(TM->createDataLayout());
   }
 
+  PassTimingReport Timing;
+  llvm::PassInstrumentationCallbacks PIC;
+  if (CodeGenOpts.TimePasses) {
+    Timing.registerCallbacks(PIC);
+    Timing.setInitialModule(*TheModule);
+  }
+
 #if LLVM_VERSION_MAJOR >= 9
-  llvm::PassBuilder PB(TM.get(), llvm::PipelineTuningOptions(), llvm::None);
+  llvm::PassBuilder PB(TM.get(), llvm::PipelineTuningOptions(), llvm::None,
+                       &PIC);
 #else
-  llvm::PassBuilder PB(TM.get(), llvm::None);
+  llvm::PassBuilder PB(TM.get(), llvm::None, &PIC);
 #endif
 
   llvm::LoopAnalysisManager LAM(false);
@@ -173,9 +384,50 @@ void EmitAssemblyHelper::EmitAssembly(
   PB.registerLoopAnalyses(LAM);
   PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
 
+  // The backend runs in three stages, each exactly once: the IR pipeline
+  // (integer lowering and optimization), IR-level output, and machine code
+  // generation. The first two share one module pass manager.
   llvm::ModulePassManager MPM(false);
 
+  // Soll-specific IR passes run while the i256 helpers and operations are
+  // still visible. Promoting the allocas first lets them see through the
+  // locals, and rotating loops puts the body of a `for` or `while` loop on
+  // the path to its exit, where invariant loads can be hoisted from. Constant
+  // hashes are folded first so that the storage cache sees the slots they
+  // address. Storage accesses are cached on Ewasm at -O1 and above;
+  // versioning trades code size for speed, so it is left out of -O0,
+  // -Os and -Oz. Expanding 256-bit swaps next to loads and stores costs more
+  // code per access, so only -O3 does it. The msize bookkeeping is coalesced
+  // once every function has been simplified, since it needs to know which of
+  // them read memory.size.
+  const OptLevel Level = CodeGenOpts.OptimizationLevel;
+  llvm::FunctionPassManager FPM(false);
+  if (Level != O0) {
+#if LLVM_VERSION_MAJOR >= 14
+    FPM.addPass(llvm::SROAPass());
+#else
+    FPM.addPass(llvm::SROA());
+#endif
+    FPM.addPass(llvm::LoopSimplifyPass());
+    FPM.addPass(llvm::createFunctionToLoopPassAdaptor(
+        llvm::LoopRotatePass(/*EnableHeaderDuplication=*/Level != Oz)));
+  }
+  if (TargetOpts.BackendTarget == EWASM) {
+    FPM.addPass(FoldHash());
+  }
+  if (TargetOpts.BackendTarget == EWASM && Level != O0) {
+    FPM.addPass(StorageCache());
+  }
   if (TargetOpts.BackendTarget == EWASM) {
+    FPM.addPass(SimplifyBswap(/*ExpandLimbs=*/Level == O3));
+    FPM.addPass(SimplifyExp());
+    FPM.addPass(NarrowInteger(Level == O1 || Level == O2 || Level == O3));
+  }
+  MPM.addPass(llvm::createModuleToFunctionPassAdaptor(std::move(FPM)));
+  if (TargetOpts.BackendTarget == EWASM) {
+    if (Level != O0) {
+      MPM.addPass(CoalesceMemorySize());
+    }
     MPM.addPass(LoweringInteger());
   }
   switch (CodeGenOpts.OptimizationLevel) {
@@ -198,8 +450,16 @@ void EmitAssemblyHelper::EmitAssembly(
     MPM.addPass(PB.buildPerModuleDefaultPipeline(llvm::PassBuilder::Oz));
     break;
   }
+  // Slot hashes stay pure markers until the optimizer is done with them.
+  // Inlining exposes more swaps to the bswap peephole, such as the selector
+  // shift of a Yul dispatcher, so it runs once more here.
+  if (TargetOpts.BackendTarget == EWASM) {
+    if (Level != O0) {
+      MPM.addPass(llvm::createModuleToFunctionPassAdaptor(SimplifyBswap()));
+    }
+    MPM.addPass(LowerSlotHash());
+  }
   MPM.addPass(llvm::AlwaysInlinerPass());
-  MPM.run(*TheModule, MAM);
 
   // FIXME: We still use the legacy pass manager to do code generation. We
   // create that pass manager here and use it as needed below.
@@ -237,9 +497,23 @@ void EmitAssemblyHelper::EmitAssembly(
   // Now that we have all of the passes ready, run them.
   MPM.run(*TheModule, MAM);
 
+  if (CodeGenOpts.TimePasses) {
+    Timing.setFinalModule(*TheModule);
+  }
+
   // Now if needed, run the legacy PM for codegen.
   if (NeedCodeGen) {
-    CodeGenPasses.run(*TheModule);
+    Timing.timeStage("CodeGen", [&] { CodeGenPasses.run(*TheModule); });
+  }
+
+  if (CodeGenOpts.TimePasses) {
+    // Jobs running in parallel share stderr; keep each report contiguous.
+    static std::mutex ReportMutex;
+    std::string Report;
+    llvm::raw_string_ostream ReportOS(Report);
+    Timing.print(ReportOS, TheModule->getModuleIdentifier());
+    std::lock_guard<std::mutex> Lock(ReportMutex);
+    llvm::errs() << ReportOS.str();
   }
 }
 
@@ -665,7 +665,9 @@ void CodeGenFunction::emitAsmCallMStore8(const CallExpr *CE) {
 }
 
 llvm::Value *CodeGenFunction::emitAsmCallMSize(const CallExpr *CE) {
-  return Builder.CreateLoad(CGM.getMemorySize());
+  return Builder.CreateZExt(
+      Builder.CreateLoad(CGM.Int32Ty, CGM.getMemorySize(), "msize"),
+      CGM.Int256Ty);
 }
 
 llvm::Value *CodeGenFunction::emitAsmCallSLoad(const CallExpr *CE) {
@@ -62,11 +62,11 @@ public:
       case Type::Category::RationalNumber:
       case Type::Category::Contract: {
         llvm::Type *ValueTy = Builder.getIntNTy(Ty->getBitNum());
-        Val = Builder.CreateZExtOrTrunc(CGM.getEndianlessValue(Val), ValueTy);
+        Val = CGM.getEndianlessValue(Val);
         if (Shift != nullptr) {
-          Val = Builder.CreateLShr(Val,
-                                   Builder.CreateZExtOrTrunc(Shift, ValueTy));
+          Val = Builder.CreateLShr(Val, Shift);
         }
+        Val = Builder.CreateZExtOrTrunc(Val, ValueTy);
         return Builder.CreateTruncOrBitCast(Val, CGM.getLLVMType(Ty), Name);
       }
       case Type::Category::String:
@@ -137,8 +137,7 @@ public:
         Builder.SetInsertPoint(ExtendSlot);
         llvm::Value *ExtendLength =
             Builder.CreateLShr(CGM.getEndianlessValue(Val), 1);
-        llvm::Value *Bytes = CGM.emitConcatBytes({Address});
-        llvm::Value *Address = CGM.emitKeccak256(Bytes);
+        llvm::Value *DataAddress = CGM.emitSlotHash({Address});
         llvm::Value *AddressPtr = Builder.CreateAlloca(CGM.Int256Ty);
         llvm::Value *ExtendPtr = Builder.CreateAlloca(CGM.Int8Ty, ExtendLength);
         Condition =
@@ -174,7 +173,7 @@ public:
         PHIRemain->addIncoming(NextRemain, Loop);
         PHIPtr->addIncoming(ExtendPtr, ExtendSlot);
         PHIPtr->addIncoming(NextendPtr, Loop);
-        PHIAddress->addIncoming(Address, ExtendSlot);
+        PHIAddress->addIncoming(DataAddress, ExtendSlot);
         PHIAddress->addIncoming(NextAddress, Loop);
         PHIAddressPtr->addIncoming(AddressPtr, ExtendSlot);
         PHIAddressPtr->addIncoming(PHIAddressPtr, Loop);
@@ -187,7 +186,7 @@ public:
         PHIRemain->addIncoming(NextRemain, Loop);
         PHIPtr->addIncoming(ExtendPtr, ExtendSlot);
         PHIPtr->addIncoming(NextendPtr, Loop);
-        PHIAddress->addIncoming(Address, ExtendSlot);
+        PHIAddress->addIncoming(DataAddress, ExtendSlot);
         PHIAddress->addIncoming(NextAddress, Loop);
         Condition = Builder.CreateICmpSGT(PHIRemain, Builder.getIntN(256, 0));
         Builder.CreateCondBr(Condition, Last, Done);
@@ -218,7 +217,8 @@ public:
         PHIPtr->addIncoming(InlinePtr, InlineSlot);
         PHIPtr->addIncoming(ExtendPtr, LoopEnd);
         PHIPtr->addIncoming(ExtendPtr, Last);
-        Bytes = llvm::ConstantAggregateZero::get(CGM.getLLVMType(Ty));
+        llvm::Value *Bytes =
+            llvm::ConstantAggregateZero::get(CGM.getLLVMType(Ty));
         Bytes = Builder.CreateInsertValue(Bytes, PHILength, {0});
         Bytes = Builder.CreateInsertValue(Bytes, PHIPtr, {1});
 
@@ -258,13 +258,20 @@ public:
       case Type::Category::Bool:
       case Type::Category::FixedBytes:
       case Type::Category::Integer:
-      case Type::Category::RationalNumber: {
+      case Type::Category::RationalNumber:
+      case Type::Category::Contract: {
         if (Shift != nullptr) {
+          // Read-modify-write of the bytes this value owns in the slot. The
+          // value is cut to its width first, so that the high bits of a
+          // negative or wider value do not reach the neighbouring fields.
           llvm::ConstantInt *Mask = Builder.getInt(
-              llvm::APInt::getHighBitsSet(256, 256 - Ty->getBitNum()));
-          llvm::Value *Mask1 = Builder.CreateShl(Mask, Shift);
-          llvm::Value *Mask2 =
-              Builder.CreateShl(Builder.CreateZExt(Value, CGM.Int256Ty), Shift);
+              llvm::APInt::getLowBitsSet(256, Ty->getStorageSize() * 8));
+          llvm::Value *Mask1 =
+              Builder.CreateNot(Builder.CreateShl(Mask, Shift));
+          llvm::Value *Mask2 = Builder.CreateShl(
+              Builder.CreateAnd(Builder.CreateZExtOrTrunc(Value, CGM.Int256Ty),
+                                Mask),
+              Shift);
 
           llvm::Value *Val =
               CGM.getEndianlessValue(CGM.emitStorageLoad(Address));
@@ -344,8 +351,7 @@ public:
         Builder.CreateStore(LengthEncode, ValPtr);
         CGM.emitStorageStore(Builder.CreateLoad(AddressPtr),
                              Builder.CreateLoad(ValPtr));
-        llvm::Value *Bytes = CGM.emitConcatBytes({Address});
-        Address = CGM.emitKeccak256(Bytes);
+        Address = CGM.emitSlotHash({Address});
         Condition = Builder.CreateICmpSGE(Length, Builder.getIntN(256, 32));
         Builder.CreateCondBr(Condition, Loop, LoopEnd);
 
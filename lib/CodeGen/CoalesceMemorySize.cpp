@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/CoalesceMemorySize.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+
+namespace soll {
+
+namespace {
+
+class MemorySizeCoalescer {
+  llvm::Function *Update;
+  llvm::GlobalVariable *MemorySize;
+  /// Functions that may read memory.size, directly or through a call.
+  llvm::SmallPtrSet<const llvm::Function *, 8> Readers;
+
+public:
+  MemorySizeCoalescer(llvm::Function *Update, llvm::GlobalVariable *MemorySize)
+      : Update(Update), MemorySize(MemorySize) {}
+
+  /// Finds the functions that read memory.size. Returns false if its address
+  /// escapes, in which case nothing can be said.
+  bool findReaders(llvm::Module &M) {
+    for (llvm::User *U : MemorySize->users()) {
+      if (auto *Load = llvm::dyn_cast<llvm::LoadInst>(U)) {
+        if (Load->getFunction() != Update) {
+          Readers.insert(Load->getFunction());
+        }
+      } else if (auto *Store = llvm::dyn_cast<llvm::StoreInst>(U)) {
+        if (Store->getPointerOperand() != MemorySize ||
+            Store->getFunction() != Update) {
+          return false;
+        }
+      } else {
+        return false;
+      }
+    }
+    if (Readers.empty()) {
+      return true;
+    }
+    // Callers of readers read it too, as may anything making indirect calls.
+    bool Changed = true;
+    while (Changed) {
+      Changed = false;
+      for (llvm::Function &F : M) {
+        if (F.isDeclaration() || &F == Update || Readers.count(&F)) {
+          continue;
+        }
+        const bool Reads = llvm::any_of(llvm::instructions(F),
+                                        [this](llvm::Instruction &I) {
+                                          return observes(I);
+                                        });
+        if (Reads) {
+          Readers.insert(&F);
+          Changed = true;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool hasReaders() const { return !Readers.empty(); }
+
+  bool isUpdate(const llvm::Instruction &I) const {
+    const auto *Call = llvm::dyn_cast<llvm::CallInst>(&I);
+    return Call && Call->getCalledFunction() == Update;
+  }
+
+  /// Whether \p I may read memory.size.
+  bool observes(const llvm::Instruction &I) const {
+    if (const auto *Load = llvm::dyn_cast<llvm::LoadInst>(&I)) {
+      return Load->getPointerOperand() == MemorySize;
+    }
+    if (const auto *Call = llvm::dyn_cast<llvm::CallBase>(&I)) {
+      const llvm::Function *Callee = Call->getCalledFunction();
+      return !Callee || Readers.count(Callee);
+    }
+    return false;
+  }
+
+  bool dropAll() {
+    bool Changed = false;
+    for (llvm::User *U : llvm::make_early_inc_range(Update->users())) {
+      if (auto *Call = llvm::dyn_cast<llvm::CallInst>(U);
+          Call && Call->getCalledFunction() == Update) {
+        Call->eraseFromParent();
+        Changed = true;
+      }
+    }
+    return Changed;
+  }
+
+  bool coalesce(llvm::BasicBlock &BB);
+  bool sinkOutOfLoop(llvm::Loop &L);
+};
+
+/// Splits a position into a base value and a constant offset. Truncations
+/// are looked through since they wrap the same way as the 32-bit memory.size
+/// arithmetic; a null base stands for zero.
+std::pair<llvm::Value *, std::uint64_t> splitPosition(llvm::Value *Pos) {
+  std::uint64_t Offset = 0;
+  while (true) {
+    if (auto *Trunc = llvm::dyn_cast<llvm::TruncInst>(Pos)) {
+      Pos = Trunc->getOperand(0);
+      continue;
+    }
+    if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(Pos)) {
+      Offset += C->getValue().trunc(32).getZExtValue();
+      return {nullptr, Offset & UINT32_MAX};
+    }
+    auto *BO = llvm::dyn_cast<llvm::BinaryOperator>(Pos);
+    if (!BO || BO->getOpcode() != llvm::Instruction::Add) {
+      return {Pos, Offset & UINT32_MAX};
+    }
+    auto *C = llvm::dyn_cast<llvm::ConstantInt>(BO->getOperand(1));
+    if (!C) {
+      return {Pos, Offset & UINT32_MAX};
+    }
+    Offset += C->getValue().trunc(32).getZExtValue();
+    Pos = BO->getOperand(0);
+  }
+}
+
+/// Merges the updates of a block that share a base, as long as nothing in
+/// between can read memory.size. The later call is kept and made to cover
+/// the largest end.
+bool MemorySizeCoalescer::coalesce(llvm::BasicBlock &BB) {
+  struct Pending {
+    llvm::CallInst *Call;
+    std::uint64_t End;
+  };
+  llvm::DenseMap<llvm::Value *, Pending> Bases;
+  bool Changed = false;
+  for (llvm::Instruction &I : llvm::make_early_inc_range(BB)) {
+    if (!isUpdate(I)) {
+      if (observes(I)) {
+        Bases.clear();
+      }
+      continue;
+    }
+    auto *Call = llvm::cast<llvm::CallInst>(&I);
+    auto *Range = llvm::dyn_cast<llvm::ConstantInt>(Call->getArgOperand(1));
+    if (!Range) {
+      continue;
+    }
+    const auto [Base, Offset] = splitPosition(Call->getArgOperand(0));
+    std::uint64_t End = Offset + Range->getZExtValue();
+    if (End > UINT32_MAX) {
+      continue;
+    }
+    if (auto It = Bases.find(Base); It != Bases.end()) {
+      End = std::max(End, It->second.End);
+      It->second.Call->eraseFromParent();
+      llvm::IRBuilder<> Builder(Call);
+      llvm::Value *Pos = Builder.getInt32(0);
+      if (Base) {
+        Pos = Builder.CreateZExtOrTrunc(Base, Builder.getInt32Ty());
+      }
+      Call->setArgOperand(0, Pos);
+      Call->setArgOperand(1, Builder.getInt32(End));
+      Changed = true;
+    }
+    Bases[Base] = {Call, End};
+  }
+  return Changed;
+}
+
+/// Replaces the updates in a loop that cannot read memory.size with a
+/// running maximum of their ends, and updates memory.size with it on every
+/// exit.
+bool MemorySizeCoalescer::sinkOutOfLoop(llvm::Loop &L) {
+  llvm::SmallVector<llvm::CallInst *, 8> Calls;
+  for (llvm::BasicBlock *BB : L.blocks()) {
+    for (llvm::Instruction &I : *BB) {
+      if (isUpdate(I)) {
+        Calls.push_back(llvm::cast<llvm::CallInst>(&I));
+      }
+    }
+  }
+  llvm::BasicBlock *Preheader = L.getLoopPreheader();
+  if (Calls.empty() || !Preheader || !L.hasDedicatedExits()) {
+    return false;
+  }
+
+  llvm::Function &F = *Preheader->getParent();
+  llvm::BasicBlock &Entry = F.getEntryBlock();
+  llvm::IRBuilder<> Builder(&Entry, Entry.getFirstInsertionPt());
+  llvm::Type *Int32Ty = Builder.getInt32Ty();
+  llvm::AllocaInst *MaxEnd =
+      Builder.CreateAlloca(Int32Ty, nullptr, "memory.end.addr");
+  Builder.SetInsertPoint(Preheader->getTerminator());
+  Builder.CreateStore(Builder.getInt32(0), MaxEnd);
+
+  for (llvm::CallInst *Call : Calls) {
+    Builder.SetInsertPoint(Call);
+    llvm::Value *End = Builder.CreateAdd(Call->getArgOperand(0),
+                                         Call->getArgOperand(1), "memory.end");
+    llvm::Value *Max = Builder.CreateLoad(Int32Ty, MaxEnd, "memory.end.max");
+    llvm::Value *Greater = Builder.CreateICmpUGT(End, Max);
+    Builder.CreateStore(Builder.CreateSelect(Greater, End, Max), MaxEnd);
+    Call->eraseFromParent();
+  }
+
+  // A loop without exits ends the execution, so no one sees the size.
+  llvm::SmallVector<llvm::BasicBlock *, 4> Exits;
+  L.getUniqueExitBlocks(Exits);
+  for (llvm::BasicBlock *Exit : Exits) {
+    Builder.SetInsertPoint(Exit, Exit->getFirstInsertionPt());
+    llvm::Value *Max = Builder.CreateLoad(Int32Ty, MaxEnd, "memory.end.max");
+    Builder.CreateCall(Update, {Builder.getInt32(0), Max});
+  }
+  return true;
+}
+
+} // namespace
+
+llvm::PreservedAnalyses
+CoalesceMemorySize::run(llvm::Module &M, llvm::ModuleAnalysisManager &MAM) {
+  llvm::Function *Update = M.getFunction("solidity.updateMemorySize");
+  llvm::GlobalVariable *MemorySize =
+      M.getGlobalVariable("memory.size", /*AllowInternal=*/true);
+  if (!Update || !MemorySize) {
+    return llvm::PreservedAnalyses::all();
+  }
+
+  MemorySizeCoalescer Coalescer(Update, MemorySize);
+  if (!Coalescer.findReaders(M)) {
+    return llvm::PreservedAnalyses::all();
+  }
+  if (!Coalescer.hasReaders()) {
+    return Coalescer.dropAll() ? llvm::PreservedAnalyses::none()
+                               : llvm::PreservedAnalyses::all();
+  }
+
+  auto &FAM =
+      MAM.getResult<llvm::FunctionAnalysisManagerModuleProxy>(M).getManager();
+  bool Changed = false;
+  for (llvm::Function &F : M) {
+    if (F.isDeclaration() || &F == Update) {
+      continue;
+    }
+    for (llvm::BasicBlock &BB : F) {
+      Changed |= Coalescer.coalesce(BB);
+    }
+    // Sink out of the outermost loops that cannot read memory.size.
+    auto &LI = FAM.getResult<llvm::LoopAnalysis>(F);
+    llvm::SmallVector<llvm::Loop *, 8> Worklist(LI.begin(), LI.end());
+    while (!Worklist.empty()) {
+      llvm::Loop *L = Worklist.pop_back_val();
+      const bool Observed =
+          llvm::any_of(L->blocks(), [&](llvm::BasicBlock *BB) {
+            return llvm::any_of(*BB, [&](llvm::Instruction &I) {
+              return Coalescer.observes(I);
+            });
+          });
+      if (!Observed) {
+        Changed |= Coalescer.sinkOutOfLoop(*L);
+      } else {
+        Worklist.append(L->begin(), L->end());
+      }
+    }
+  }
+  if (!Changed) {
+    return llvm::PreservedAnalyses::all();
+  }
+  llvm::PreservedAnalyses PA;
+  PA.preserveSet<llvm::CFGAnalyses>();
+  return PA;
+}
+
+} // namespace soll
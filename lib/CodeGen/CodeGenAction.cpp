@@ -1,16 +1,25 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 #include "soll/CodeGen/CodeGenAction.h"
+#include "soll/Basic/DiagnosticFrontend.h"
 #include "soll/Basic/SourceManager.h"
 #include "soll/Basic/TargetOptions.h"
 #include "soll/CodeGen/ModuleBuilder.h"
 #include "soll/Frontend/CompilerInstance.h"
 #include "llvm/Support/Alignment.h"
 #include <lld/Common/Driver.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/IR/ConstantFolder.h>
 #include <llvm/IR/DiagnosticInfo.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
 #include <llvm/Support/ToolOutputFile.h>
 #include <llvm/Transforms/Utils/Cloning.h>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 extern "C" {
@@ -26,21 +35,30 @@ void BinaryenSetShrinkLevel(int level);
 void BinaryenSetDebugInfo(int on);
 }
 
-namespace {
-llvm::Error removeExports(const std::string &Filename) {
-  BinaryenModuleRef WasmModule;
-  size_t BufferSize = 0;
+#define DEBUG_TYPE "soll-backend"
+
+#if LLVM_VERSION_MAJOR >= 10
+ALWAYS_ENABLED_STATISTIC(NumBytesWrittenToDisk,
+                         "Number of bytes written to temporary files");
+ALWAYS_ENABLED_STATISTIC(NumBytesReadFromDisk,
+                         "Number of bytes read back from temporary files");
+#else
+STATISTIC(NumBytesWrittenToDisk, "Number of bytes written to temporary files");
+STATISTIC(NumBytesReadFromDisk,
+          "Number of bytes read back from temporary files");
+#endif
 
-  {
-    auto Binary = llvm::MemoryBuffer::getFile(Filename);
-    if (!Binary) {
-      return llvm::errorCodeToError(Binary.getError());
-    }
+namespace {
+/// lld and Binaryen both keep process-wide state, so linking and wasm
+/// post-processing must not overlap between backend jobs.
+std::mutex LinkMutex;
 
-    auto Buffer = (*Binary)->getBuffer();
-    BufferSize = Buffer.size();
-    WasmModule = BinaryenModuleRead(Buffer.data(), Buffer.size());
-  }
+/// Strip linker-synthesized exports from a linked wasm binary, entirely in
+/// memory.
+llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+removeExports(llvm::StringRef Binary) {
+  BinaryenModuleRef WasmModule =
+      BinaryenModuleRead(Binary.data(), Binary.size());
 
   BinaryenRemoveExport(WasmModule, "__heap_base");
   BinaryenRemoveExport(WasmModule, "__data_end");
@@ -48,23 +66,121 @@ llvm::Error removeExports(const std::string &Filename) {
   BinaryenSetShrinkLevel(0);
   BinaryenModuleOptimize(WasmModule);
 
-  std::vector<char> OutputBuffer(BufferSize);
-  auto Size =
-      BinaryenModuleWrite(WasmModule, OutputBuffer.data(), OutputBuffer.size());
+  auto OutputBuffer = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(
+      Binary.size(), "removeExports");
+  if (!OutputBuffer) {
+    BinaryenModuleDispose(WasmModule);
+    return llvm::errorCodeToError(
+        std::make_error_code(std::errc::not_enough_memory));
+  }
+  auto Size = BinaryenModuleWrite(WasmModule, OutputBuffer->getBufferStart(),
+                                  OutputBuffer->getBufferSize());
   BinaryenModuleDispose(WasmModule);
 
-  std::error_code EC;
-  auto WasmStream = llvm::raw_fd_ostream(Filename, EC);
-  if (EC) {
-    return llvm::errorCodeToError(EC);
+  return llvm::MemoryBuffer::getMemBufferCopy(
+      llvm::StringRef(OutputBuffer->getBufferStart(), Size), "wasm");
+}
+
+/// Copy into a new module only the globals reachable from \p Roots, in the
+/// spirit of llvm-extract. Function bodies that no root can reach are never
+/// cloned.
+std::unique_ptr<llvm::Module>
+extractReachable(const llvm::Module &M, llvm::ArrayRef<std::string> Roots) {
+  llvm::SmallPtrSet<const llvm::GlobalValue *, 32> Reachable;
+  llvm::SmallPtrSet<const llvm::Constant *, 32> VisitedConstants;
+  llvm::SmallVector<const llvm::GlobalValue *, 64> Worklist;
+
+  std::function<void(const llvm::Value *)> Visit = [&](const llvm::Value *V) {
+    if (const auto *GV = llvm::dyn_cast<llvm::GlobalValue>(V)) {
+      if (Reachable.insert(GV).second) {
+        Worklist.push_back(GV);
+      }
+      return;
+    }
+    if (const auto *C = llvm::dyn_cast<llvm::Constant>(V)) {
+      if (VisitedConstants.insert(C).second) {
+        for (const llvm::Use &Op : C->operands()) {
+          Visit(Op.get());
+        }
+      }
+    }
+  };
+
+  for (const auto &Name : Roots) {
+    if (const auto *GV = M.getNamedValue(Name)) {
+      Visit(GV);
+    }
+  }
+
+  while (!Worklist.empty()) {
+    const llvm::GlobalValue *GV = Worklist.pop_back_val();
+    if (const auto *F = llvm::dyn_cast<llvm::Function>(GV)) {
+      for (const llvm::BasicBlock &BB : *F) {
+        for (const llvm::Instruction &I : BB) {
+          for (const llvm::Use &Op : I.operands()) {
+            Visit(Op.get());
+          }
+        }
+      }
+    } else if (const auto *Var = llvm::dyn_cast<llvm::GlobalVariable>(GV)) {
+      if (Var->hasInitializer()) {
+        Visit(Var->getInitializer());
+      }
+    } else if (const auto *GA = llvm::dyn_cast<llvm::GlobalAlias>(GV)) {
+      Visit(GA->getAliasee());
+    }
+  }
+
+  llvm::ValueToValueMapTy VMap;
+  auto Extracted =
+      llvm::CloneModule(M, VMap, [&Reachable](const llvm::GlobalValue *GV) {
+        return Reachable.count(GV) != 0;
+      });
+
+  // Unreachable globals were only cloned as declarations; nothing reachable
+  // refers to them, so drop them as well.
+  std::vector<llvm::GlobalValue *> Unused;
+  for (const llvm::GlobalValue &GV : M.global_values()) {
+    if (Reachable.count(&GV)) {
+      continue;
+    }
+    if (auto *NewGV = llvm::dyn_cast_or_null<llvm::GlobalValue>(VMap[&GV])) {
+      if (NewGV->use_empty()) {
+        Unused.push_back(NewGV);
+      }
+    }
+  }
+  for (auto *GV : Unused) {
+    GV->eraseFromParent();
   }
-  WasmStream.write(OutputBuffer.data(), Size);
-  return llvm::Error::success();
+
+  return Extracted;
 }
 } // namespace
 
 namespace soll {
 
+namespace {
+/// Collects diagnostics reported by a backend job so they can be replayed
+/// into the shared DiagnosticsEngine in entry order.
+class StoredDiagnosticBuffer : public DiagnosticConsumer {
+  std::vector<StoredDiagnostic> Diags;
+
+public:
+  void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(Level, Info);
+    Diags.emplace_back(Level, Info);
+  }
+
+  void FlushDiagnostics(DiagnosticsEngine &Engine) const {
+    for (const auto &Diag : Diags) {
+      Engine.Report(Diag);
+    }
+  }
+};
+} // namespace
+
 class BackendConsumer;
 class SollDiagnosticHandler final : public llvm::DiagnosticHandler {
   BackendConsumer *BackendCon;
@@ -139,28 +255,44 @@ private:
   }
 
   llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
-  compileAndLink(llvm::Module &Module) {
-    auto Object = llvm::sys::fs::TempFile::create(InFile + "-%%%%%%%%%%.o");
-    if (!Object) {
-      return Object.takeError();
+  compileAndLink(llvm::Module &Module, DiagnosticsEngine &Diags) {
+    llvm::SmallString<0> Object;
+    EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, Module.getDataLayout(),
+                      &Module, BackendAction::EmitObj,
+                      std::make_unique<llvm::raw_svector_ostream>(Object));
+
+    std::lock_guard<std::mutex> Lock(LinkMutex);
+    auto Linked = linkObject(Object);
+    if (!Linked) {
+      return Linked.takeError();
+    }
+    return removeExports((*Linked)->getBuffer());
+  }
+
+  /// Link a single wasm object into an executable module. lld only accepts
+  /// file paths, so this still writes the object to a temporary file and
+  /// reads the linked module back from another; linking is not in memory.
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+  linkObject(llvm::StringRef Object) {
+    auto ObjectFile =
+        llvm::sys::fs::TempFile::create(InFile + "-%%%%%%%%%%.o");
+    if (!ObjectFile) {
+      return ObjectFile.takeError();
     }
 
-    auto Wasm = llvm::sys::fs::TempFile::create(InFile + "-%%%%%%%%%%.wasm");
-    if (!Wasm) {
-      llvm::consumeError(Object->discard());
-      return Wasm.takeError();
+    auto WasmFile =
+        llvm::sys::fs::TempFile::create(InFile + "-%%%%%%%%%%.wasm");
+    if (!WasmFile) {
+      llvm::consumeError(ObjectFile->discard());
+      return WasmFile.takeError();
     }
 
-    std::error_code EC;
-    auto OutStream =
-        std::make_unique<llvm::raw_fd_ostream>(Object->TmpName, EC);
-    if (EC) {
-      llvm::consumeError(Wasm->discard());
-      llvm::consumeError(Object->discard());
-      return llvm::errorCodeToError(EC);
+    {
+      llvm::raw_fd_ostream OS(ObjectFile->FD, /*shouldClose*/ false);
+      OS << Object;
     }
-    EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, Module.getDataLayout(),
-                      &Module, BackendAction::EmitObj, std::move(OutStream));
+    NumBytesWrittenToDisk += Object.size();
+
     const char *Args[] = {
       "wasm-ld",
       "--entry",
@@ -171,24 +303,117 @@ private:
       // workaround for https://reviews.llvm.org/D63833
       "--export=__heap_base",
 #endif
-      Object->TmpName.c_str(),
+      ObjectFile->TmpName.c_str(),
       "-o",
-      Wasm->TmpName.c_str()
+      WasmFile->TmpName.c_str()
     };
     lld::wasm::link(llvm::ArrayRef<const char *>(Args), false, llvm::outs(),
                     llvm::errs());
 
-    if (auto Error = removeExports(Wasm->TmpName)) {
-      llvm::consumeError(Wasm->discard());
-      llvm::consumeError(Object->discard());
-      return Error;
+    auto Binary = llvm::MemoryBuffer::getFile(WasmFile->TmpName);
+
+    llvm::consumeError(WasmFile->discard());
+    llvm::consumeError(ObjectFile->discard());
+    if (!Binary) {
+      return llvm::errorCodeToError(Binary.getError());
     }
+    // lld wrote the linked module before it was read back.
+    NumBytesWrittenToDisk += (*Binary)->getBufferSize();
+    NumBytesReadFromDisk += (*Binary)->getBufferSize();
+    return std::move(*Binary);
+  }
 
-    auto Binary = llvm::MemoryBuffer::getFile(Wasm->TmpName);
+  /// Backend result of one entry, kept until it can be written out.
+  struct EntryOutput {
+    llvm::SmallString<0> Buffer;
+    std::string Error;
+  };
+
+  /// State owned by one parallel backend job.
+  struct EntryJob {
+    llvm::SmallString<0> Bitcode;
+    StoredDiagnosticBuffer Buffer;
+    std::unique_ptr<DiagnosticsEngine> Diags;
+    EntryOutput Output;
+
+    explicit EntryJob(DiagnosticsEngine &Parent)
+        : Diags(std::make_unique<DiagnosticsEngine>(
+              Parent.getDiagnosticIDs(), &Parent.getDiagnosticOptions(),
+              &Buffer, false)) {}
+  };
+
+  /// Compile the nested objects belonging to entry \p E into \p Module, then
+  /// run the backend on the entry itself. Touches nothing but \p Module,
+  /// \p Diags and \p Output, so entries in separate contexts may run
+  /// concurrently.
+  void compileEntry(llvm::Module &Module,
+                    const std::pair<std::string, const Decl *> &E,
+                    DiagnosticsEngine &Diags, EntryOutput &Output) {
+    if (TargetOpts.BackendTarget == EWASM) {
+      for (const auto &[EntryName, FuncName, DeclPtr] :
+           Gen->getNestedEntries()) {
+        if (DeclPtr != E.second) {
+          continue;
+        }
+        auto ClonedModule = extractReachable(Module, {EntryName});
+        emitEntry(*ClonedModule, EntryName);
 
-    llvm::consumeError(Wasm->discard());
-    llvm::consumeError(Object->discard());
-    return std::move(*Binary);
+        auto Binary = compileAndLink(*ClonedModule, Diags);
+        if (!Binary) {
+          Output.Error = llvm::toString(Binary.takeError());
+          return;
+        }
+
+        emitNestedBytecodeFunction(Module, FuncName, (*Binary)->getBuffer());
+      }
+    }
+
+    emitEntry(Module, E.first);
+    if (Action == BackendAction::EmitWasm) {
+      auto Binary = compileAndLink(Module, Diags);
+      if (!Binary) {
+        Output.Error = llvm::toString(Binary.takeError());
+        return;
+      }
+      Output.Buffer = (*Binary)->getBuffer();
+    } else {
+      EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, Module.getDataLayout(),
+                        &Module, Action,
+                        std::make_unique<llvm::raw_svector_ostream>(
+                            Output.Buffer));
+    }
+  }
+
+  /// Functions that must survive extraction of the module for entry \p E:
+  /// the entry itself and the nested objects compiled out of it.
+  std::vector<std::string>
+  getEntryRoots(const std::pair<std::string, const Decl *> &E) const {
+    std::vector<std::string> Roots = {E.first};
+    for (const auto &[EntryName, FuncName, DeclPtr] :
+         Gen->getNestedEntries()) {
+      if (DeclPtr == E.second) {
+        Roots.push_back(EntryName);
+      }
+    }
+    return Roots;
+  }
+
+  bool writeEntryOutput(const std::pair<std::string, const Decl *> &E,
+                        const EntryOutput &Output) {
+    if (!Output.Error.empty()) {
+      Diags.Report(diag::err_fe_backend_failed) << Output.Error;
+      return false;
+    }
+    std::string OutName = "";
+    if (auto *CD = dynamic_cast<const ContractDecl *>(E.second)) {
+      OutName = CD->getName();
+    }
+    std::unique_ptr<llvm::raw_pwrite_stream> AsmOutStream =
+        GetOutputStreamCallback(InFile, Action, OutName);
+    if (AsmOutStream) {
+      (*AsmOutStream) << Output.Buffer;
+    }
+    return true;
   }
 
 public:
@@ -222,53 +447,60 @@ public:
       return;
     }
 
-    std::vector<std::unique_ptr<llvm::Module>> ClonedModules;
-    std::unordered_map<const Decl *, llvm::Module *> ClonedModuleMap(
-        {{nullptr, getModule()}});
-
-    for (const auto &E : Gen->getEntry()) {
-      ClonedModules.emplace_back(llvm::CloneModule(*getModule()));
-      ClonedModuleMap[E.second] = ClonedModules.back().get();
+    const auto &Entries = Gen->getEntry();
+    unsigned NumThreads = CodeGenOpts.NumThreads;
+    if (NumThreads == 0) {
+      NumThreads = std::max(1u, std::thread::hardware_concurrency());
     }
 
-    if (TargetOpts.BackendTarget == EWASM) {
-      for (const auto &[EntryName, FuncName, DeclPtr] :
-           Gen->getNestedEntries()) {
-        auto Module = ClonedModuleMap.at(DeclPtr);
-        auto ClonedModule = llvm::CloneModule(*Module);
-        emitEntry(*ClonedModule, EntryName);
-
-        auto Binary = compileAndLink(*ClonedModule);
-        if (!Binary) {
-          llvm::errs() << Binary.takeError() << '\n';
+    if (NumThreads <= 1 || Entries.size() <= 1) {
+      for (const auto &E : Entries) {
+        auto Module = extractReachable(*getModule(), getEntryRoots(E));
+        EntryOutput Output;
+        compileEntry(*Module, E, Diags, Output);
+        if (!writeEntryOutput(E, Output)) {
           return;
         }
-
-        emitNestedBytecodeFunction(*Module, FuncName, (*Binary)->getBuffer());
       }
+      return;
     }
 
-    for (const auto &E : Gen->getEntry()) {
-      auto Module = ClonedModuleMap.at(E.second);
-      std::string OutName = "";
-      if (auto *CD = dynamic_cast<const ContractDecl *>(E.second)) {
-        OutName = CD->getName();
+    // Hand each job a private copy of its entry's module in its own
+    // LLVMContext through bitcode.
+    std::vector<std::unique_ptr<EntryJob>> Jobs;
+    Jobs.reserve(Entries.size());
+    for (const auto &E : Entries) {
+      Jobs.emplace_back(std::make_unique<EntryJob>(Diags));
+      auto Module = extractReachable(*getModule(), getEntryRoots(E));
+      llvm::raw_svector_ostream OS(Jobs.back()->Bitcode);
+      llvm::WriteBitcodeToFile(*Module, OS);
+    }
+
+    {
+#if LLVM_VERSION_MAJOR >= 11
+      llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+#else
+      llvm::ThreadPool Pool(NumThreads);
+#endif
+      for (size_t I = 0; I < Entries.size(); ++I) {
+        Pool.async([this, &E = Entries[I], &Job = *Jobs[I]]() {
+          llvm::LLVMContext VMContext;
+          auto Module = llvm::parseBitcodeFile(
+              llvm::MemoryBufferRef(Job.Bitcode.str(), InFile), VMContext);
+          if (!Module) {
+            Job.Output.Error = llvm::toString(Module.takeError());
+            return;
+          }
+          compileEntry(**Module, E, *Job.Diags, Job.Output);
+        });
       }
-      emitEntry(*Module, E.first);
-      std::unique_ptr<llvm::raw_pwrite_stream> AsmOutStream =
-          GetOutputStreamCallback(InFile, Action, OutName);
-      if (Action == BackendAction::EmitWasm) {
-        auto Binary = compileAndLink(*Module);
-        if (!Binary) {
-          llvm::errs() << Binary.takeError() << '\n';
-          return;
-        }
-        (*AsmOutStream) << (*Binary)->getBuffer();
-        AsmOutStream.reset();
-      } else {
-        EmitBackendOutput(Diags, CodeGenOpts, TargetOpts,
-                          Module->getDataLayout(), Module, Action,
-                          std::move(AsmOutStream));
+      Pool.wait();
+    }
+
+    for (size_t I = 0; I < Entries.size(); ++I) {
+      Jobs[I]->Buffer.FlushDiagnostics(Diags);
+      if (!writeEntryOutput(Entries[I], Jobs[I]->Output)) {
+        return;
       }
     }
   }
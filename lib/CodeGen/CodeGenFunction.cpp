@@ -9,6 +9,7 @@ void CodeGenFunction::generateCode(const FunctionDecl *FD, llvm::Function *Fn) {
   llvm::BasicBlock *EntryBB = createBasicBlock("entry", Fn);
   ReturnBlock = createBasicBlock("return", Fn);
   Builder.SetInsertPoint(EntryBB);
+  CGM.emitProfileCounter(CGM.getProfileID(FD));
   emitCheckPayable(FD);
   llvm::Argument *PsLLVM = Fn->arg_begin();
   for (auto *VD : FD->getParams()->getParams()) {
@@ -196,8 +197,9 @@ llvm::Value *CodeGenFunction::emitVarDecl(const Decl *VD) {
     Ty = D->getType();
   auto *LLVMTy = CGM.getLLVMType(Ty.get());
 
-  llvm::Value *Addr =
-      Builder.CreateAlloca(LLVMTy, nullptr, VD->getName() + ".addr");
+  // Locals declared in loops get one slot for all iterations; the store
+  // below resets it each time.
+  llvm::Value *Addr = CGM.createEntryAlloca(LLVMTy, VD->getName() + ".addr");
   setAddrOfLocalVar(VD, Addr);
   switch (Ty->getCategory()) {
   case Type::Category::Bool:
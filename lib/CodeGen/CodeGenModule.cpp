@@ -2,10 +2,20 @@
 #include "CodeGenModule.h"
 #include "ABICodec.h"
 #include "CodeGenFunction.h"
+#include "soll/AST/StmtVisitor.h"
+#include "soll/Basic/Diagnostic.h"
+#include "soll/Basic/DiagnosticCodeGen.h"
+#include "soll/Basic/DiagnosticFrontend.h"
 #include <llvm/ADT/APInt.h>
 #include <llvm/IR/Attributes.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+#include <limits>
+#include <numeric>
 
 /*
 // for testing purpose
@@ -41,6 +51,21 @@ enum {
 
 namespace soll::CodeGen {
 
+/// Keccak-256 absorbs 136 bytes per permutation of its 25 64-bit lanes.
+constexpr unsigned KeccakRate = 136;
+constexpr unsigned KeccakLanes = 25;
+constexpr unsigned KeccakRounds = 24;
+
+/// Contracts with at least this many public functions dispatch through a
+/// perfect hash of the selector by default.
+constexpr std::size_t DispatchPHFThreshold = 8;
+/// The perfect hash table has at most 2^DispatchPHFExtraBits slots per
+/// selector.
+constexpr unsigned DispatchPHFExtraBits = 3;
+/// With a profile, selectors and functions that take at least
+/// 1/ProfileHotShare of the contract's calls are hot.
+constexpr std::uint64_t ProfileHotShare = 5;
+
 CodeGenModule::CodeGenModule(
     ASTContext &C, llvm::Module &M,
     std::vector<std::pair<std::string, const Decl *>> &E,
@@ -49,8 +74,7 @@ CodeGenModule::CodeGenModule(
     const TargetOptions &TargetOpts)
     : Context(C), TheModule(M), CurrentYulObject(nullptr), Entry(E),
       NestedEntries(NE), Diags(Diags), CodeGenOpts(CodeGenOpts),
-      TargetOpts(TargetOpts), VMContext(M.getContext()), Builder(VMContext),
-      StateVarAddrCursor(0) {
+      TargetOpts(TargetOpts), VMContext(M.getContext()), Builder(VMContext) {
   initTypes();
   if (isEVM()) {
     initEVMOpcodeDeclaration();
@@ -60,6 +84,54 @@ CodeGenModule::CodeGenModule(
   }
   initHelperDeclaration();
   initPrebuiltContract();
+  loadProfile();
+}
+
+/// Reads the -fprofile-use trace. Each line holds a profile ID printed by a
+/// -fprofile-generate build, optionally followed by how many times it was
+/// seen, so raw traces and aggregated counts can be mixed; '#' starts a
+/// comment.
+void CodeGenModule::loadProfile() {
+  const std::string &Path = CodeGenOpts.ProfileUse;
+  if (Path.empty()) {
+    return;
+  }
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer) {
+    Diags.Report(diag::err_fe_error_opening)
+        << Path << Buffer.getError().message();
+    return;
+  }
+  llvm::SmallVector<llvm::StringRef, 0> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n');
+  for (std::size_t I = 0; I < Lines.size(); ++I) {
+    llvm::StringRef Line = Lines[I].split('#').first.trim();
+    if (Line.empty()) {
+      continue;
+    }
+    const auto [IDText, CountText] = Line.split(' ');
+    std::uint32_t ID;
+    std::uint64_t Count = 1;
+    if (IDText.getAsInteger(0, ID) ||
+        (!CountText.empty() && CountText.trim().getAsInteger(0, Count))) {
+      Diags.Report(diag::err_malformed_profile)
+          << Path << static_cast<unsigned>(I + 1);
+      ProfileCounts.clear();
+      return;
+    }
+    ProfileCounts[ID] += Count;
+  }
+  HasProfile = true;
+}
+
+std::uint32_t CodeGenModule::getProfileID(const FunctionDecl *FD) {
+  return static_cast<std::uint32_t>(llvm::MD5Hash(getMangledName(FD)));
+}
+
+void CodeGenModule::emitProfileCounter(std::uint32_t ID) {
+  if (CodeGenOpts.ProfileGenerate && isEWASM()) {
+    Builder.CreateCall(Func_print32, {Builder.getInt32(ID)});
+  }
 }
 
 void CodeGenModule::initTypes() {
@@ -109,11 +181,12 @@ void CodeGenModule::initTypes() {
 }
 
 void CodeGenModule::initMemorySection() {
-  MemorySize = new llvm::GlobalVariable(TheModule, Int256Ty, false,
+  // Wasm memory is addressed with 32 bits, so that is all msize can reach.
+  MemorySize = new llvm::GlobalVariable(TheModule, Int32Ty, false,
                                         llvm::GlobalVariable::PrivateLinkage,
-                                        Builder.getIntN(256, 0), "memory.size");
+                                        Builder.getInt32(0), "memory.size");
   MemorySize->setUnnamedAddr(llvm::GlobalVariable::UnnamedAddr::Global);
-  MemorySize->setAlignment(llvm::MaybeAlign(256));
+  MemorySize->setAlignment(llvm::MaybeAlign(4));
 
   HeapBase = new llvm::GlobalVariable(TheModule, Int8Ty, false,
                                       llvm::GlobalVariable::ExternalLinkage,
@@ -121,7 +194,7 @@ void CodeGenModule::initMemorySection() {
   HeapBase->setAlignment(llvm::MaybeAlign(1));
 
   Func_updateMemorySize = llvm::Function::Create(
-      llvm::FunctionType::get(VoidTy, {Int256Ty, Int256Ty}, false),
+      llvm::FunctionType::get(VoidTy, {Int32Ty, Int32Ty}, false),
       llvm::Function::InternalLinkage, "solidity.updateMemorySize", TheModule);
   Func_updateMemorySize->addFnAttr(llvm::Attribute::NoUnwind);
   initUpdateMemorySize();
@@ -155,16 +228,18 @@ void CodeGenModule::initUpdateMemorySize() {
   llvm::BasicBlock *Done =
       llvm::BasicBlock::Create(VMContext, "done", Func_updateMemorySize);
   Builder.SetInsertPoint(Entry);
-  llvm::Value *OrigSize = Builder.CreateLoad(MemorySize, "memory.size");
+  llvm::Value *OrigSize =
+      Builder.CreateLoad(Int32Ty, MemorySize, "memory.size");
   llvm::Value *EndPos = Builder.CreateAdd(Pos, Range);
   llvm::Value *Condition = Builder.CreateICmpUGT(EndPos, OrigSize);
   Builder.CreateCondBr(Condition, Update, Done);
   Builder.SetInsertPoint(Update);
-  llvm::ConstantInt *Mask =
-      Builder.getInt(llvm::APInt::getHighBitsSet(256, 251));
-  llvm::Value *Base = Builder.CreateAnd(EndPos, Mask);
-  llvm::Value *NewSize =
-      Builder.CreateAdd(Base, Builder.getIntN(256, 32), "memory.new_size");
+  // Round up to whole words. Updating with the largest end at once then has
+  // the same effect as updating with each end in turn, which is what lets
+  // CoalesceMemorySize merge the calls.
+  llvm::Value *Rounded = Builder.CreateAdd(EndPos, Builder.getInt32(31));
+  llvm::Value *NewSize = Builder.CreateAnd(Rounded, Builder.getInt32(~31u),
+                                           "memory.new_size");
   Builder.CreateStore(NewSize, MemorySize);
   Builder.CreateBr(Done);
   Builder.SetInsertPoint(Done);
@@ -174,7 +249,7 @@ void CodeGenModule::initUpdateMemorySize() {
 llvm::Function *CodeGenModule::getIntrinsic(unsigned IID,
                                             llvm::ArrayRef<llvm::Type *> Typs) {
   return llvm::Intrinsic::getDeclaration(
-      &TheModule, static_cast<llvm::Intrinsic::ID>(IID), llvm::None);
+      &TheModule, static_cast<llvm::Intrinsic::ID>(IID), Typs);
 }
 
 void CodeGenModule::initEVMOpcodeDeclaration() {
@@ -829,6 +904,9 @@ void CodeGenModule::initHelperDeclaration() {
         llvm::Function::InternalLinkage, "solidity.bswapi256", TheModule);
     Func_bswap256->addFnAttr(llvm::Attribute::NoUnwind);
     Func_bswap256->addFnAttr(llvm::Attribute::ReadNone);
+    // Every endian conversion shares one copy of the 64-bit swaps, which
+    // wasm has to spell out as shifts and masks.
+    Func_bswap256->addFnAttr(llvm::Attribute::NoInline);
     initBswapI256();
   } else {
     Func_exp256 = nullptr;
@@ -853,6 +931,12 @@ void CodeGenModule::initExpI256() {
       llvm::BasicBlock::Create(VMContext, "entry", Func_exp256);
   llvm::BasicBlock *Loop =
       llvm::BasicBlock::Create(VMContext, "loop", Func_exp256);
+  llvm::BasicBlock *Multiply =
+      llvm::BasicBlock::Create(VMContext, "multiply", Func_exp256);
+  llvm::BasicBlock *Next =
+      llvm::BasicBlock::Create(VMContext, "next", Func_exp256);
+  llvm::BasicBlock *Square =
+      llvm::BasicBlock::Create(VMContext, "square", Func_exp256);
   llvm::BasicBlock *Return =
       llvm::BasicBlock::Create(VMContext, "return", Func_exp256);
 
@@ -864,37 +948,58 @@ void CodeGenModule::initExpI256() {
     Builder.CreateCondBr(IsZero, Return, Loop);
   }
 
-  llvm::Value *NewResult;
+  // Square-and-multiply: the result is only multiplied for set bits, and
+  // the base is not squared past the top bit.
+  llvm::PHINode *ResultPHI;
+  llvm::PHINode *PartPHI;
+  llvm::PHINode *ExpPHI;
   {
     Builder.SetInsertPoint(Loop);
-    llvm::PHINode *ResultPHI = Builder.CreatePHI(Int256Ty, 2);
-    llvm::PHINode *PartPHI = Builder.CreatePHI(Int256Ty, 2);
-    llvm::PHINode *ExpPHI = Builder.CreatePHI(Int256Ty, 2);
-
+    ResultPHI = Builder.CreatePHI(Int256Ty, 2);
+    PartPHI = Builder.CreatePHI(Int256Ty, 2);
+    ExpPHI = Builder.CreatePHI(Int256Ty, 2);
     llvm::Value *BitSet = Builder.CreateTrunc(ExpPHI, Builder.getInt1Ty());
-    llvm::Value *BIsZero = Builder.CreateICmpEQ(BitSet, Builder.getInt1(false));
-    llvm::Value *Mul = Builder.CreateSelect(BIsZero, One, PartPHI);
-    NewResult = Builder.CreateMul(ResultPHI, Mul);
+    Builder.CreateCondBr(BitSet, Multiply, Next);
+  }
+
+  llvm::Value *Product;
+  {
+    Builder.SetInsertPoint(Multiply);
+    Product = Builder.CreateMul(ResultPHI, PartPHI);
+    Builder.CreateBr(Next);
+  }
+
+  llvm::PHINode *NewResult;
+  llvm::Value *NewExp;
+  {
+    Builder.SetInsertPoint(Next);
+    NewResult = Builder.CreatePHI(Int256Ty, 2);
+    NewResult->addIncoming(ResultPHI, Loop);
+    NewResult->addIncoming(Product, Multiply);
+    NewExp = Builder.CreateLShr(ExpPHI, One);
+    llvm::Value *IsZero = Builder.CreateICmpEQ(NewExp, Zero);
+    Builder.CreateCondBr(IsZero, Return, Square);
+  }
+
+  {
+    Builder.SetInsertPoint(Square);
     llvm::Value *NewPart = Builder.CreateMul(PartPHI, PartPHI);
-    llvm::Value *NewExp = Builder.CreateLShr(ExpPHI, One);
+    Builder.CreateBr(Loop);
 
     ResultPHI->addIncoming(One, Entry);
-    ResultPHI->addIncoming(NewResult, Loop);
+    ResultPHI->addIncoming(NewResult, Square);
     PartPHI->addIncoming(Base, Entry);
-    PartPHI->addIncoming(NewPart, Loop);
+    PartPHI->addIncoming(NewPart, Square);
     ExpPHI->addIncoming(Exp, Entry);
-    ExpPHI->addIncoming(NewExp, Loop);
-
-    llvm::Value *IsZero = Builder.CreateICmpEQ(NewExp, Zero);
-    Builder.CreateCondBr(IsZero, Return, Loop);
+    ExpPHI->addIncoming(NewExp, Square);
   }
 
   {
     Builder.SetInsertPoint(Return);
-    llvm::PHINode *ResultPHI = Builder.CreatePHI(Int256Ty, 2);
-    ResultPHI->addIncoming(One, Entry);
-    ResultPHI->addIncoming(NewResult, Loop);
-    Builder.CreateRet(ResultPHI);
+    llvm::PHINode *RetPHI = Builder.CreatePHI(Int256Ty, 2);
+    RetPHI->addIncoming(One, Entry);
+    RetPHI->addIncoming(NewResult, Next);
+    Builder.CreateRet(RetPHI);
   }
 }
 
@@ -906,21 +1011,19 @@ void CodeGenModule::initBswapI256() {
       llvm::BasicBlock::Create(VMContext, "entry", Func_bswap256);
   Builder.SetInsertPoint(Entry);
 
-  llvm::Value *Data[32];
-  for (size_t I = 0; I < 32; ++I) {
-    if (I < 16) {
-      Data[I] = Builder.CreateShl(Arg, 248 - I * 16);
-    } else {
-      Data[I] = Builder.CreateLShr(Arg, I * 16 - 248);
-    }
-    if (I != 0 && I != 31) {
-      Data[I] = Builder.CreateAnd(Data[I], llvm::APInt(256, 0xFF, false)
-                                               << ((31 - I) * 8));
+  // Swap the bytes of each 64-bit limb and reverse the limb order.
+  llvm::Function *Bswap64 = llvm::Intrinsic::getDeclaration(
+      &TheModule, llvm::Intrinsic::bswap, {Int64Ty});
+  llvm::Value *Result = nullptr;
+  for (unsigned I = 0; I < 4; ++I) {
+    llvm::Value *Limb = Builder.CreateTrunc(
+        I == 0 ? Arg : Builder.CreateLShr(Arg, I * 64), Int64Ty);
+    llvm::Value *Swapped = Builder.CreateZExt(
+        Builder.CreateCall(Bswap64, {Limb}), Int256Ty);
+    if (I != 3) {
+      Swapped = Builder.CreateShl(Swapped, (3 - I) * 64);
     }
-  }
-  llvm::Value *Result = Builder.CreateOr(Data[0], Data[1]);
-  for (size_t I = 2; I < 32; ++I) {
-    Result = Builder.CreateOr(Result, Data[I]);
+    Result = Result ? Builder.CreateOr(Result, Swapped) : Swapped;
   }
 
   Builder.CreateRet(Result);
@@ -930,44 +1033,122 @@ void CodeGenModule::initMemcpy() {
   llvm::Argument *const Dst = Func_memcpy->arg_begin();
   llvm::Argument *const Src = Dst + 1;
   llvm::Argument *const Length = Src + 1;
-  llvm::ConstantInt *const One = Builder.getInt32(1);
   Dst->setName("dst");
   Src->setName("src");
   Length->setName("length");
 
   llvm::BasicBlock *Entry =
       llvm::BasicBlock::Create(VMContext, "entry", Func_memcpy);
-  llvm::BasicBlock *Loop =
-      llvm::BasicBlock::Create(VMContext, "loop", Func_memcpy);
-  llvm::BasicBlock *Return =
-      llvm::BasicBlock::Create(VMContext, "return", Func_memcpy);
 
+  if (isEVM()) {
+    // EVM bytes are addressed by element, copy one element per iteration.
+    llvm::ConstantInt *const One = Builder.getInt32(1);
+    llvm::BasicBlock *Loop =
+        llvm::BasicBlock::Create(VMContext, "loop", Func_memcpy);
+    llvm::BasicBlock *Return =
+        llvm::BasicBlock::Create(VMContext, "return", Func_memcpy);
+
+    Builder.SetInsertPoint(Entry);
+    llvm::Value *Cmp = Builder.CreateICmpNE(Length, Builder.getInt32(0));
+    Builder.CreateCondBr(Cmp, Loop, Return);
+
+    Builder.SetInsertPoint(Loop);
+    llvm::PHINode *SrcPHI = Builder.CreatePHI(BytesElemPtrTy, 2);
+    llvm::PHINode *DstPHI = Builder.CreatePHI(BytesElemPtrTy, 2);
+    llvm::PHINode *LengthPHI = Builder.CreatePHI(Int32Ty, 2);
+
+    llvm::Value *Value = Builder.CreateLoad(BytesElemTy, SrcPHI);
+    Builder.CreateStore(Value, DstPHI);
+    llvm::Value *Src2 = Builder.CreateInBoundsGEP(BytesElemTy, SrcPHI, {One});
+    llvm::Value *Dst2 = Builder.CreateInBoundsGEP(BytesElemTy, DstPHI, {One});
+    llvm::Value *Length2 = Builder.CreateSub(LengthPHI, One);
+    llvm::Value *Cmp2 = Builder.CreateICmpNE(Length2, Builder.getInt32(0));
+    Builder.CreateCondBr(Cmp2, Loop, Return);
+
+    Builder.SetInsertPoint(Return);
+    Builder.CreateRetVoid();
+
+    SrcPHI->addIncoming(Src, Entry);
+    SrcPHI->addIncoming(Src2, Loop);
+    DstPHI->addIncoming(Dst, Entry);
+    DstPHI->addIncoming(Dst2, Loop);
+    LengthPHI->addIncoming(Length, Entry);
+    LengthPHI->addIncoming(Length2, Loop);
+    return;
+  }
+
+  // Ewasm copies 32 bytes per iteration while it can, then 8, then single
+  // bytes. Pointers carry no alignment guarantee, but wasm permits
+  // unaligned i64 accesses.
+  struct CopyTier {
+    unsigned Width;
+    llvm::IntegerType *Ty;
+  };
+  const CopyTier Tiers[] = {{32, Int64Ty}, {8, Int64Ty}, {1, Int8Ty}};
+
+  llvm::BasicBlock *From = Entry;
+  llvm::Value *CurSrc = Src;
+  llvm::Value *CurDst = Dst;
+  llvm::Value *CurLength = Length;
   Builder.SetInsertPoint(Entry);
-  llvm::Value *Cmp = Builder.CreateICmpNE(Length, Builder.getInt32(0));
-  Builder.CreateCondBr(Cmp, Loop, Return);
+  for (const auto &Tier : Tiers) {
+    const std::string Suffix = std::to_string(Tier.Width);
+    llvm::BasicBlock *Loop =
+        llvm::BasicBlock::Create(VMContext, "loop" + Suffix, Func_memcpy);
+    llvm::BasicBlock *Done =
+        llvm::BasicBlock::Create(VMContext, "done" + Suffix, Func_memcpy);
+    llvm::ConstantInt *Width = Builder.getInt32(Tier.Width);
+    llvm::PointerType *PtrTy = llvm::PointerType::getUnqual(Tier.Ty);
+    const unsigned Step = Tier.Ty->getBitWidth() / 8;
+
+    Builder.CreateCondBr(Builder.CreateICmpUGE(CurLength, Width), Loop, Done);
 
-  Builder.SetInsertPoint(Loop);
-  llvm::PHINode *SrcPHI = Builder.CreatePHI(BytesElemPtrTy, 2);
-  llvm::PHINode *DstPHI = Builder.CreatePHI(BytesElemPtrTy, 2);
-  llvm::PHINode *LengthPHI = Builder.CreatePHI(Int32Ty, 2);
-
-  llvm::Value *Value = Builder.CreateLoad(SrcPHI);
-  Builder.CreateStore(Value, DstPHI);
-  llvm::Value *Src2 = Builder.CreateInBoundsGEP(SrcPHI, {One});
-  llvm::Value *Dst2 = Builder.CreateInBoundsGEP(DstPHI, {One});
-  llvm::Value *Length2 = Builder.CreateSub(LengthPHI, One);
-  llvm::Value *Cmp2 = Builder.CreateICmpNE(Length2, Builder.getInt32(0));
-  Builder.CreateCondBr(Cmp2, Loop, Return);
-
-  Builder.SetInsertPoint(Return);
+    Builder.SetInsertPoint(Loop);
+    llvm::PHINode *SrcPHI = Builder.CreatePHI(Int8PtrTy, 2);
+    llvm::PHINode *DstPHI = Builder.CreatePHI(Int8PtrTy, 2);
+    llvm::PHINode *LengthPHI = Builder.CreatePHI(Int32Ty, 2);
+    for (unsigned Offset = 0; Offset < Tier.Width; Offset += Step) {
+      llvm::Value *SrcPtr = Builder.CreateBitCast(
+          Builder.CreateInBoundsGEP(Int8Ty, SrcPHI, Builder.getInt32(Offset)),
+          PtrTy);
+      llvm::Value *DstPtr = Builder.CreateBitCast(
+          Builder.CreateInBoundsGEP(Int8Ty, DstPHI, Builder.getInt32(Offset)),
+          PtrTy);
+      llvm::Value *Value =
+          Builder.CreateAlignedLoad(Tier.Ty, SrcPtr, llvm::MaybeAlign(1));
+      Builder.CreateAlignedStore(Value, DstPtr, llvm::MaybeAlign(1));
+    }
+    llvm::Value *Src2 = Builder.CreateInBoundsGEP(Int8Ty, SrcPHI, Width);
+    llvm::Value *Dst2 = Builder.CreateInBoundsGEP(Int8Ty, DstPHI, Width);
+    llvm::Value *Length2 = Builder.CreateSub(LengthPHI, Width);
+    Builder.CreateCondBr(Builder.CreateICmpUGE(Length2, Width), Loop, Done);
+
+    SrcPHI->addIncoming(CurSrc, From);
+    SrcPHI->addIncoming(Src2, Loop);
+    DstPHI->addIncoming(CurDst, From);
+    DstPHI->addIncoming(Dst2, Loop);
+    LengthPHI->addIncoming(CurLength, From);
+    LengthPHI->addIncoming(Length2, Loop);
+
+    Builder.SetInsertPoint(Done);
+    if (Tier.Width == 1) {
+      break;
+    }
+    llvm::PHINode *NextSrc = Builder.CreatePHI(Int8PtrTy, 2);
+    llvm::PHINode *NextDst = Builder.CreatePHI(Int8PtrTy, 2);
+    llvm::PHINode *NextLength = Builder.CreatePHI(Int32Ty, 2);
+    NextSrc->addIncoming(CurSrc, From);
+    NextSrc->addIncoming(Src2, Loop);
+    NextDst->addIncoming(CurDst, From);
+    NextDst->addIncoming(Dst2, Loop);
+    NextLength->addIncoming(CurLength, From);
+    NextLength->addIncoming(Length2, Loop);
+    From = Done;
+    CurSrc = NextSrc;
+    CurDst = NextDst;
+    CurLength = NextLength;
+  }
   Builder.CreateRetVoid();
-
-  SrcPHI->addIncoming(Src, Entry);
-  SrcPHI->addIncoming(Src2, Loop);
-  DstPHI->addIncoming(Dst, Entry);
-  DstPHI->addIncoming(Dst2, Loop);
-  LengthPHI->addIncoming(Length, Entry);
-  LengthPHI->addIncoming(Length2, Loop);
 }
 
 void CodeGenModule::initPrebuiltContract() {
@@ -1003,6 +1184,11 @@ void CodeGenModule::initPrebuiltContract() {
   }
   initRipemd160();
   initEcrecover();
+
+  if (isEWASM()) {
+    Func_slotHash1 = initSlotHash(1);
+    Func_slotHash2 = initSlotHash(2);
+  }
 }
 
 void CodeGenModule::initKeccak256() {
@@ -1023,27 +1209,262 @@ void CodeGenModule::initKeccak256() {
                     Builder.CreateZExtOrTrunc(Length, EVMIntTy)});
     Builder.CreateRet(Result);
   } else if (isEWASM()) {
-    llvm::Value *AddressPtr =
-        Builder.CreateAlloca(AddressTy, nullptr, "address.ptr");
-    llvm::APInt Address = llvm::APInt(160, 9).byteSwap();
-    Builder.CreateStore(Builder.getInt(Address), AddressPtr);
-
-    llvm::Value *Fee = emitGetGasLeft();
-    Builder.CreateCall(Func_callStatic, {Fee, AddressPtr, Ptr, Length});
-    llvm::Value *ResultPtr =
-        Builder.CreateAlloca(Int256Ty, nullptr, "result.ptr");
-    llvm::Value *ResultVPtr =
-        Builder.CreateBitCast(ResultPtr, Int8PtrTy, "result.vptr");
-    Builder.CreateCall(Func_returnDataCopy,
-                       {ResultVPtr, Builder.getInt32(0), Builder.getInt32(32)});
-    llvm::Value *Result = Builder.CreateLoad(ResultPtr);
-
-    Builder.CreateRet(emitEndianConvert(Result));
+    switch (CodeGenOpts.Keccak) {
+    case KeccakKind::Precompile:
+      Builder.CreateRet(emitKeccak256Precompile(Ptr, Length));
+      break;
+    case KeccakKind::Inline:
+      initKeccakF();
+      Builder.CreateRet(emitKeccak256Inline(Ptr, Length));
+      break;
+    case KeccakKind::Auto: {
+      // Inputs that fit in one block of the sponge, such as mapping slots,
+      // are cheaper to hash in wasm than through two host calls.
+      initKeccakF();
+      llvm::BasicBlock *Short =
+          llvm::BasicBlock::Create(VMContext, "short", Func_keccak256);
+      llvm::BasicBlock *Long =
+          llvm::BasicBlock::Create(VMContext, "long", Func_keccak256);
+      Builder.CreateCondBr(
+          Builder.CreateICmpULE(Length, Builder.getInt32(KeccakRate)), Short,
+          Long);
+      Builder.SetInsertPoint(Short);
+      Builder.CreateRet(emitKeccak256Inline(Ptr, Length));
+      Builder.SetInsertPoint(Long);
+      Builder.CreateRet(emitKeccak256Precompile(Ptr, Length));
+      break;
+    }
+    }
   } else {
     __builtin_unreachable();
   }
 }
 
+llvm::Value *CodeGenModule::emitKeccak256Precompile(llvm::Value *Ptr,
+                                                    llvm::Value *Length) {
+  llvm::Value *AddressPtr = beginScratchSlot(AddressTy);
+  llvm::APInt Address = llvm::APInt(160, 9).byteSwap();
+  Builder.CreateStore(Builder.getInt(Address), AddressPtr);
+
+  llvm::Value *Fee = emitGetGasLeft();
+  Builder.CreateCall(Func_callStatic, {Fee, AddressPtr, Ptr, Length});
+  endScratchSlot(AddressPtr);
+  llvm::Value *ResultPtr = beginScratchSlot(Int256Ty);
+  llvm::Value *ResultVPtr =
+      Builder.CreateBitCast(ResultPtr, Int8PtrTy, "result.vptr");
+  Builder.CreateCall(Func_returnDataCopy,
+                     {ResultVPtr, Builder.getInt32(0), Builder.getInt32(32)});
+  llvm::Value *Result = Builder.CreateLoad(Int256Ty, ResultPtr);
+  endScratchSlot(ResultPtr);
+  return emitEndianConvert(Result);
+}
+
+/// Keccak-256 sponge over 64-bit lanes. Wasm memory is little-endian like
+/// the lanes, so input and output bytes are read and written as whole
+/// lanes.
+llvm::Value *CodeGenModule::emitKeccak256Inline(llvm::Value *Ptr,
+                                                llvm::Value *Length) {
+  llvm::Function *F = Builder.GetInsertBlock()->getParent();
+  llvm::IRBuilder<> EntryBuilder(&F->getEntryBlock(),
+                                 F->getEntryBlock().begin());
+  llvm::Value *State = EntryBuilder.CreateAlloca(
+      Int64Ty, EntryBuilder.getInt32(KeccakLanes), "keccak.state");
+  llvm::Value *Block = EntryBuilder.CreateAlloca(
+      Int64Ty, EntryBuilder.getInt32(KeccakRate / 8), "keccak.block");
+  auto Lane = [this](llvm::Value *Base, unsigned Index) {
+    return Builder.CreateConstInBoundsGEP1_32(Int64Ty, Base, Index);
+  };
+  for (unsigned I = 0; I < KeccakLanes; ++I) {
+    Builder.CreateStore(Builder.getInt64(0), Lane(State, I));
+  }
+  auto AbsorbBlock = [&](llvm::Value *Input) {
+    llvm::Value *Lanes = Builder.CreateBitCast(Input, Int64PtrTy);
+    for (unsigned I = 0; I < KeccakRate / 8; ++I) {
+      llvm::Value *Value = Builder.CreateAlignedLoad(Int64Ty, Lane(Lanes, I),
+                                                     llvm::MaybeAlign(1));
+      llvm::Value *StateLane = Lane(State, I);
+      Builder.CreateStore(
+          Builder.CreateXor(Builder.CreateLoad(Int64Ty, StateLane), Value),
+          StateLane);
+    }
+    Builder.CreateCall(Func_keccakf, {State});
+  };
+
+  llvm::BasicBlock *From = Builder.GetInsertBlock();
+  llvm::BasicBlock *Absorb = llvm::BasicBlock::Create(VMContext, "absorb", F);
+  llvm::BasicBlock *Full = llvm::BasicBlock::Create(VMContext, "full", F);
+  llvm::BasicBlock *Pad = llvm::BasicBlock::Create(VMContext, "pad", F);
+  Builder.CreateBr(Absorb);
+
+  Builder.SetInsertPoint(Absorb);
+  llvm::PHINode *CurPtr = Builder.CreatePHI(Ptr->getType(), 2);
+  llvm::PHINode *CurLength = Builder.CreatePHI(Int32Ty, 2);
+  Builder.CreateCondBr(
+      Builder.CreateICmpUGE(CurLength, Builder.getInt32(KeccakRate)), Full,
+      Pad);
+
+  Builder.SetInsertPoint(Full);
+  AbsorbBlock(CurPtr);
+  llvm::Value *NextPtr =
+      Builder.CreateInBoundsGEP(Int8Ty, CurPtr, Builder.getInt32(KeccakRate));
+  llvm::Value *NextLength =
+      Builder.CreateSub(CurLength, Builder.getInt32(KeccakRate));
+  Builder.CreateBr(Absorb);
+  CurPtr->addIncoming(Ptr, From);
+  CurPtr->addIncoming(NextPtr, Builder.GetInsertBlock());
+  CurLength->addIncoming(Length, From);
+  CurLength->addIncoming(NextLength, Builder.GetInsertBlock());
+
+  // The last, partial block carries the padding: 0x01 after the input and
+  // 0x80 in the last byte of the block.
+  Builder.SetInsertPoint(Pad);
+  for (unsigned I = 0; I < KeccakRate / 8; ++I) {
+    Builder.CreateStore(Builder.getInt64(0), Lane(Block, I));
+  }
+  llvm::Value *BlockBytes = Builder.CreateBitCast(Block, Int8PtrTy);
+  emitMemcpy(BlockBytes, CurPtr, CurLength);
+  llvm::Value *First = Builder.CreateInBoundsGEP(Int8Ty, BlockBytes, CurLength);
+  Builder.CreateStore(
+      Builder.CreateXor(Builder.CreateLoad(Int8Ty, First),
+                        Builder.getInt8(0x01)),
+      First);
+  llvm::Value *Last =
+      Builder.CreateConstInBoundsGEP1_32(Int8Ty, BlockBytes, KeccakRate - 1);
+  Builder.CreateStore(Builder.CreateXor(Builder.CreateLoad(Int8Ty, Last),
+                                        Builder.getInt8(0x80)),
+                      Last);
+  AbsorbBlock(BlockBytes);
+
+  llvm::Value *Result = Builder.CreateLoad(
+      Int256Ty, Builder.CreateBitCast(State, Int256PtrTy), "digest");
+  return emitEndianConvert(Result);
+}
+
+/// Keccak-f[1600] permutation of the 25 lanes at its argument. Each round is
+/// unrolled over the lanes, which stay in registers across rounds.
+void CodeGenModule::initKeccakF() {
+  static const uint64_t RoundConstants[KeccakRounds] = {
+      0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+      0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+      0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+      0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+      0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+      0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+      0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+      0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+  // Rotation offsets, indexed by x + 5 * y.
+  static const unsigned RotationOffsets[KeccakLanes] = {
+      0,  1,  62, 28, 27, 36, 44, 6,  55, 20, 3,  10, 43,
+      25, 39, 41, 45, 15, 21, 8,  18, 2,  61, 56, 14};
+
+  if (Func_keccakf) {
+    return;
+  }
+  llvm::IRBuilderBase::InsertPointGuard Guard(Builder);
+  llvm::FunctionType *FT =
+      llvm::FunctionType::get(VoidTy, {Int64PtrTy}, false);
+  Func_keccakf = llvm::Function::Create(FT, llvm::Function::InternalLinkage,
+                                        "solidity.keccakf", TheModule);
+  Func_keccakf->addFnAttr(llvm::Attribute::NoUnwind);
+  llvm::Argument *State = Func_keccakf->arg_begin();
+  State->setName("state");
+
+  auto *RCTy = llvm::ArrayType::get(Int64Ty, KeccakRounds);
+  auto *RCTable = new llvm::GlobalVariable(
+      TheModule, RCTy, true, llvm::GlobalVariable::InternalLinkage,
+      llvm::ConstantDataArray::get(
+          VMContext, llvm::makeArrayRef(RoundConstants, KeccakRounds)),
+      "keccak.rc");
+  llvm::Function *Rotl = getIntrinsic(llvm::Intrinsic::fshl, {Int64Ty});
+
+  llvm::BasicBlock *Entry =
+      llvm::BasicBlock::Create(VMContext, "entry", Func_keccakf);
+  llvm::BasicBlock *Loop =
+      llvm::BasicBlock::Create(VMContext, "round", Func_keccakf);
+  llvm::BasicBlock *Done =
+      llvm::BasicBlock::Create(VMContext, "done", Func_keccakf);
+
+  Builder.SetInsertPoint(Entry);
+  llvm::Value *Initial[KeccakLanes];
+  for (unsigned I = 0; I < KeccakLanes; ++I) {
+    Initial[I] = Builder.CreateLoad(
+        Int64Ty, Builder.CreateConstInBoundsGEP1_32(Int64Ty, State, I));
+  }
+  Builder.CreateBr(Loop);
+
+  Builder.SetInsertPoint(Loop);
+  llvm::PHINode *Round = Builder.CreatePHI(Int32Ty, 2, "round");
+  llvm::PHINode *Phis[KeccakLanes];
+  llvm::Value *A[KeccakLanes];
+  for (unsigned I = 0; I < KeccakLanes; ++I) {
+    Phis[I] = Builder.CreatePHI(Int64Ty, 2);
+    A[I] = Phis[I];
+  }
+  auto RotateLeft = [&](llvm::Value *V, unsigned Amount) -> llvm::Value * {
+    if (Amount == 0) {
+      return V;
+    }
+    return Builder.CreateCall(Rotl, {V, V, Builder.getInt64(Amount)});
+  };
+
+  // theta
+  llvm::Value *C[5];
+  for (unsigned X = 0; X < 5; ++X) {
+    C[X] = Builder.CreateXor(
+        Builder.CreateXor(Builder.CreateXor(A[X], A[X + 5]),
+                          Builder.CreateXor(A[X + 10], A[X + 15])),
+        A[X + 20]);
+  }
+  for (unsigned X = 0; X < 5; ++X) {
+    llvm::Value *D =
+        Builder.CreateXor(C[(X + 4) % 5], RotateLeft(C[(X + 1) % 5], 1));
+    for (unsigned Y = 0; Y < 5; ++Y) {
+      A[X + 5 * Y] = Builder.CreateXor(A[X + 5 * Y], D);
+    }
+  }
+  // rho and pi
+  llvm::Value *B[KeccakLanes];
+  for (unsigned X = 0; X < 5; ++X) {
+    for (unsigned Y = 0; Y < 5; ++Y) {
+      B[Y + 5 * ((2 * X + 3 * Y) % 5)] =
+          RotateLeft(A[X + 5 * Y], RotationOffsets[X + 5 * Y]);
+    }
+  }
+  // chi
+  for (unsigned Y = 0; Y < 5; ++Y) {
+    for (unsigned X = 0; X < 5; ++X) {
+      llvm::Value *Next = B[(X + 1) % 5 + 5 * Y];
+      llvm::Value *NextNext = B[(X + 2) % 5 + 5 * Y];
+      A[X + 5 * Y] = Builder.CreateXor(
+          B[X + 5 * Y],
+          Builder.CreateAnd(Builder.CreateNot(Next), NextNext));
+    }
+  }
+  // iota
+  llvm::Value *RC = Builder.CreateLoad(
+      Int64Ty, Builder.CreateInBoundsGEP(RCTy, RCTable,
+                                         {Builder.getInt32(0), Round}));
+  A[0] = Builder.CreateXor(A[0], RC);
+
+  llvm::Value *NextRound = Builder.CreateAdd(Round, Builder.getInt32(1));
+  Builder.CreateCondBr(
+      Builder.CreateICmpULT(NextRound, Builder.getInt32(KeccakRounds)), Loop,
+      Done);
+  Round->addIncoming(Builder.getInt32(0), Entry);
+  Round->addIncoming(NextRound, Loop);
+  for (unsigned I = 0; I < KeccakLanes; ++I) {
+    Phis[I]->addIncoming(Initial[I], Entry);
+    Phis[I]->addIncoming(A[I], Loop);
+  }
+
+  Builder.SetInsertPoint(Done);
+  for (unsigned I = 0; I < KeccakLanes; ++I) {
+    Builder.CreateStore(A[I],
+                        Builder.CreateConstInBoundsGEP1_32(Int64Ty, State, I));
+  }
+  Builder.CreateRetVoid();
+}
+
 void CodeGenModule::initSha256() {
   llvm::Argument *Memory = Func_sha256->arg_begin();
   Memory->setName("memory");
@@ -1193,6 +1614,39 @@ void CodeGenModule::initEcrecover() {
   }
 }
 
+/// Storage slots of mapping values and dynamic array data are hashes of
+/// 32-byte words. On Ewasm they are taken by value through a readnone
+/// marker, so that repeated hashes are commoned up and loop invariant ones
+/// hoisted. The marker has no body: the hash writes memory and calls the
+/// host, so the calls are pointed at the real body by LowerSlotHash once
+/// optimization is done. The body is kept in llvm.compiler.used until then.
+llvm::Function *CodeGenModule::initSlotHash(unsigned WordCount) {
+  std::vector<llvm::Type *> Params(WordCount, Int256Ty);
+  llvm::FunctionType *FT = llvm::FunctionType::get(Int256Ty, Params, false);
+  const std::string Name = "solidity.slothash" + std::to_string(WordCount);
+  llvm::Function *Marker = llvm::Function::Create(
+      FT, llvm::Function::ExternalLinkage, Name, TheModule);
+  Marker->addFnAttr(llvm::Attribute::NoUnwind);
+  Marker->addFnAttr(llvm::Attribute::ReadNone);
+#if LLVM_VERSION_MAJOR >= 11
+  Marker->addFnAttr(llvm::Attribute::WillReturn);
+#endif
+
+  llvm::Function *Body = llvm::Function::Create(
+      FT, llvm::Function::InternalLinkage, Name + ".body", TheModule);
+  Body->addFnAttr(llvm::Attribute::NoUnwind);
+  llvm::appendToCompilerUsed(TheModule, {Body});
+
+  llvm::BasicBlock *Entry = llvm::BasicBlock::Create(VMContext, "entry", Body);
+  Builder.SetInsertPoint(Entry);
+  std::vector<llvm::Value *> Words;
+  for (llvm::Argument &Arg : Body->args()) {
+    Words.push_back(&Arg);
+  }
+  Builder.CreateRet(emitKeccak256(emitConcatBytes(Words)));
+  return Marker;
+}
+
 void CodeGenModule::emitContractDecl(const ContractDecl *CD) {
   for (const auto *D : CD->getSubNodes()) {
     if (const auto *ED = dynamic_cast<const EventDecl *>(D)) {
@@ -1214,10 +1668,66 @@ void CodeGenModule::emitContractDecl(const ContractDecl *CD) {
     emitFunctionDecl(Fallback);
   }
 
+  if (HasProfile) {
+    applyProfile(CD);
+  }
+
   emitContractConstructorDecl(CD);
   emitContractDispatcherDecl(CD);
 }
 
+namespace {
+/// Whether \p FD has a selector in the contract's dispatcher.
+bool isDispatched(const FunctionDecl *FD) {
+  switch (FD->getVisibility()) {
+  case Decl::Visibility::Default:
+  case Decl::Visibility::External:
+  case Decl::Visibility::Public:
+    return true;
+  default:
+    return false;
+  }
+}
+} // namespace
+
+void CodeGenModule::applyProfile(const ContractDecl *CD) {
+  std::uint64_t Calls = 0;
+  bool HasEntryCounts = false;
+  for (const FunctionDecl *FD : CD->getFuncs()) {
+    Calls += ProfileCounts.lookup(FD->getSignatureHashUInt32());
+    HasEntryCounts |= ProfileCounts.count(getProfileID(FD)) != 0;
+  }
+  if (Calls == 0) {
+    // The trace was recorded from another contract.
+    return;
+  }
+  // With function entries in the trace, functions never entered are cold,
+  // and those entered in a large share of the calls are worth inlining. A
+  // trace of selectors only counts the calls into dispatched functions,
+  // which stand in for their entries; it cannot show that any function is
+  // never entered, since internal calls are not in it.
+  for (const FunctionDecl *FD : CD->getFuncs()) {
+    std::uint64_t Count;
+    if (HasEntryCounts) {
+      Count = ProfileCounts.lookup(getProfileID(FD));
+    } else if (isDispatched(FD)) {
+      Count = ProfileCounts.lookup(FD->getSignatureHashUInt32());
+      if (Count == 0) {
+        continue;
+      }
+    } else {
+      continue;
+    }
+    llvm::Function *F = TheModule.getFunction(getMangledName(FD));
+    F->setEntryCount(Count);
+    if (Count == 0) {
+      F->addFnAttr(llvm::Attribute::Cold);
+    } else if (Count * ProfileHotShare >= Calls) {
+      F->addFnAttr(llvm::Attribute::InlineHint);
+    }
+  }
+}
+
 llvm::Function *CodeGenModule::emitNestedObjectGetter(llvm::StringRef Name) {
   llvm::FunctionType *FT = llvm::FunctionType::get(BytesTy, false);
   return llvm::Function::Create(FT, llvm::Function::ExternalLinkage, Name,
@@ -1294,14 +1804,8 @@ void CodeGenModule::emitContractDispatcherDecl(const ContractDecl *CD) {
 
   std::vector<const FunctionDecl *> PublicFDs;
   for (const FunctionDecl *FD : CD->getFuncs()) {
-    switch (FD->getVisibility()) {
-    case Decl::Visibility::Default:
-    case Decl::Visibility::External:
-    case Decl::Visibility::Public:
+    if (isDispatched(FD)) {
       PublicFDs.emplace_back(FD);
-      break;
-    default:
-      break;
     }
   }
   if (!PublicFDs.empty()) {
@@ -1330,14 +1834,20 @@ void CodeGenModule::emitContractDispatcherDecl(const ContractDecl *CD) {
         Builder.CreateBitCast(HashVPtr, Int32PtrTy, "hash.ptr");
     llvm::Value *Hash = Builder.CreateLoad(Int32Ty, HashPtr, "hash");
 
-    llvm::SwitchInst *SI = Builder.CreateSwitch(Hash, Error, PublicFDs.size());
-
+    std::vector<std::uint32_t> Selectors;
+    std::vector<llvm::BasicBlock *> Targets;
     for (const FunctionDecl *FD : PublicFDs) {
-      const std::string &MangledName = getMangledName(FD);
-      llvm::BasicBlock *CondBB =
-          llvm::BasicBlock::Create(VMContext, MangledName, Main);
-      emitABILoad(FD, CondBB, Error, CallDataSize);
-      SI->addCase(Builder.getInt32(FD->getSignatureHashUInt32()), CondBB);
+      Selectors.push_back(FD->getSignatureHashUInt32());
+      Targets.push_back(
+          llvm::BasicBlock::Create(VMContext, getMangledName(FD), Main));
+      Builder.SetInsertPoint(Targets.back());
+      emitProfileCounter(Selectors.back());
+    }
+    Builder.SetInsertPoint(Switch);
+    emitSelectorDispatch(Hash, Selectors, Targets, Error);
+
+    for (std::size_t I = 0; I < PublicFDs.size(); ++I) {
+      emitABILoad(PublicFDs[I], Targets[I], Error, CallDataSize);
     }
   } else {
     Builder.SetInsertPoint(Entry);
@@ -1345,6 +1855,200 @@ void CodeGenModule::emitContractDispatcherDecl(const ContractDecl *CD) {
   }
 }
 
+namespace {
+/// Multiplicative hash mapping every selector of a contract to its own slot
+/// in a table of 2^Bits entries.
+struct SelectorHash {
+  std::uint32_t Multiplier;
+  unsigned Bits;
+  unsigned slot(std::uint32_t Selector) const {
+    return (Selector * Multiplier) >> (32 - Bits);
+  }
+};
+
+/// Searches for a perfect SelectorHash over \p Selectors, starting from the
+/// smallest table that can hold them and trying \p Tries multipliers for each
+/// size. The multipliers come from a fixed xorshift sequence so that the
+/// output is reproducible.
+llvm::Optional<SelectorHash>
+findSelectorHash(llvm::ArrayRef<std::uint32_t> Selectors, unsigned Tries) {
+  const unsigned MinBits = std::max(1u, llvm::Log2_64_Ceil(Selectors.size()));
+  std::uint32_t State = 0x9E3779B9;
+  for (unsigned Bits = MinBits; Bits <= MinBits + DispatchPHFExtraBits;
+       ++Bits) {
+    std::vector<bool> Taken(1u << Bits);
+    for (unsigned Try = 0; Try < Tries; ++Try) {
+      State ^= State << 13;
+      State ^= State >> 17;
+      State ^= State << 5;
+      const SelectorHash Hash{State | 1, Bits};
+      std::fill(Taken.begin(), Taken.end(), false);
+      bool Perfect = true;
+      for (std::uint32_t Selector : Selectors) {
+        const unsigned Slot = Hash.slot(Selector);
+        if (Taken[Slot]) {
+          Perfect = false;
+          break;
+        }
+        Taken[Slot] = true;
+      }
+      if (Perfect) {
+        return Hash;
+      }
+    }
+  }
+  return llvm::None;
+}
+
+/// Scales profile counts down so that the largest fits in a branch weight.
+llvm::SmallVector<std::uint32_t, 8>
+toBranchWeights(llvm::ArrayRef<std::uint64_t> Counts) {
+  const std::uint64_t Max = *std::max_element(Counts.begin(), Counts.end());
+  const std::uint64_t Scale =
+      Max / std::numeric_limits<std::uint32_t>::max() + 1;
+  llvm::SmallVector<std::uint32_t, 8> Weights;
+  for (std::uint64_t Count : Counts) {
+    Weights.push_back(static_cast<std::uint32_t>(Count / Scale));
+  }
+  return Weights;
+}
+} // namespace
+
+void CodeGenModule::emitSelectorDispatch(
+    llvm::Value *Selector, llvm::ArrayRef<std::uint32_t> AllSelectors,
+    llvm::ArrayRef<llvm::BasicBlock *> AllTargets, llvm::BasicBlock *Error) {
+  llvm::Function *Main = Builder.GetInsertBlock()->getParent();
+  llvm::MDBuilder MDB(VMContext);
+
+  // With a profile, the hot selectors are compared first and the rest are
+  // ordered from the most to the least called.
+  std::vector<std::size_t> Order(AllSelectors.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  std::vector<std::uint64_t> AllCounts;
+  std::uint64_t Calls = 0;
+  for (std::uint32_t Selector : AllSelectors) {
+    AllCounts.push_back(ProfileCounts.lookup(Selector));
+    Calls += AllCounts.back();
+  }
+  std::stable_sort(Order.begin(), Order.end(),
+                   [&](std::size_t L, std::size_t R) {
+                     return AllCounts[L] > AllCounts[R];
+                   });
+
+  std::vector<std::uint32_t> Selectors;
+  std::vector<llvm::BasicBlock *> Targets;
+  std::vector<std::uint64_t> Counts;
+  std::uint64_t Remaining = Calls;
+  for (std::size_t I : Order) {
+    const std::uint64_t Count = AllCounts[I];
+    if (Count == 0 || Count * ProfileHotShare < Calls) {
+      Selectors.push_back(AllSelectors[I]);
+      Targets.push_back(AllTargets[I]);
+      Counts.push_back(Count);
+      continue;
+    }
+    Remaining -= Count;
+    llvm::BasicBlock *Next = llvm::BasicBlock::Create(
+        VMContext, "dispatch.next", Main, AllTargets.front());
+    llvm::Value *Cmp = Builder.CreateICmpEQ(
+        Selector, Builder.getInt32(AllSelectors[I]), "dispatch.cmp");
+    Builder.CreateCondBr(Cmp, AllTargets[I], Next,
+                         MDB.createBranchWeights(
+                             toBranchWeights({Count, Remaining})));
+    Builder.SetInsertPoint(Next);
+  }
+  if (Selectors.empty()) {
+    Builder.CreateBr(Error);
+    return;
+  }
+
+  DispatchKind Kind = CodeGenOpts.Dispatch;
+  if (Kind == DispatchKind::Auto) {
+    Kind = Selectors.size() >= DispatchPHFThreshold ? DispatchKind::PHF
+                                                    : DispatchKind::Switch;
+  }
+  llvm::Optional<SelectorHash> Hash;
+  if (Kind == DispatchKind::PHF) {
+    Hash = findSelectorHash(Selectors, CodeGenOpts.DispatchPHFTries);
+    if (!Hash) {
+      Kind = DispatchKind::Switch;
+    }
+  }
+
+  switch (Kind) {
+  case DispatchKind::Linear: {
+    for (std::size_t I = 0; I < Selectors.size(); ++I) {
+      llvm::BasicBlock *Next = Error;
+      if (I + 1 < Selectors.size()) {
+        Next = llvm::BasicBlock::Create(VMContext, "dispatch.next", Main,
+                                        Targets.front());
+      }
+      llvm::Value *Cmp = Builder.CreateICmpEQ(
+          Selector, Builder.getInt32(Selectors[I]), "dispatch.cmp");
+      llvm::BranchInst *BI = Builder.CreateCondBr(Cmp, Targets[I], Next);
+      if (Remaining > 0) {
+        Remaining -= Counts[I];
+        BI->setMetadata(llvm::LLVMContext::MD_prof,
+                        MDB.createBranchWeights(
+                            toBranchWeights({Counts[I], Remaining})));
+      }
+      if (Next != Error) {
+        Builder.SetInsertPoint(Next);
+      }
+    }
+    break;
+  }
+  case DispatchKind::PHF: {
+    // The hash only tells which selector could match, so each slot still
+    // compares against it once. Every slot gets a case and the default is
+    // unreachable, which keeps the switch dense enough to become a jump
+    // table (br_table on Ewasm).
+    const unsigned TableSize = 1u << Hash->Bits;
+    llvm::Value *Mul = Builder.CreateMul(
+        Selector, Builder.getInt32(Hash->Multiplier), "dispatch.mul");
+    llvm::Value *Slot =
+        Builder.CreateLShr(Mul, 32 - Hash->Bits, "dispatch.slot");
+    llvm::BasicBlock *Unreachable = llvm::BasicBlock::Create(
+        VMContext, "dispatch.unreachable", Main, Targets.front());
+    llvm::SwitchInst *SI = Builder.CreateSwitch(Slot, Unreachable, TableSize);
+
+    std::vector<llvm::BasicBlock *> Slots(TableSize, Error);
+    for (std::size_t I = 0; I < Selectors.size(); ++I) {
+      llvm::BasicBlock *Check = llvm::BasicBlock::Create(
+          VMContext, Targets[I]->getName() + ".check", Main, Targets.front());
+      Slots[Hash->slot(Selectors[I])] = Check;
+      Builder.SetInsertPoint(Check);
+      llvm::Value *Cmp = Builder.CreateICmpEQ(
+          Selector, Builder.getInt32(Selectors[I]), "dispatch.cmp");
+      Builder.CreateCondBr(Cmp, Targets[I], Error);
+    }
+    for (unsigned I = 0; I < TableSize; ++I) {
+      SI->addCase(Builder.getInt32(I), Slots[I]);
+    }
+
+    Builder.SetInsertPoint(Unreachable);
+    Builder.CreateUnreachable();
+    break;
+  }
+  case DispatchKind::Switch:
+  case DispatchKind::Auto: {
+    llvm::SwitchInst *SI =
+        Builder.CreateSwitch(Selector, Error, Selectors.size());
+    for (std::size_t I = 0; I < Selectors.size(); ++I) {
+      SI->addCase(Builder.getInt32(Selectors[I]), Targets[I]);
+    }
+    if (Remaining > 0) {
+      // The first weight is for the default destination.
+      std::vector<std::uint64_t> Weights{0};
+      Weights.insert(Weights.end(), Counts.begin(), Counts.end());
+      SI->setMetadata(llvm::LLVMContext::MD_prof,
+                      MDB.createBranchWeights(toBranchWeights(Weights)));
+    }
+    break;
+  }
+  }
+}
+
 llvm::Value *CodeGenModule::emitABILoadParamStatic(const Type *Ty,
                                                    llvm::StringRef Name,
                                                    llvm::Value *Buffer,
@@ -1445,36 +2149,129 @@ void CodeGenModule::emitABIStore(std::vector<const Type *> Tys,
   emitFinish(RetVPtr, Builder.CreateTrunc(RetSize, Int32Ty));
 }
 
+namespace {
+/// Collects the declarations referenced from a function body, so that the
+/// dispatcher only decodes the parameters a function actually reads.
+class ParamUseCollector : public ConstStmtVisitor {
+  llvm::SmallPtrSetImpl<const Decl *> &Used;
+
+public:
+  explicit ParamUseCollector(llvm::SmallPtrSetImpl<const Decl *> &Used)
+      : Used(Used) {}
+  // The base visitor treats declarations as leaves, but a parameter may be
+  // read only by the initializer of a local.
+  void visit(DeclStmtType &DS) override {
+    if (const Expr *Value = DS.getValue()) {
+      Value->accept(*this);
+    }
+  }
+  void visit(IdentifierType &I) override {
+    if (const Decl *D = I.getCorrespondDecl()) {
+      Used.insert(D);
+    }
+  }
+  void visit(AsmIdentifierType &I) override {
+    if (const Decl *D = I.getCorrespondDecl()) {
+      Used.insert(D);
+    }
+  }
+};
+
+/// Returns a flag per parameter of \p FD telling whether its body refers to
+/// it. Functions without a body keep every parameter.
+std::vector<bool> findUsedParams(const FunctionDecl *FD) {
+  const auto &Params = FD->getParams()->getParams();
+  const Block *Body = FD->getBody();
+  if (Body == nullptr) {
+    return std::vector<bool>(Params.size(), true);
+  }
+  llvm::SmallPtrSet<const Decl *, 8> Used;
+  ParamUseCollector Collector(Used);
+  Body->accept(Collector);
+  std::vector<bool> Result;
+  Result.reserve(Params.size());
+  for (const auto &Param : Params) {
+    Result.push_back(Used.count(Param) != 0);
+  }
+  return Result;
+}
+} // namespace
+
 void CodeGenModule::emitABILoad(const FunctionDecl *FD,
                                 llvm::BasicBlock *Loader,
                                 llvm::BasicBlock *Error,
                                 llvm::Value *CallDataSize) {
   Builder.SetInsertPoint(Loader);
   const std::string &MangledName = getMangledName(FD);
+  llvm::Function *F = TheModule.getFunction(MangledName);
 
   std::vector<llvm::Value *> ArgsVal;
   // get arguments from calldata
   const auto ABIStaticSize = FD->getParams()->getABIStaticSize();
   if (ABIStaticSize > 0) {
-    auto *ArgsBuf = Builder.CreateAlloca(
-        Int8Ty, Builder.getInt32(ABIStaticSize), MangledName + ".args.buf");
-    auto *ArgsPtr = Builder.CreateBitCast(ArgsBuf, ArgsElemPtrTy,
-                                          MangledName + ".args.ptr");
-    emitCallDataCopy(ArgsPtr, Builder.getInt32(4),
-                     Builder.getInt32(ABIStaticSize));
-
+    // Parameters the body never reads are passed as undef, and only the head
+    // words of the remaining ones are copied out of calldata.
     const auto &Fparams = FD->getParams()->getParams();
+    const std::vector<bool> Used = findUsedParams(FD);
+    std::uint32_t Begin = ABIStaticSize;
+    std::uint32_t End = 0;
     std::uint32_t Offset = 0;
+    for (std::size_t I = 0; I < Fparams.size(); I++) {
+      const std::uint32_t Size = Fparams[I]->getType()->getABIStaticSize();
+      if (Used[I]) {
+        Begin = std::min(Begin, Offset);
+        End = std::max(End, Offset + Size);
+      }
+      Offset += Size;
+    }
+
+    // Copying a window of the head no longer fails on truncated calldata, so
+    // check the length of the whole head up front.
+    if (Begin != 0 || End != ABIStaticSize) {
+      llvm::BasicBlock *Short = llvm::BasicBlock::Create(
+          VMContext, MangledName + ".short", Loader->getParent());
+      llvm::BasicBlock *Decode = llvm::BasicBlock::Create(
+          VMContext, MangledName + ".decode", Loader->getParent());
+      llvm::Value *HeadSize =
+          llvm::ConstantInt::get(CallDataSize->getType(), 4 + ABIStaticSize);
+      Builder.CreateCondBr(
+          Builder.CreateICmpUGE(CallDataSize, HeadSize, MangledName + ".cmp"),
+          Decode, Short);
+      Builder.SetInsertPoint(Short);
+      emitRevert(llvm::ConstantPointerNull::get(Int8PtrTy),
+                 Builder.getInt32(0));
+      Builder.CreateUnreachable();
+      Builder.SetInsertPoint(Decode);
+    }
+
+    llvm::Value *ArgsBuf = nullptr;
+    if (Begin < End) {
+      ArgsBuf = Builder.CreateAlloca(Int8Ty, Builder.getInt32(End - Begin),
+                                     MangledName + ".args.buf");
+      auto *ArgsPtr = Builder.CreateBitCast(ArgsBuf, ArgsElemPtrTy,
+                                            MangledName + ".args.ptr");
+      emitCallDataCopy(ArgsPtr, Builder.getInt32(4 + Begin),
+                       Builder.getInt32(End - Begin));
+    }
+
+    Offset = 0;
     std::vector<size_t> ArgsDynamic;
     for (std::size_t I = 0; I < Fparams.size(); I++) {
       const Type *Ty = Fparams[I]->getType().get();
+      const std::uint32_t Size = Ty->getABIStaticSize();
+      if (!Used[I]) {
+        ArgsVal.push_back(
+            llvm::UndefValue::get(F->getFunctionType()->getParamType(I)));
+        Offset += Size;
+        continue;
+      }
       if (Ty->isDynamic()) {
         ArgsDynamic.push_back(I);
       }
-      const std::uint32_t Size = Ty->getABIStaticSize();
       const std::string &ParamName =
           (MangledName + "." + Fparams[I]->getName()).str();
-      ArgsVal.push_back(emitABILoadParamStatic(Ty, ParamName, ArgsBuf, Offset));
+      ArgsVal.push_back(
+          emitABILoadParamStatic(Ty, ParamName, ArgsBuf, Offset - Begin));
       Offset += Size;
     }
 
@@ -1522,7 +2319,6 @@ void CodeGenModule::emitABILoad(const FunctionDecl *FD,
   }
 
   // Call this function
-  llvm::Function *F = TheModule.getFunction(MangledName);
   const auto &Returns = FD->getReturnParams()->getParams();
   if (Returns.empty()) {
     Builder.CreateCall(F, ArgsVal);
@@ -1582,11 +2378,16 @@ void CodeGenModule::emitFunctionDecl(const FunctionDecl *FD) {
 }
 
 void CodeGenModule::emitVarDecl(const VarDecl *VD) {
-  const std::size_t Index = StateVarAddrCursor;
+  const Type *Ty = VD->getType().get();
+  const auto [Index, Offset] = StateVarAllocator.allocate(*Ty);
   llvm::GlobalVariable *StateVarAddr = new llvm::GlobalVariable(
       TheModule, Int256Ty, true, llvm::GlobalVariable::InternalLinkage,
       Builder.getIntN(256, Index), VD->getName());
-  StateVarAddrCursor += VD->getType()->getStorageSize() / 32;
+  // Values smaller than a slot may share it with their neighbours, so they
+  // are always accessed with a shift and mask.
+  if (Ty->getStorageSize() < 32) {
+    StateVarShiftMap.try_emplace(VD, Offset * 8);
+  }
   StateVarAddr->setUnnamedAddr(llvm::GlobalVariable::UnnamedAddr::Local);
   StateVarAddr->setAlignment(llvm::MaybeAlign(256));
   StateVarDeclMap.try_emplace(VD, StateVarAddr);
@@ -1801,6 +2602,15 @@ llvm::Value *CodeGenModule::getEndianlessValue(llvm::Value *Val) {
 llvm::Value *CodeGenModule::emitEndianConvert(llvm::Value *Val) {
   llvm::StringRef Name = Val->getName();
   llvm::Type *Ty = Val->getType();
+  // Narrow integers that are whole bytes are swapped in place, which also
+  // lets the optimizer cancel back-to-back conversions.
+  if (const unsigned BitWidth = Ty->getIntegerBitWidth(); BitWidth == 8) {
+    return Val;
+  } else if (BitWidth % 16 == 0 && BitWidth <= 128) {
+    llvm::Function *Bswap = llvm::Intrinsic::getDeclaration(
+        &TheModule, llvm::Intrinsic::bswap, {Ty});
+    return Builder.CreateCall(Bswap, {Val}, Name + ".reverse");
+  }
   llvm::Value *Ext = Builder.CreateZExtOrTrunc(Val, Int256Ty, "extend_256");
   if (const unsigned BitWidth = Ty->getIntegerBitWidth(); BitWidth != 256) {
     Ext = Builder.CreateShl(Ext, 256 - BitWidth, "shift_left");
@@ -1857,9 +2667,7 @@ CodeGenModule::emitConcatBytes(llvm::ArrayRef<llvm::Value *> Values) {
       llvm::Value *Length = Builder.CreateZExtOrTrunc(
           Builder.CreateExtractValue(Value, {0}), Int32Ty);
       llvm::Value *SrcBytes = Builder.CreateExtractValue(Value, {1});
-      Builder.CreateCall(
-          Func_memcpy,
-          {Builder.CreateBitCast(Ptr, BytesElemPtrTy), SrcBytes, Length});
+      emitMemcpy(Builder.CreateBitCast(Ptr, BytesElemPtrTy), SrcBytes, Length);
       Index = Builder.CreateAdd(Index, Length);
     } else {
       llvm::Value *CPtr =
@@ -1878,7 +2686,37 @@ CodeGenModule::emitConcatBytes(llvm::ArrayRef<llvm::Value *> Values) {
 }
 
 void CodeGenModule::emitUpdateMemorySize(llvm::Value *Pos, llvm::Value *Range) {
-  Builder.CreateCall(Func_updateMemorySize, {Pos, Range});
+  Builder.CreateCall(Func_updateMemorySize,
+                     {Builder.CreateZExtOrTrunc(Pos, Int32Ty),
+                      Builder.CreateZExtOrTrunc(Range, Int32Ty)});
+}
+
+/// Allocates in the entry block of the current function, so that the slot
+/// is static even when the code being emitted runs in a loop.
+llvm::AllocaInst *CodeGenModule::createEntryAlloca(llvm::Type *Ty,
+                                                   const llvm::Twine &Name) {
+  llvm::BasicBlock &Entry =
+      Builder.GetInsertBlock()->getParent()->getEntryBlock();
+  llvm::IRBuilder<> EntryBuilder(&Entry, Entry.begin());
+  return EntryBuilder.CreateAlloca(Ty, nullptr, Name);
+}
+
+/// Returns the \p Index-th scratch slot of type \p Ty in the current
+/// function and starts its lifetime. Slots are reused by later calls, so a
+/// slot must be released with endScratchSlot before any other code that may
+/// ask for the same one runs.
+llvm::Value *CodeGenModule::beginScratchSlot(llvm::Type *Ty, unsigned Index) {
+  const llvm::Function *F = Builder.GetInsertBlock()->getParent();
+  auto &Slots = ScratchSlots[{F, Ty}];
+  while (Slots.size() <= Index) {
+    Slots.push_back(createEntryAlloca(Ty, "scratch"));
+  }
+  Builder.CreateLifetimeStart(Slots[Index]);
+  return Slots[Index];
+}
+
+void CodeGenModule::endScratchSlot(llvm::Value *Slot) {
+  Builder.CreateLifetimeEnd(Slot);
 }
 
 llvm::Value *CodeGenModule::emitGetGasLeft() {
@@ -1889,9 +2727,11 @@ llvm::Value *CodeGenModule::emitGetCallValue() {
   if (isEVM()) {
     return Builder.CreateCall(Func_getCallValue, {});
   } else if (isEWASM()) {
-    llvm::Value *ValPtr = Builder.CreateAlloca(Int128Ty);
+    llvm::Value *ValPtr = beginScratchSlot(Int128Ty);
     Builder.CreateCall(Func_getCallValue, {ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(Int128Ty, ValPtr);
+    endScratchSlot(ValPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -1902,9 +2742,11 @@ llvm::Value *CodeGenModule::emitGetCaller() {
     llvm::Value *Address = Builder.CreateCall(Func_getCaller, {});
     return Builder.CreateZExtOrTrunc(Address, AddressTy);
   } else if (isEWASM()) {
-    llvm::Value *ValPtr = Builder.CreateAlloca(AddressTy);
+    llvm::Value *ValPtr = beginScratchSlot(AddressTy);
     Builder.CreateCall(Func_getCaller, {ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(AddressTy, ValPtr);
+    endScratchSlot(ValPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -2001,11 +2843,13 @@ void CodeGenModule::emitStorageStore(llvm::Value *Address, llvm::Value *Value) {
   if (isEVM()) {
     Builder.CreateCall(Func_storageStore, {Address, Value});
   } else if (isEWASM()) {
-    llvm::Value *AddressPtr = Builder.CreateAlloca(Int256Ty, nullptr);
-    llvm::Value *ValPtr = Builder.CreateAlloca(Int256Ty, nullptr);
+    llvm::Value *AddressPtr = beginScratchSlot(Int256Ty, 0);
+    llvm::Value *ValPtr = beginScratchSlot(Int256Ty, 1);
     Builder.CreateStore(Address, AddressPtr);
     Builder.CreateStore(Value, ValPtr);
     Builder.CreateCall(Func_storageStore, {AddressPtr, ValPtr});
+    endScratchSlot(ValPtr);
+    endScratchSlot(AddressPtr);
   } else {
     __builtin_unreachable();
   }
@@ -2015,11 +2859,14 @@ llvm::Value *CodeGenModule::emitStorageLoad(llvm::Value *Address) {
   if (isEVM()) {
     return Builder.CreateCall(Func_storageLoad, {Address});
   } else if (isEWASM()) {
-    llvm::Value *AddressPtr = Builder.CreateAlloca(Int256Ty, nullptr);
-    llvm::Value *ValPtr = Builder.CreateAlloca(Int256Ty, nullptr);
+    llvm::Value *AddressPtr = beginScratchSlot(Int256Ty, 0);
+    llvm::Value *ValPtr = beginScratchSlot(Int256Ty, 1);
     Builder.CreateStore(Address, AddressPtr);
     Builder.CreateCall(Func_storageLoad, {AddressPtr, ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(Int256Ty, ValPtr);
+    endScratchSlot(ValPtr);
+    endScratchSlot(AddressPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -2150,12 +2997,12 @@ void CodeGenModule::emitReturnDataCopy(llvm::Value *ResultOffset,
 }
 
 llvm::Value *CodeGenModule::emitCallDataLoad(llvm::Value *DataOffset) {
-  llvm::Value *CallDataVPtr =
-      Builder.CreateAlloca(Int8Ty, Builder.getIntN(256, 32));
+  llvm::Value *CallDataPtr = beginScratchSlot(Int256Ty);
+  llvm::Value *CallDataVPtr = Builder.CreateBitCast(CallDataPtr, Int8PtrTy);
   emitCallDataCopy(CallDataVPtr, Builder.CreateZExtOrTrunc(DataOffset, Int32Ty),
                    Builder.getInt32(32));
-  llvm::Value *CallDataPtr = Builder.CreateBitCast(CallDataVPtr, Int256PtrTy);
   llvm::Value *CallData = Builder.CreateLoad(Int256Ty, CallDataPtr);
+  endScratchSlot(CallDataPtr);
   return CallData;
 }
 
@@ -2333,8 +3180,29 @@ llvm::Value *CodeGenModule::emitSha256(llvm::Value *Bytes) {
   return Result;
 }
 
+llvm::Value *CodeGenModule::emitSlotHash(llvm::ArrayRef<llvm::Value *> Words) {
+  if (Words.size() == 1 && Func_slotHash1) {
+    return Builder.CreateCall(Func_slotHash1, Words);
+  }
+  if (Words.size() == 2 && Func_slotHash2) {
+    return Builder.CreateCall(Func_slotHash2, Words);
+  }
+  return emitKeccak256(emitConcatBytes(Words));
+}
+
 void CodeGenModule::emitMemcpy(llvm::Value *Dst, llvm::Value *Src,
                                llvm::Value *Length) {
+  // Short copies of known length are expanded inline by the wasm backend.
+  // Longer ones would become a libc memcpy call, which Ewasm cannot import.
+  constexpr uint64_t MaxInlineMemcpySize = 32;
+  if (isEWASM()) {
+    if (auto *Size = llvm::dyn_cast<llvm::ConstantInt>(Length);
+        Size && Size->getZExtValue() <= MaxInlineMemcpySize) {
+      Builder.CreateMemCpy(Dst, llvm::MaybeAlign(1), Src, llvm::MaybeAlign(1),
+                           Size);
+      return;
+    }
+  }
   Builder.CreateCall(Func_memcpy, {Dst, Src, Length});
 }
 
@@ -2350,9 +3218,11 @@ llvm::Value *CodeGenModule::emitGetTxGasPrice() {
   if (isEVM()) {
     return Builder.CreateCall(Func_getTxGasPrice, {});
   } else if (isEWASM()) {
-    llvm::Value *ValPtr = Builder.CreateAlloca(Int128Ty);
+    llvm::Value *ValPtr = beginScratchSlot(Int128Ty);
     Builder.CreateCall(Func_getTxGasPrice, {ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(Int128Ty, ValPtr);
+    endScratchSlot(ValPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -2363,9 +3233,11 @@ llvm::Value *CodeGenModule::emitGetTxOrigin() {
     return Builder.CreateTrunc(Builder.CreateCall(Func_getTxOrigin, {}),
                                AddressTy);
   } else if (isEWASM()) {
-    llvm::Value *ValPtr = Builder.CreateAlloca(AddressTy);
+    llvm::Value *ValPtr = beginScratchSlot(AddressTy);
     Builder.CreateCall(Func_getTxOrigin, {ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(AddressTy, ValPtr);
+    endScratchSlot(ValPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -2376,9 +3248,11 @@ llvm::Value *CodeGenModule::emitGetBlockCoinbase() {
     return Builder.CreateTrunc(Builder.CreateCall(Func_getBlockCoinbase, {}),
                                AddressTy);
   } else if (isEWASM()) {
-    llvm::Value *ValPtr = Builder.CreateAlloca(AddressTy);
+    llvm::Value *ValPtr = beginScratchSlot(AddressTy);
     Builder.CreateCall(Func_getBlockCoinbase, {ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(AddressTy, ValPtr);
+    endScratchSlot(ValPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -2388,9 +3262,11 @@ llvm::Value *CodeGenModule::emitGetBlockDifficulty() {
   if (isEVM()) {
     return Builder.CreateCall(Func_getBlockDifficulty, {});
   } else if (isEWASM()) {
-    llvm::Value *ValPtr = Builder.CreateAlloca(Int256Ty);
+    llvm::Value *ValPtr = beginScratchSlot(Int256Ty);
     Builder.CreateCall(Func_getBlockDifficulty, {ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(Int256Ty, ValPtr);
+    endScratchSlot(ValPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -2428,10 +3304,12 @@ llvm::Value *CodeGenModule::emitGetBlockHash(llvm::Value *Number) {
     auto BlockNumber = Builder.CreateZExtOrTrunc(Number, EVMIntTy);
     return Builder.CreateCall(Func_getBlockHash, {BlockNumber});
   } else if (isEWASM()) {
-    llvm::Value *ValPtr = Builder.CreateAlloca(Int256Ty);
+    llvm::Value *ValPtr = beginScratchSlot(Int256Ty);
     Builder.CreateCall(Func_getBlockHash,
                        {Builder.CreateZExtOrTrunc(Number, Int64Ty), ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(Int256Ty, ValPtr);
+    endScratchSlot(ValPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -2442,14 +3320,17 @@ llvm::Value *CodeGenModule::emitGetExternalBalance(llvm::Value *Address) {
     auto Addr = Builder.CreatePtrToInt(Address, EVMIntTy);
     return Builder.CreateCall(Func_getExternalBalance, {Addr});
   } else if (isEWASM()) {
-    llvm::Value *AddressPtr = Builder.CreateAlloca(Int256Ty);
-    llvm::Value *ValPtr = Builder.CreateAlloca(Int128Ty);
+    llvm::Value *AddressPtr = beginScratchSlot(Int256Ty);
+    llvm::Value *ValPtr = beginScratchSlot(Int128Ty);
     Builder.CreateStore(Builder.CreateZExtOrTrunc(Address, Int256Ty),
                         AddressPtr);
     Builder.CreateCall(Func_getExternalBalance,
                        {Builder.CreateBitCast(AddressPtr, Int32PtrTy),
                         Builder.CreateBitCast(ValPtr, Int32PtrTy)});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(Int128Ty, ValPtr);
+    endScratchSlot(ValPtr);
+    endScratchSlot(AddressPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -2460,9 +3341,11 @@ llvm::Value *CodeGenModule::emitGetAddress() {
     llvm::Value *Val = Builder.CreateCall(Func_getAddress, {});
     return Builder.CreateZExtOrTrunc(Val, AddressTy);
   } else if (isEWASM()) {
-    llvm::Value *ValPtr = Builder.CreateAlloca(AddressTy);
+    llvm::Value *ValPtr = beginScratchSlot(AddressTy);
     Builder.CreateCall(Func_getAddress, {ValPtr});
-    return Builder.CreateLoad(ValPtr);
+    llvm::Value *Val = Builder.CreateLoad(AddressTy, ValPtr);
+    endScratchSlot(ValPtr);
+    return Val;
   } else {
     __builtin_unreachable();
   }
@@ -61,10 +61,20 @@ class CodeGenModule : public CodeGenTypeCache {
   llvm::GlobalVariable *MemorySize;
   llvm::GlobalVariable *HeapBase;
   llvm::DenseMap<const VarDecl *, llvm::GlobalVariable *> StateVarDeclMap;
+  /// Bit offset within the slot of state variables that share it.
+  llvm::DenseMap<const VarDecl *, unsigned> StateVarShiftMap;
   llvm::DenseMap<const YulData *, llvm::GlobalVariable *> YulDataMap;
-  std::size_t StateVarAddrCursor;
+  StorageAllocator StateVarAllocator;
   llvm::GlobalVariable *ImmtableTable = nullptr;
   llvm::ArrayType *ImmtableArrayType = nullptr;
+  /// Out-parameter buffers of host calls, allocated once per function in its
+  /// entry block and shared by all calls that need one of the same type.
+  llvm::DenseMap<std::pair<const llvm::Function *, llvm::Type *>,
+                 llvm::SmallVector<llvm::AllocaInst *, 2>>
+      ScratchSlots;
+  /// Number of times each profile ID occurs in the -fprofile-use trace.
+  llvm::DenseMap<std::uint32_t, std::uint64_t> ProfileCounts;
+  bool HasProfile = false;
 
   llvm::Function *Func_create = nullptr;
   llvm::Function *Func_call = nullptr;
@@ -111,10 +121,13 @@ class CodeGenModule : public CodeGenTypeCache {
   llvm::Function *Func_print32 = nullptr;
 
   llvm::Function *Func_keccak256 = nullptr;
+  llvm::Function *Func_keccakf = nullptr;
   llvm::Function *Func_sha256 = nullptr;
   llvm::Function *Func_sha3 = nullptr;
   llvm::Function *Func_ripemd160 = nullptr;
   llvm::Function *Func_ecrecover = nullptr;
+  llvm::Function *Func_slotHash1 = nullptr;
+  llvm::Function *Func_slotHash2 = nullptr;
 
   llvm::Function *Func_exp256 = nullptr;
   llvm::Function *Func_bswap256 = nullptr;
@@ -136,9 +149,14 @@ class CodeGenModule : public CodeGenTypeCache {
 
   void initPrebuiltContract();
   void initKeccak256();
+  void initKeccakF();
+  llvm::Value *emitKeccak256Inline(llvm::Value *Ptr, llvm::Value *Length);
+  llvm::Value *emitKeccak256Precompile(llvm::Value *Ptr, llvm::Value *Length);
   void initSha256();
   void initRipemd160();
   void initEcrecover();
+  llvm::Function *initSlotHash(unsigned WordCount);
+  void loadProfile();
 
 public:
   CodeGenModule(const CodeGenModule &) = delete;
@@ -177,6 +195,12 @@ public:
   bool isDynamicType(llvm::Type *Ty);
   llvm::Value *emitConcatBytes(llvm::ArrayRef<llvm::Value *> Values);
   void emitUpdateMemorySize(llvm::Value *Pos, llvm::Value *Range);
+  llvm::AllocaInst *createEntryAlloca(llvm::Type *Ty,
+                                      const llvm::Twine &Name = "");
+  llvm::Value *beginScratchSlot(llvm::Type *Ty, unsigned Index = 0);
+  void endScratchSlot(llvm::Value *Slot);
+  std::uint32_t getProfileID(const FunctionDecl *FD);
+  void emitProfileCounter(std::uint32_t ID);
 
   llvm::Value *emitGetGasLeft();
   llvm::Value *emitGetCallValue();
@@ -222,6 +246,7 @@ public:
   llvm::Value *emitKeccak256(llvm::Value *Bytes);
   llvm::Value *emitKeccak256(llvm::Value *Pos, llvm::Value *Length);
   llvm::Value *emitSha256(llvm::Value *Bytes);
+  llvm::Value *emitSlotHash(llvm::ArrayRef<llvm::Value *> Words);
   void emitMemcpy(llvm::Value *Dst, llvm::Value *Src, llvm::Value *Length);
   llvm::Value *emitGetCallDataSize();
   llvm::Value *emitGetTxGasPrice();
@@ -247,6 +272,11 @@ private:
   llvm::Function *emitNestedObjectGetter(llvm::StringRef Name);
   void emitContractConstructorDecl(const ContractDecl *CD);
   void emitContractDispatcherDecl(const ContractDecl *CD);
+  void applyProfile(const ContractDecl *CD);
+  void emitSelectorDispatch(llvm::Value *Selector,
+                            llvm::ArrayRef<std::uint32_t> Selectors,
+                            llvm::ArrayRef<llvm::BasicBlock *> Targets,
+                            llvm::BasicBlock *Error);
   void emitEventDecl(const EventDecl *ED);
   void emitFunctionDecl(const FunctionDecl *FD);
   void emitVarDecl(const VarDecl *VD);
@@ -279,6 +309,15 @@ public:
   llvm::GlobalVariable *getStateVarAddr(const VarDecl *VD) const {
     return StateVarDeclMap.lookup(VD);
   }
+  /// Shift of a packed state variable within its slot, nullptr if the
+  /// variable has a slot of its own.
+  llvm::Value *getStateVarShift(const VarDecl *VD) {
+    auto It = StateVarShiftMap.find(VD);
+    if (It == StateVarShiftMap.end()) {
+      return nullptr;
+    }
+    return Builder.getIntN(256, It->second);
+  }
   llvm::GlobalVariable *getYulDataAddr(const YulData *YD) const {
     return YulDataMap.lookup(YD);
   }
@@ -67,11 +67,17 @@ ExprValuePtr ExprEmitter::structIndexAccess(const ExprValuePtr StructValue,
   switch (StructValue->getValueKind()) {
   case ValueKind::VK_SValue: {
     llvm::Value *Base = Builder.CreateLoad(StructValue->getValue());
-    llvm::Value *Pos = Builder.getIntN(256, STy->getStoragePos(ElementIndex));
+    const auto [Slot, Offset] = STy->getStorageLocation(ElementIndex);
+    llvm::Value *Pos = Builder.getIntN(256, Slot);
     llvm::Value *ElemAddress = Builder.CreateAdd(Base, Pos);
     llvm::Value *Address = Builder.CreateAlloca(CGF.Int256Ty);
     Builder.CreateStore(ElemAddress, Address);
-    return std::make_shared<ExprValue>(ET.get(), ValueKind::VK_SValue, Address);
+    llvm::Value *Shift = nullptr;
+    if (ET->getStorageSize() < 32) {
+      Shift = Builder.getIntN(256, Offset * 8);
+    }
+    return std::make_shared<ExprValue>(ET.get(), ValueKind::VK_SValue, Address,
+                                       Shift);
   }
   case ValueKind::VK_LValue: {
     llvm::Value *Base = StructValue->getValue();
@@ -123,25 +129,25 @@ ExprValuePtr ExprEmitter::arrayIndexAccess(const ExprValuePtr &Base,
     emitCheckArrayOutOfBound(ArraySize, IndexValue);
 
     // load array position
-    llvm::Value *Bytes = CGF.getCodeGenModule().emitConcatBytes(
-        {CGF.getCodeGenModule().getEndianlessValue(Pos)});
-    Pos = CGF.CGM.emitKeccak256(Bytes);
+    Pos = CGF.CGM.emitSlotHash({CGF.CGM.getEndianlessValue(Pos)});
   } else {
     // Fixed Size Storage Array
     llvm::Value *ArraySize = Builder.getInt(ArrTy->getLength());
     emitCheckArrayOutOfBound(ArraySize, IndexValue);
   }
 
-  unsigned BitPerElement = ArrTy->getElementType()->getBitNum();
-  unsigned ElementPerSlot = 256 / BitPerElement;
+  const unsigned ElementSize = ArrTy->getElementType()->getStorageSize();
 
-  if (ElementPerSlot != 1) {
+  if (ElementSize < 32) {
+    // Elements are packed from the low-order end of each slot.
+    const unsigned ElementPerSlot = 32 / ElementSize;
     llvm::Value *StorageIndex =
         Builder.CreateUDiv(Builder.CreateZExtOrTrunc(IndexValue, CGF.Int256Ty),
                            Builder.getIntN(256, ElementPerSlot));
-    llvm::Value *Shift =
+    llvm::Value *Shift = Builder.CreateMul(
         Builder.CreateURem(Builder.CreateZExtOrTrunc(IndexValue, CGF.Int256Ty),
-                           Builder.getIntN(256, ElementPerSlot));
+                           Builder.getIntN(256, ElementPerSlot)),
+        Builder.getIntN(256, ElementSize * 8));
     llvm::Value *ElemAddress = Builder.CreateAdd(
         Pos, Builder.CreateZExtOrTrunc(StorageIndex, Pos->getType()));
     llvm::Value *Address = Builder.CreateAlloca(CGF.Int256Ty);
@@ -149,8 +155,13 @@ ExprValuePtr ExprEmitter::arrayIndexAccess(const ExprValuePtr &Base,
     return std::make_shared<ExprValue>(Ty, ValueKind::VK_SValue, Address,
                                        Shift);
   } else {
-    llvm::Value *ElemAddress = Builder.CreateAdd(
-        Pos, Builder.CreateZExtOrTrunc(IndexValue, Pos->getType()));
+    llvm::Value *SlotIndex =
+        Builder.CreateZExtOrTrunc(IndexValue, Pos->getType());
+    if (ElementSize > 32) {
+      SlotIndex = Builder.CreateMul(
+          SlotIndex, llvm::ConstantInt::get(Pos->getType(), ElementSize / 32));
+    }
+    llvm::Value *ElemAddress = Builder.CreateAdd(Pos, SlotIndex);
     llvm::Value *Address = Builder.CreateAlloca(CGF.Int256Ty);
     Builder.CreateStore(ElemAddress, Address);
     return std::make_shared<ExprValue>(Ty, ValueKind::VK_SValue, Address);
@@ -669,7 +680,8 @@ ExprValuePtr ExprEmitter::visit(const Identifier *ID) {
     const Type *Ty = VD->getType().get();
     if (VD->isStateVariable()) {
       return std::make_shared<ExprValue>(Ty, ValueKind::VK_SValue,
-                                         CGM.getStateVarAddr(VD));
+                                         CGM.getStateVarAddr(VD),
+                                         CGM.getStateVarShift(VD));
     } else {
       return std::make_shared<ExprValue>(Ty, ValueKind::VK_LValue,
                                          CGF.getAddrOfLocalVar(VD));
@@ -712,16 +724,17 @@ ExprValuePtr ExprEmitter::visit(const IndexAccess *IA) {
   if (const auto *MType = dynamic_cast<const MappingType *>(Base->getType())) {
     llvm::Value *Pos =
         CGM.getEndianlessValue(Builder.CreateLoad(Base->getValue()));
-    llvm::Value *Key;
+    llvm::Value *Address;
     if (MType->getKeyType()->isDynamic()) {
-      Key = Index->load(Builder, CGM);
+      llvm::Value *Key = Index->load(Builder, CGM);
+      Address = CGM.emitKeccak256(CGM.emitConcatBytes({Key, Pos}));
     } else {
-      Key = CGM.getEndianlessValue(
+      llvm::Value *Key = CGM.getEndianlessValue(
           Builder.CreateZExtOrTrunc(Index->load(Builder, CGM), CGF.Int256Ty));
+      Address = CGM.emitSlotHash({Key, Pos});
     }
-    llvm::Value *Bytes = CGM.emitConcatBytes({Key, Pos});
     llvm::Value *AddressPtr = Builder.CreateAlloca(CGF.Int256Ty);
-    Builder.CreateStore(CGM.emitKeccak256(Bytes), AddressPtr);
+    Builder.CreateStore(Address, AddressPtr);
     return std::make_shared<ExprValue>(Ty, ValueKind::VK_SValue, AddressPtr);
   }
   if (const auto *ArrTy = dynamic_cast<const ArrayType *>(Base->getType())) {
@@ -0,0 +1,501 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/FoldHash.h"
+#include "../utils/SHA-3/Keccak.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Operator.h>
+#include <tuple>
+#include <vector>
+
+namespace soll {
+
+namespace {
+
+enum class HashKind { None, Keccak256, Sha256 };
+
+/// Longer inputs are left to the host.
+constexpr uint64_t MaxFoldedLength = 1024;
+
+using Bytes = std::vector<uint8_t>;
+
+static HashKind getHashKind(const llvm::Function *F) {
+  if (!F) {
+    return HashKind::None;
+  }
+  if (F->getName() == "solidity.keccak256") {
+    return HashKind::Keccak256;
+  }
+  if (F->getName() == "solidity.sha256") {
+    return HashKind::Sha256;
+  }
+  return HashKind::None;
+}
+
+/// Hash computed by the body of a solidity.slothash marker, which depends on
+/// the deploy platform.
+static HashKind getSlotHashKind(const llvm::Function *F) {
+  if (!F || !F->isDeclaration() ||
+      !F->getName().startswith("solidity.slothash")) {
+    return HashKind::None;
+  }
+  const llvm::Function *Body =
+      F->getParent()->getFunction((F->getName() + ".body").str());
+  if (!Body || Body->isDeclaration()) {
+    return HashKind::None;
+  }
+  for (const llvm::BasicBlock &BB : *Body) {
+    for (const llvm::Instruction &I : BB) {
+      if (auto *Call = llvm::dyn_cast<llvm::CallInst>(&I)) {
+        const HashKind Kind = getHashKind(Call->getCalledFunction());
+        if (Kind != HashKind::None) {
+          return Kind;
+        }
+      }
+    }
+  }
+  return HashKind::None;
+}
+
+static Bytes keccak256(const Bytes &Input) {
+  Keccak H(256);
+  H.addData(Input.data(), 0, Input.size());
+  return H.digest();
+}
+
+static Bytes sha256(const Bytes &Input) {
+  static const uint32_t K[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+      0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+      0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+      0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+      0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+      0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+      0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+      0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+  uint32_t H[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  auto Rotr = [](uint32_t X, unsigned N) {
+    return (X >> N) | (X << (32 - N));
+  };
+
+  Bytes Message = Input;
+  const uint64_t BitLength = uint64_t(Input.size()) * 8;
+  Message.push_back(0x80);
+  while (Message.size() % 64 != 56) {
+    Message.push_back(0);
+  }
+  for (int I = 7; I >= 0; --I) {
+    Message.push_back(static_cast<uint8_t>(BitLength >> (I * 8)));
+  }
+
+  for (size_t Chunk = 0; Chunk < Message.size(); Chunk += 64) {
+    uint32_t W[64];
+    for (unsigned I = 0; I < 16; ++I) {
+      const uint8_t *P = &Message[Chunk + I * 4];
+      W[I] = uint32_t(P[0]) << 24 | uint32_t(P[1]) << 16 |
+             uint32_t(P[2]) << 8 | uint32_t(P[3]);
+    }
+    for (unsigned I = 16; I < 64; ++I) {
+      const uint32_t S0 =
+          Rotr(W[I - 15], 7) ^ Rotr(W[I - 15], 18) ^ (W[I - 15] >> 3);
+      const uint32_t S1 =
+          Rotr(W[I - 2], 17) ^ Rotr(W[I - 2], 19) ^ (W[I - 2] >> 10);
+      W[I] = W[I - 16] + S0 + W[I - 7] + S1;
+    }
+    uint32_t A = H[0], B = H[1], C = H[2], D = H[3];
+    uint32_t E = H[4], F = H[5], G = H[6], Hh = H[7];
+    for (unsigned I = 0; I < 64; ++I) {
+      const uint32_t S1 = Rotr(E, 6) ^ Rotr(E, 11) ^ Rotr(E, 25);
+      const uint32_t Ch = (E & F) ^ (~E & G);
+      const uint32_t T1 = Hh + S1 + Ch + K[I] + W[I];
+      const uint32_t S0 = Rotr(A, 2) ^ Rotr(A, 13) ^ Rotr(A, 22);
+      const uint32_t Maj = (A & B) ^ (A & C) ^ (B & C);
+      const uint32_t T2 = S0 + Maj;
+      Hh = G;
+      G = F;
+      F = E;
+      E = D + T1;
+      D = C;
+      C = B;
+      B = A;
+      A = T1 + T2;
+    }
+    H[0] += A;
+    H[1] += B;
+    H[2] += C;
+    H[3] += D;
+    H[4] += E;
+    H[5] += F;
+    H[6] += G;
+    H[7] += Hh;
+  }
+
+  Bytes Digest;
+  for (uint32_t Word : H) {
+    for (int I = 3; I >= 0; --I) {
+      Digest.push_back(static_cast<uint8_t>(Word >> (I * 8)));
+    }
+  }
+  return Digest;
+}
+
+/// Value of an integer computed from constants, including the slot numbers
+/// of state variables and their byte swaps.
+static llvm::Optional<llvm::APInt> evaluateInteger(llvm::Value *V,
+                                                   unsigned Depth = 0) {
+  if (Depth > 8 || !V->getType()->isIntegerTy()) {
+    return llvm::None;
+  }
+  if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(V)) {
+    return C->getValue();
+  }
+  if (auto *Load = llvm::dyn_cast<llvm::LoadInst>(V)) {
+    auto *GV = llvm::dyn_cast<llvm::GlobalVariable>(
+        Load->getPointerOperand()->stripPointerCasts());
+    if (GV && GV->isConstant() && GV->hasDefinitiveInitializer() &&
+        Load->isSimple() && GV->getInitializer()->getType() == V->getType()) {
+      if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(GV->getInitializer())) {
+        return C->getValue();
+      }
+    }
+    return llvm::None;
+  }
+  if (auto *Call = llvm::dyn_cast<llvm::CallInst>(V)) {
+    const llvm::Function *Callee = Call->getCalledFunction();
+    if (Callee && Call->arg_size() == 1 &&
+        (Callee->getName() == "solidity.bswapi256" ||
+         Callee->getIntrinsicID() == llvm::Intrinsic::bswap)) {
+      auto Arg = evaluateInteger(Call->getArgOperand(0), Depth + 1);
+      if (Arg && Arg->getBitWidth() % 16 == 0 &&
+          Arg->getBitWidth() == V->getType()->getIntegerBitWidth()) {
+        return Arg->byteSwap();
+      }
+    }
+    return llvm::None;
+  }
+  if (auto *Cast = llvm::dyn_cast<llvm::CastInst>(V)) {
+    auto Arg = evaluateInteger(Cast->getOperand(0), Depth + 1);
+    if (!Arg) {
+      return llvm::None;
+    }
+    const unsigned Width = V->getType()->getIntegerBitWidth();
+    switch (Cast->getOpcode()) {
+    case llvm::Instruction::ZExt:
+      return Arg->zext(Width);
+    case llvm::Instruction::SExt:
+      return Arg->sext(Width);
+    case llvm::Instruction::Trunc:
+      return Arg->trunc(Width);
+    default:
+      return llvm::None;
+    }
+  }
+  if (auto *BO = llvm::dyn_cast<llvm::BinaryOperator>(V)) {
+    auto LHS = evaluateInteger(BO->getOperand(0), Depth + 1);
+    auto RHS = evaluateInteger(BO->getOperand(1), Depth + 1);
+    if (!LHS || !RHS) {
+      return llvm::None;
+    }
+    switch (BO->getOpcode()) {
+    case llvm::Instruction::Add:
+      return *LHS + *RHS;
+    case llvm::Instruction::Sub:
+      return *LHS - *RHS;
+    case llvm::Instruction::Mul:
+      return *LHS * *RHS;
+    case llvm::Instruction::And:
+      return *LHS & *RHS;
+    case llvm::Instruction::Or:
+      return *LHS | *RHS;
+    case llvm::Instruction::Xor:
+      return *LHS ^ *RHS;
+    case llvm::Instruction::Shl:
+      if (RHS->ult(LHS->getBitWidth())) {
+        return LHS->shl(*RHS);
+      }
+      return llvm::None;
+    case llvm::Instruction::LShr:
+      if (RHS->ult(LHS->getBitWidth())) {
+        return LHS->lshr(*RHS);
+      }
+      return llvm::None;
+    default:
+      return llvm::None;
+    }
+  }
+  return llvm::None;
+}
+
+/// Append \p Value as it is laid out in little-endian memory.
+static void appendLittleEndian(Bytes &Out, const llvm::APInt &Value) {
+  for (unsigned I = 0; I < Value.getBitWidth() / 8; ++I) {
+    Out.push_back(
+        static_cast<uint8_t>(Value.lshr(I * 8).trunc(8).getZExtValue()));
+  }
+}
+
+/// Field \p Index of a bytes value, built either as a constant or by a
+/// chain of insertvalue instructions.
+static llvm::Value *getField(llvm::Value *Aggregate, unsigned Index) {
+  while (auto *IV = llvm::dyn_cast<llvm::InsertValueInst>(Aggregate)) {
+    if (IV->getNumIndices() == 1 && IV->getIndices()[0] == Index) {
+      return IV->getInsertedValueOperand();
+    }
+    Aggregate = IV->getAggregateOperand();
+  }
+  if (auto *C = llvm::dyn_cast<llvm::Constant>(Aggregate)) {
+    return C->getAggregateElement(Index);
+  }
+  return nullptr;
+}
+
+/// Bytes [Offset, Offset + Length) of the initializer of a constant global,
+/// such as a string literal.
+static llvm::Optional<Bytes> readGlobal(const llvm::GlobalVariable *GV,
+                                        uint64_t Offset, uint64_t Length,
+                                        const llvm::DataLayout &DL) {
+  if (!GV->isConstant() || !GV->hasDefinitiveInitializer()) {
+    return llvm::None;
+  }
+  const llvm::Constant *Init = GV->getInitializer();
+  if (Offset + Length > DL.getTypeAllocSize(Init->getType())) {
+    return llvm::None;
+  }
+  if (llvm::isa<llvm::ConstantAggregateZero>(Init)) {
+    return Bytes(Length, 0);
+  }
+  auto *Data = llvm::dyn_cast<llvm::ConstantDataSequential>(Init);
+  if (!Data || !Data->getElementType()->isIntegerTy(8)) {
+    return llvm::None;
+  }
+  llvm::StringRef Raw = Data->getRawDataValues().substr(Offset, Length);
+  return Bytes(Raw.bytes_begin(), Raw.bytes_end());
+}
+
+/// Whether \p V, a bytes value holding a pointer to a buffer, is only
+/// passed to hash helpers, which read the buffer.
+static bool isOnlyHashed(const llvm::Value *V) {
+  for (const llvm::User *U : V->users()) {
+    if (llvm::isa<llvm::InsertValueInst>(U)) {
+      if (!isOnlyHashed(U)) {
+        return false;
+      }
+    } else if (auto *Call = llvm::dyn_cast<llvm::CallInst>(U)) {
+      if (getHashKind(Call->getCalledFunction()) == HashKind::None) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Contents of a buffer from emitConcatBytes when every write to it before
+/// \p Call stores a known value. The buffer must not escape, so nothing
+/// else can write to it.
+static llvm::Optional<Bytes> readAlloca(llvm::AllocaInst *Alloca,
+                                        uint64_t Offset, uint64_t Length,
+                                        llvm::CallInst *Call,
+                                        const llvm::DataLayout &DL) {
+  if (Alloca->getParent() != Call->getParent()) {
+    return llvm::None;
+  }
+  llvm::DenseMap<const llvm::Instruction *, int64_t> Writes;
+  llvm::SmallVector<std::pair<llvm::Value *, int64_t>, 8> Worklist;
+  Worklist.emplace_back(Alloca, 0);
+  while (!Worklist.empty()) {
+    llvm::Value *Ptr;
+    int64_t PtrOffset;
+    std::tie(Ptr, PtrOffset) = Worklist.pop_back_val();
+    for (llvm::User *U : Ptr->users()) {
+      auto *I = llvm::dyn_cast<llvm::Instruction>(U);
+      if (!I) {
+        return llvm::None;
+      }
+      if (llvm::isa<llvm::BitCastInst>(I)) {
+        Worklist.emplace_back(I, PtrOffset);
+      } else if (auto *GEP = llvm::dyn_cast<llvm::GetElementPtrInst>(I)) {
+        llvm::APInt GEPOffset(DL.getIndexTypeSizeInBits(GEP->getType()), 0);
+        if (GEP->getPointerOperand() != Ptr ||
+            !GEP->accumulateConstantOffset(DL, GEPOffset)) {
+          return llvm::None;
+        }
+        Worklist.emplace_back(GEP, PtrOffset + GEPOffset.getSExtValue());
+      } else if (auto *Store = llvm::dyn_cast<llvm::StoreInst>(I)) {
+        if (Store->getValueOperand() == Ptr || !Store->isSimple()) {
+          return llvm::None;
+        }
+        Writes[Store] = PtrOffset;
+      } else if (auto *Copy = llvm::dyn_cast<llvm::MemCpyInst>(I)) {
+        if (Copy->getRawDest() == Ptr) {
+          Writes[Copy] = PtrOffset;
+        } else if (Copy->getRawSource() != Ptr) {
+          return llvm::None;
+        }
+      } else if (llvm::isa<llvm::LoadInst>(I)) {
+        continue;
+      } else if (!llvm::isa<llvm::InsertValueInst>(I) || !isOnlyHashed(I)) {
+        return llvm::None;
+      }
+      if (Writes.count(I) && I->getParent() != Call->getParent()) {
+        return llvm::None;
+      }
+    }
+  }
+
+  Bytes Result(Length, 0);
+  std::vector<bool> Known(Length, false);
+  auto Write = [&](int64_t At, const Bytes &Data) {
+    for (size_t I = 0; I < Data.size(); ++I) {
+      const int64_t Index = At + int64_t(I) - int64_t(Offset);
+      if (Index >= 0 && uint64_t(Index) < Length) {
+        Result[Index] = Data[I];
+        Known[Index] = true;
+      }
+    }
+  };
+  for (llvm::Instruction &I : *Call->getParent()) {
+    if (&I == Call) {
+      break;
+    }
+    auto It = Writes.find(&I);
+    if (It == Writes.end()) {
+      continue;
+    }
+    if (auto *Store = llvm::dyn_cast<llvm::StoreInst>(&I)) {
+      auto Value = evaluateInteger(Store->getValueOperand());
+      if (!Value || Value->getBitWidth() % 8 != 0) {
+        return llvm::None;
+      }
+      Bytes Data;
+      appendLittleEndian(Data, *Value);
+      Write(It->second, Data);
+    } else {
+      auto *Copy = llvm::cast<llvm::MemCpyInst>(&I);
+      auto *Size = llvm::dyn_cast<llvm::ConstantInt>(Copy->getLength());
+      llvm::APInt SourceOffset(
+          DL.getIndexTypeSizeInBits(Copy->getRawSource()->getType()), 0);
+      auto *GV = llvm::dyn_cast<llvm::GlobalVariable>(
+          Copy->getRawSource()->stripAndAccumulateInBoundsConstantOffsets(
+              DL, SourceOffset));
+      if (!Size || !GV || SourceOffset.isNegative()) {
+        return llvm::None;
+      }
+      auto Data = readGlobal(GV, SourceOffset.getZExtValue(),
+                             Size->getZExtValue(), DL);
+      if (!Data) {
+        return llvm::None;
+      }
+      Write(It->second, *Data);
+    }
+  }
+  for (bool K : Known) {
+    if (!K) {
+      return llvm::None;
+    }
+  }
+  return Result;
+}
+
+/// Input of a keccak256 or sha256 helper call if it is known.
+static llvm::Optional<Bytes> readHashInput(llvm::CallInst *Call,
+                                           const llvm::DataLayout &DL) {
+  llvm::Value *Input = Call->getArgOperand(0);
+  llvm::Value *LengthValue = getField(Input, 0);
+  llvm::Value *Ptr = getField(Input, 1);
+  if (!LengthValue || !Ptr) {
+    return llvm::None;
+  }
+  auto Length = evaluateInteger(LengthValue);
+  if (!Length || Length->ugt(MaxFoldedLength)) {
+    return llvm::None;
+  }
+  const uint64_t Size = Length->getZExtValue();
+  if (Size == 0) {
+    return Bytes();
+  }
+  llvm::APInt Offset(DL.getIndexTypeSizeInBits(Ptr->getType()), 0);
+  llvm::Value *Base =
+      Ptr->stripAndAccumulateInBoundsConstantOffsets(DL, Offset);
+  if (Offset.isNegative()) {
+    return llvm::None;
+  }
+  if (auto *GV = llvm::dyn_cast<llvm::GlobalVariable>(Base)) {
+    return readGlobal(GV, Offset.getZExtValue(), Size, DL);
+  }
+  if (auto *Alloca = llvm::dyn_cast<llvm::AllocaInst>(Base)) {
+    return readAlloca(Alloca, Offset.getZExtValue(), Size, Call, DL);
+  }
+  return llvm::None;
+}
+
+/// Input of a solidity.slothash marker call if all its words are known. The
+/// words are stored to memory as they are, so the bytes are little-endian.
+static llvm::Optional<Bytes> readSlotHashInput(llvm::CallInst *Call) {
+  Bytes Input;
+  for (llvm::Value *Arg : Call->args()) {
+    auto Word = evaluateInteger(Arg);
+    if (!Word) {
+      return llvm::None;
+    }
+    appendLittleEndian(Input, *Word);
+  }
+  return Input;
+}
+
+} // namespace
+
+llvm::PreservedAnalyses FoldHash::run(llvm::Function &F,
+                                      llvm::FunctionAnalysisManager &FAM) {
+  if (getHashKind(&F) != HashKind::None ||
+      F.getName().startswith("solidity.slothash")) {
+    return llvm::PreservedAnalyses::all();
+  }
+  const llvm::DataLayout &DL = F.getParent()->getDataLayout();
+
+  bool Changed = false;
+  for (llvm::BasicBlock &BB : F) {
+    for (auto It = BB.begin(); It != BB.end();) {
+      auto *Call = llvm::dyn_cast<llvm::CallInst>(&*It++);
+      if (!Call) {
+        continue;
+      }
+      const llvm::Function *Callee = Call->getCalledFunction();
+      llvm::Optional<Bytes> Input;
+      HashKind Kind = getHashKind(Callee);
+      if (Kind != HashKind::None) {
+        Input = readHashInput(Call, DL);
+      } else if ((Kind = getSlotHashKind(Callee)) != HashKind::None) {
+        Input = readSlotHashInput(Call);
+      }
+      if (!Input) {
+        continue;
+      }
+
+      // The helpers return the digest read as a big-endian integer.
+      const Bytes Digest =
+          Kind == HashKind::Keccak256 ? keccak256(*Input) : sha256(*Input);
+      llvm::APInt Result(256, 0);
+      for (uint8_t Byte : Digest) {
+        Result = Result.shl(8);
+        Result |= Byte;
+      }
+      Call->replaceAllUsesWith(llvm::ConstantInt::get(Call->getType(), Result));
+      Call->eraseFromParent();
+      Changed = true;
+    }
+  }
+  return Changed ? llvm::PreservedAnalyses::none()
+                 : llvm::PreservedAnalyses::all();
+}
+
+} // namespace soll
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/LowerSlotHash.h"
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+
+namespace soll {
+
+namespace {
+
+/// Remove \p Bodies from llvm.compiler.used, and the list itself once it is
+/// empty.
+static void
+removeFromCompilerUsed(llvm::Module &M,
+                       const llvm::SmallPtrSetImpl<llvm::Function *> &Bodies) {
+  llvm::GlobalVariable *Used = M.getGlobalVariable("llvm.compiler.used");
+  if (!Used || !Used->hasInitializer()) {
+    return;
+  }
+  auto *Init = llvm::dyn_cast<llvm::ConstantArray>(Used->getInitializer());
+  if (!Init) {
+    return;
+  }
+  llvm::SmallVector<llvm::Constant *, 4> Kept;
+  for (llvm::Value *Op : Init->operands()) {
+    auto *F = llvm::dyn_cast<llvm::Function>(Op->stripPointerCasts());
+    if (!F || !Bodies.count(F)) {
+      Kept.push_back(llvm::cast<llvm::Constant>(Op));
+    }
+  }
+  if (Kept.size() == Init->getNumOperands()) {
+    return;
+  }
+  Used->eraseFromParent();
+  if (Kept.empty()) {
+    return;
+  }
+  auto *Ty = llvm::ArrayType::get(Init->getType()->getElementType(),
+                                  Kept.size());
+  auto *NewUsed = new llvm::GlobalVariable(
+      M, Ty, false, llvm::GlobalValue::AppendingLinkage,
+      llvm::ConstantArray::get(Ty, Kept), "llvm.compiler.used");
+  NewUsed->setSection("llvm.metadata");
+}
+
+} // namespace
+
+llvm::PreservedAnalyses LowerSlotHash::run(llvm::Module &M,
+                                           llvm::ModuleAnalysisManager &MAM) {
+  llvm::SmallVector<llvm::Function *, 2> Markers;
+  llvm::SmallPtrSet<llvm::Function *, 2> Bodies;
+  for (llvm::Function &F : M) {
+    if (F.isDeclaration() && F.getName().startswith("solidity.slothash")) {
+      llvm::Function *Body = M.getFunction((F.getName() + ".body").str());
+      if (Body && Body->getFunctionType() == F.getFunctionType()) {
+        Markers.push_back(&F);
+        Bodies.insert(Body);
+      }
+    }
+  }
+  if (Markers.empty()) {
+    return llvm::PreservedAnalyses::all();
+  }
+
+  for (llvm::Function *Marker : Markers) {
+    llvm::Function *Body = M.getFunction((Marker->getName() + ".body").str());
+    for (llvm::User *U : llvm::make_early_inc_range(Marker->users())) {
+      if (auto *Call = llvm::dyn_cast<llvm::CallInst>(U)) {
+        // Drop the readnone the call may have inherited from the marker.
+        Call->setAttributes(llvm::AttributeList());
+        Call->setCalledFunction(Body);
+      }
+    }
+    if (Marker->use_empty()) {
+      Marker->eraseFromParent();
+    }
+  }
+  removeFromCompilerUsed(M, Bodies);
+  for (llvm::Function *Body : Bodies) {
+    Body->removeDeadConstantUsers();
+    if (Body->use_empty()) {
+      Body->eraseFromParent();
+    }
+  }
+  return llvm::PreservedAnalyses::none();
+}
+
+} // namespace soll
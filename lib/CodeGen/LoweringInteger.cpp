@@ -29,6 +29,61 @@ static std::string createName(llvm::StringRef Prefix, unsigned int BitWidth) {
   return Result;
 }
 
+/// Split a 256-bit value into \p Count limbs of \p LimbBits bits each,
+/// zero-extended to i64, least significant first.
+static llvm::SmallVector<llvm::Value *, 8>
+splitLimbs(llvm::IRBuilder<> &Builder, llvm::Value *V, unsigned LimbBits,
+           unsigned Count) {
+  llvm::SmallVector<llvm::Value *, 8> Limbs;
+  for (unsigned I = 0; I < Count; ++I) {
+    llvm::Value *Limb = Builder.CreateTrunc(
+        Builder.CreateLShr(V, I * LimbBits), Builder.getIntNTy(LimbBits));
+    Limbs.push_back(Builder.CreateZExt(Limb, Builder.getInt64Ty()));
+  }
+  return Limbs;
+}
+
+/// Reassemble limbs produced by splitLimbs into an i256.
+static llvm::Value *joinLimbs(llvm::IRBuilder<> &Builder,
+                              llvm::ArrayRef<llvm::Value *> Limbs,
+                              unsigned LimbBits) {
+  llvm::Type *Int256Ty = Builder.getIntNTy(256);
+  llvm::Type *LimbTy = Builder.getIntNTy(LimbBits);
+  llvm::Value *Result = Builder.getIntN(256, 0);
+  for (unsigned I = 0; I < Limbs.size(); ++I) {
+    llvm::Value *Limb = Builder.CreateZExt(
+        Builder.CreateTrunc(Limbs[I], LimbTy), Int256Ty);
+    Result = Builder.CreateOr(Result, Builder.CreateShl(Limb, I * LimbBits));
+  }
+  return Result;
+}
+
+/// Full 64x64->128 bit product from 32-bit halves, since wasm only has a
+/// 64-bit multiply. Returns the low and high words.
+static std::pair<llvm::Value *, llvm::Value *>
+createMulWide64(llvm::IRBuilder<> &Builder, llvm::Value *X, llvm::Value *Y) {
+  llvm::ConstantInt *Mask = Builder.getInt64(0xFFFFFFFF);
+  llvm::Value *X0 = Builder.CreateAnd(X, Mask);
+  llvm::Value *X1 = Builder.CreateLShr(X, 32);
+  llvm::Value *Y0 = Builder.CreateAnd(Y, Mask);
+  llvm::Value *Y1 = Builder.CreateLShr(Y, 32);
+  llvm::Value *P00 = Builder.CreateMul(X0, Y0);
+  llvm::Value *P01 = Builder.CreateMul(X0, Y1);
+  llvm::Value *P10 = Builder.CreateMul(X1, Y0);
+  llvm::Value *P11 = Builder.CreateMul(X1, Y1);
+  llvm::Value *Mid = Builder.CreateAdd(
+      Builder.CreateAdd(Builder.CreateLShr(P00, 32),
+                        Builder.CreateAnd(P01, Mask)),
+      Builder.CreateAnd(P10, Mask));
+  llvm::Value *Lo = Builder.CreateOr(Builder.CreateAnd(P00, Mask),
+                                     Builder.CreateShl(Mid, 32));
+  llvm::Value *Hi = Builder.CreateAdd(
+      Builder.CreateAdd(P11, Builder.CreateLShr(P01, 32)),
+      Builder.CreateAdd(Builder.CreateLShr(P10, 32),
+                        Builder.CreateLShr(Mid, 32)));
+  return {Lo, Hi};
+}
+
 } // namespace
 
 llvm::Function *LoweringInteger::GetMulFunction(const unsigned int BitWidth) {
@@ -38,6 +93,11 @@ llvm::Function *LoweringInteger::GetMulFunction(const unsigned int BitWidth) {
       return iter->getSecond();
     }
   }
+  if (BitWidth == 256) {
+    llvm::Function *Result = CreateMul256Function();
+    MulFunction.try_emplace(BitWidth, Result);
+    return Result;
+  }
   llvm::LLVMContext &Context = TheModule->getContext();
   llvm::IRBuilder<> Builder(Context);
   llvm::Type *IntHiTy = Builder.getIntNTy(BitWidth);
@@ -110,6 +170,426 @@ llvm::Function *LoweringInteger::GetMulFunction(const unsigned int BitWidth) {
   return Result;
 }
 
+llvm::Function *LoweringInteger::CreateMul256Function() {
+  llvm::LLVMContext &Context = TheModule->getContext();
+  llvm::IRBuilder<> Builder(Context);
+  llvm::Type *Int256Ty = Builder.getIntNTy(256);
+  llvm::Function *Result = llvm::Function::Create(
+      llvm::FunctionType::get(Int256Ty, {Int256Ty, Int256Ty}, false),
+      llvm::Function::InternalLinkage, "__mul256", *TheModule);
+
+  llvm::Argument *LHS = Result->arg_begin();
+  LHS->setName("lhs");
+  llvm::Argument *RHS = LHS + 1;
+  RHS->setName("rhs");
+
+  llvm::BasicBlock *Entry = llvm::BasicBlock::Create(Context, "entry", Result);
+  Builder.SetInsertPoint(Entry);
+
+  // Schoolbook product of 4x64-bit limbs, accumulated column by column
+  // (Comba) into a three word carry chain. Only the low 256 bits are kept, so
+  // the last column needs just the low halves of its partial products.
+  auto A = splitLimbs(Builder, LHS, 64, 4);
+  auto B = splitLimbs(Builder, RHS, 64, 4);
+  llvm::Type *Int64Ty = Builder.getInt64Ty();
+  llvm::Value *Zero = Builder.getInt64(0);
+  llvm::Value *C0 = Zero;
+  llvm::Value *C1 = Zero;
+  llvm::Value *C2 = Zero;
+  llvm::SmallVector<llvm::Value *, 4> Limbs;
+  for (unsigned K = 0; K < 4; ++K) {
+    for (unsigned I = 0; I <= K; ++I) {
+      if (K == 3) {
+        C0 = Builder.CreateAdd(C0, Builder.CreateMul(A[I], B[K - I]));
+        continue;
+      }
+      auto [Lo, Hi] = createMulWide64(Builder, A[I], B[K - I]);
+      C0 = Builder.CreateAdd(C0, Lo);
+      llvm::Value *Carry0 =
+          Builder.CreateZExt(Builder.CreateICmpULT(C0, Lo), Int64Ty);
+      C1 = Builder.CreateAdd(C1, Hi);
+      llvm::Value *Carry1 =
+          Builder.CreateZExt(Builder.CreateICmpULT(C1, Hi), Int64Ty);
+      C1 = Builder.CreateAdd(C1, Carry0);
+      llvm::Value *Carry2 =
+          Builder.CreateZExt(Builder.CreateICmpULT(C1, Carry0), Int64Ty);
+      C2 = Builder.CreateAdd(C2, Builder.CreateAdd(Carry1, Carry2));
+    }
+    Limbs.push_back(C0);
+    C0 = C1;
+    C1 = C2;
+    C2 = Zero;
+  }
+
+  Builder.CreateRet(joinLimbs(Builder, Limbs, 64));
+  return Result;
+}
+
+llvm::Function *LoweringInteger::GetUDivRem256Function() {
+  if (UDivRem256Function) {
+    return UDivRem256Function;
+  }
+  llvm::LLVMContext &Context = TheModule->getContext();
+  llvm::IRBuilder<> Builder(Context);
+  llvm::IntegerType *Int256Ty = Builder.getIntNTy(256);
+  llvm::IntegerType *Int64Ty = Builder.getInt64Ty();
+  llvm::IntegerType *Int32Ty = Builder.getInt32Ty();
+  llvm::PointerType *Int256PtrTy = llvm::PointerType::getUnqual(Int256Ty);
+  llvm::Function *Result = llvm::Function::Create(
+      llvm::FunctionType::get(Builder.getVoidTy(),
+                              {Int256Ty, Int256Ty, Int256PtrTy, Int256PtrTy},
+                              false),
+      llvm::Function::InternalLinkage, "__udivrem256", *TheModule);
+  UDivRem256Function = Result;
+
+  llvm::Argument *Dividend = Result->arg_begin();
+  Dividend->setName("dividend");
+  llvm::Argument *Divisor = Dividend + 1;
+  Divisor->setName("divisor");
+  llvm::Argument *QuotientPtr = Divisor + 1;
+  QuotientPtr->setName("quotient");
+  llvm::Argument *RemainderPtr = QuotientPtr + 1;
+  RemainderPtr->setName("remainder");
+
+  // Knuth's algorithm D (TAOCP 4.3.1, in the formulation of Hacker's Delight
+  // divmnu) on 32-bit digits held in i64, so that every digit step maps to
+  // native wasm i64 arithmetic.
+  llvm::BasicBlock *Entry = llvm::BasicBlock::Create(Context, "entry", Result);
+  llvm::BasicBlock *Fast = llvm::BasicBlock::Create(Context, "fast", Result);
+  llvm::BasicBlock *General =
+      llvm::BasicBlock::Create(Context, "general", Result);
+  llvm::BasicBlock *DivZero =
+      llvm::BasicBlock::Create(Context, "div-zero", Result);
+  llvm::BasicBlock *CheckLess =
+      llvm::BasicBlock::Create(Context, "check-less", Result);
+  llvm::BasicBlock *Less = llvm::BasicBlock::Create(Context, "less", Result);
+  llvm::BasicBlock *Normalize =
+      llvm::BasicBlock::Create(Context, "normalize", Result);
+  llvm::BasicBlock *Short = llvm::BasicBlock::Create(Context, "short", Result);
+  llvm::BasicBlock *ShortExit =
+      llvm::BasicBlock::Create(Context, "short-exit", Result);
+  llvm::BasicBlock *Knuth = llvm::BasicBlock::Create(Context, "knuth", Result);
+  llvm::BasicBlock *Outer = llvm::BasicBlock::Create(Context, "outer", Result);
+  llvm::BasicBlock *Adjust =
+      llvm::BasicBlock::Create(Context, "adjust", Result);
+  llvm::BasicBlock *AdjustCheck =
+      llvm::BasicBlock::Create(Context, "adjust-check", Result);
+  llvm::BasicBlock *AdjustDec =
+      llvm::BasicBlock::Create(Context, "adjust-dec", Result);
+  llvm::BasicBlock *MulSubEntry =
+      llvm::BasicBlock::Create(Context, "mulsub-entry", Result);
+  llvm::BasicBlock *MulSub =
+      llvm::BasicBlock::Create(Context, "mulsub", Result);
+  llvm::BasicBlock *MulSubExit =
+      llvm::BasicBlock::Create(Context, "mulsub-exit", Result);
+  llvm::BasicBlock *AddBack =
+      llvm::BasicBlock::Create(Context, "addback", Result);
+  llvm::BasicBlock *AddBackExit =
+      llvm::BasicBlock::Create(Context, "addback-exit", Result);
+  llvm::BasicBlock *Next = llvm::BasicBlock::Create(Context, "next", Result);
+  llvm::BasicBlock *Finish =
+      llvm::BasicBlock::Create(Context, "finish", Result);
+
+  llvm::ConstantInt *Zero256 = Builder.getIntN(256, 0);
+  llvm::ConstantInt *Zero64 = Builder.getInt64(0);
+  llvm::ConstantInt *One64 = Builder.getInt64(1);
+  llvm::ConstantInt *Base = Builder.getInt64(1ull << 32);
+  llvm::ConstantInt *Mask = Builder.getInt64(0xFFFFFFFF);
+  llvm::ConstantInt *Zero32 = Builder.getInt32(0);
+  llvm::ConstantInt *One32 = Builder.getInt32(1);
+  llvm::Function *CTLZ = llvm::Intrinsic::getDeclaration(
+      TheModule, llvm::Intrinsic::ctlz, Int256Ty);
+
+  // un: normalized dividend (m + 1 digits), vn: normalized divisor, q: digits
+  // of the quotient.
+  Builder.SetInsertPoint(Entry);
+  llvm::ArrayType *UNTy = llvm::ArrayType::get(Int64Ty, 9);
+  llvm::ArrayType *VNTy = llvm::ArrayType::get(Int64Ty, 8);
+  llvm::ArrayType *QTy = llvm::ArrayType::get(Int64Ty, 9);
+  llvm::Value *UN = Builder.CreateAlloca(UNTy, nullptr, "un");
+  llvm::Value *VN = Builder.CreateAlloca(VNTy, nullptr, "vn");
+  llvm::Value *QA = Builder.CreateAlloca(QTy, nullptr, "q");
+  auto DigitPtr = [&Builder, Zero32](llvm::Type *Ty, llvm::Value *Array,
+                                     llvm::Value *Index) {
+    return Builder.CreateInBoundsGEP(Ty, Array, {Zero32, Index});
+  };
+  auto LoadDigit = [&](llvm::Type *Ty, llvm::Value *Array,
+                       llvm::Value *Index) -> llvm::Value * {
+    return Builder.CreateLoad(Int64Ty, DigitPtr(Ty, Array, Index));
+  };
+  auto StoreDigit = [&](llvm::Value *Digit, llvm::Type *Ty, llvm::Value *Array,
+                        llvm::Value *Index) {
+    Builder.CreateStore(Digit, DigitPtr(Ty, Array, Index));
+  };
+
+  // Both operands fit in 64 bits: one native division.
+  llvm::Value *HighBits = Builder.CreateOr(Builder.CreateLShr(Dividend, 64),
+                                           Builder.CreateLShr(Divisor, 64));
+  Builder.CreateCondBr(Builder.CreateICmpEQ(HighBits, Zero256), Fast, General);
+
+  Builder.SetInsertPoint(Fast);
+  {
+    llvm::Value *U = Builder.CreateTrunc(Dividend, Int64Ty);
+    llvm::Value *V = Builder.CreateTrunc(Divisor, Int64Ty);
+    llvm::Value *IsZero = Builder.CreateICmpEQ(V, Zero64);
+    llvm::Value *SafeV = Builder.CreateSelect(IsZero, One64, V);
+    llvm::Value *Q = Builder.CreateSelect(IsZero, Zero64,
+                                          Builder.CreateUDiv(U, SafeV));
+    llvm::Value *R = Builder.CreateSelect(IsZero, Zero64,
+                                          Builder.CreateURem(U, SafeV));
+    Builder.CreateStore(Builder.CreateZExt(Q, Int256Ty), QuotientPtr);
+    Builder.CreateStore(Builder.CreateZExt(R, Int256Ty), RemainderPtr);
+    Builder.CreateRetVoid();
+  }
+
+  Builder.SetInsertPoint(General);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Divisor, Zero256), DivZero,
+                       CheckLess);
+
+  Builder.SetInsertPoint(DivZero);
+  Builder.CreateStore(Zero256, QuotientPtr);
+  Builder.CreateStore(Zero256, RemainderPtr);
+  Builder.CreateRetVoid();
+
+  Builder.SetInsertPoint(CheckLess);
+  Builder.CreateCondBr(Builder.CreateICmpULT(Dividend, Divisor), Less,
+                       Normalize);
+
+  Builder.SetInsertPoint(Less);
+  Builder.CreateStore(Zero256, QuotientPtr);
+  Builder.CreateStore(Dividend, RemainderPtr);
+  Builder.CreateRetVoid();
+
+  // Shift the divisor left until its top digit has its high bit set, and the
+  // dividend by the same amount into one extra digit.
+  Builder.SetInsertPoint(Normalize);
+  llvm::Value *ClzV = Builder.CreateTrunc(
+      Builder.CreateCall(CTLZ, {Divisor, Builder.getTrue()}), Int32Ty);
+  llvm::Value *ClzU = Builder.CreateTrunc(
+      Builder.CreateCall(CTLZ, {Dividend, Builder.getTrue()}), Int32Ty);
+  llvm::Value *N =
+      Builder.CreateSub(Builder.getInt32(8), Builder.CreateLShr(ClzV, 5), "n");
+  llvm::Value *M =
+      Builder.CreateSub(Builder.getInt32(8), Builder.CreateLShr(ClzU, 5), "m");
+  llvm::Value *S = Builder.CreateZExt(
+      Builder.CreateAnd(ClzV, Builder.getInt32(31)), Int64Ty, "s");
+  {
+    auto U = splitLimbs(Builder, Dividend, 32, 8);
+    auto V = splitLimbs(Builder, Divisor, 32, 8);
+    for (unsigned I = 0; I <= 8; ++I) {
+      llvm::Value *Digit = Zero64;
+      if (I < 8) {
+        Digit = Builder.CreateAnd(Builder.CreateShl(U[I], S), Mask);
+      }
+      if (I > 0) {
+        Digit = Builder.CreateOr(
+            Digit, Builder.CreateLShr(Builder.CreateShl(U[I - 1], S), 32));
+      }
+      StoreDigit(Digit, UNTy, UN, Builder.getInt32(I));
+      StoreDigit(Zero64, QTy, QA, Builder.getInt32(I));
+    }
+    for (unsigned I = 0; I < 8; ++I) {
+      llvm::Value *Digit = Builder.CreateAnd(Builder.CreateShl(V[I], S), Mask);
+      if (I > 0) {
+        Digit = Builder.CreateOr(
+            Digit, Builder.CreateLShr(Builder.CreateShl(V[I - 1], S), 32));
+      }
+      StoreDigit(Digit, VNTy, VN, Builder.getInt32(I));
+    }
+  }
+  llvm::Value *VTop =
+      LoadDigit(VNTy, VN, Builder.CreateSub(N, One32));
+  Builder.CreateCondBr(Builder.CreateICmpEQ(N, One32), Short, Knuth);
+
+  // Single digit divisor: plain short division, remainder left in un[0].
+  Builder.SetInsertPoint(Short);
+  {
+    llvm::PHINode *J = Builder.CreatePHI(Int32Ty, 2, "j");
+    llvm::PHINode *K = Builder.CreatePHI(Int64Ty, 2, "k");
+    llvm::Value *Cur = Builder.CreateOr(Builder.CreateShl(K, 32),
+                                        LoadDigit(UNTy, UN, J));
+    StoreDigit(Builder.CreateUDiv(Cur, VTop), QTy, QA, J);
+    llvm::Value *K1 = Builder.CreateURem(Cur, VTop);
+    llvm::Value *J1 = Builder.CreateSub(J, One32);
+    Builder.CreateCondBr(Builder.CreateICmpEQ(J, Zero32), ShortExit, Short);
+    J->addIncoming(M, Normalize);
+    J->addIncoming(J1, Short);
+    K->addIncoming(Zero64, Normalize);
+    K->addIncoming(K1, Short);
+
+    Builder.SetInsertPoint(ShortExit);
+    StoreDigit(K1, UNTy, UN, Zero32);
+    for (unsigned I = 1; I <= 8; ++I) {
+      StoreDigit(Zero64, UNTy, UN, Builder.getInt32(I));
+    }
+    Builder.CreateBr(Finish);
+  }
+
+  Builder.SetInsertPoint(Knuth);
+  llvm::Value *VNext =
+      LoadDigit(VNTy, VN, Builder.CreateSub(N, Builder.getInt32(2)));
+  llvm::Value *JStart = Builder.CreateSub(M, N);
+  Builder.CreateBr(Outer);
+
+  // Estimate the next quotient digit from the top two digits of the
+  // remainder.
+  Builder.SetInsertPoint(Outer);
+  llvm::PHINode *J = Builder.CreatePHI(Int32Ty, 2, "j");
+  llvm::Value *JN = Builder.CreateAdd(J, N);
+  llvm::Value *UTop = LoadDigit(UNTy, UN, JN);
+  llvm::Value *UNext = LoadDigit(UNTy, UN, Builder.CreateSub(JN, One32));
+  llvm::Value *UNext2 =
+      LoadDigit(UNTy, UN, Builder.CreateSub(JN, Builder.getInt32(2)));
+  llvm::Value *Num = Builder.CreateOr(Builder.CreateShl(UTop, 32), UNext);
+  llvm::Value *QHat0 = Builder.CreateUDiv(Num, VTop);
+  llvm::Value *RHat0 = Builder.CreateURem(Num, VTop);
+  Builder.CreateBr(Adjust);
+
+  // Correct the estimate, which is at most two too large.
+  Builder.SetInsertPoint(Adjust);
+  llvm::PHINode *QHat = Builder.CreatePHI(Int64Ty, 2, "qhat");
+  llvm::PHINode *RHat = Builder.CreatePHI(Int64Ty, 2, "rhat");
+  Builder.CreateCondBr(Builder.CreateICmpUGE(QHat, Base), AdjustDec,
+                       AdjustCheck);
+
+  Builder.SetInsertPoint(AdjustCheck);
+  llvm::Value *Lhs = Builder.CreateMul(QHat, VNext);
+  llvm::Value *Rhs = Builder.CreateOr(Builder.CreateShl(RHat, 32), UNext2);
+  Builder.CreateCondBr(Builder.CreateICmpUGT(Lhs, Rhs), AdjustDec,
+                       MulSubEntry);
+
+  Builder.SetInsertPoint(AdjustDec);
+  llvm::Value *QHatDec = Builder.CreateSub(QHat, One64);
+  llvm::Value *RHatInc = Builder.CreateAdd(RHat, VTop);
+  Builder.CreateCondBr(Builder.CreateICmpULT(RHatInc, Base), Adjust,
+                       MulSubEntry);
+
+  QHat->addIncoming(QHat0, Outer);
+  QHat->addIncoming(QHatDec, AdjustDec);
+  RHat->addIncoming(RHat0, Outer);
+  RHat->addIncoming(RHatInc, AdjustDec);
+
+  Builder.SetInsertPoint(MulSubEntry);
+  llvm::PHINode *QDigit = Builder.CreatePHI(Int64Ty, 2, "qdigit");
+  QDigit->addIncoming(QHat, AdjustCheck);
+  QDigit->addIncoming(QHatDec, AdjustDec);
+  Builder.CreateBr(MulSub);
+
+  // un[j..j+n] -= qdigit * vn, with a signed borrow.
+  Builder.SetInsertPoint(MulSub);
+  llvm::Value *MulSubCarry;
+  {
+    llvm::PHINode *I = Builder.CreatePHI(Int32Ty, 2, "i");
+    llvm::PHINode *K = Builder.CreatePHI(Int64Ty, 2, "k");
+    llvm::Value *Index = Builder.CreateAdd(I, J);
+    llvm::Value *P = Builder.CreateMul(QDigit, LoadDigit(VNTy, VN, I));
+    llvm::Value *T = Builder.CreateSub(
+        Builder.CreateSub(LoadDigit(UNTy, UN, Index), K),
+        Builder.CreateAnd(P, Mask));
+    StoreDigit(Builder.CreateAnd(T, Mask), UNTy, UN, Index);
+    MulSubCarry = Builder.CreateSub(Builder.CreateLShr(P, 32),
+                                    Builder.CreateAShr(T, 32));
+    llvm::Value *I1 = Builder.CreateAdd(I, One32);
+    Builder.CreateCondBr(Builder.CreateICmpEQ(I1, N), MulSubExit, MulSub);
+    I->addIncoming(Zero32, MulSubEntry);
+    I->addIncoming(I1, MulSub);
+    K->addIncoming(Zero64, MulSubEntry);
+    K->addIncoming(MulSubCarry, MulSub);
+  }
+
+  Builder.SetInsertPoint(MulSubExit);
+  llvm::Value *TTop =
+      Builder.CreateSub(LoadDigit(UNTy, UN, JN), MulSubCarry);
+  StoreDigit(Builder.CreateAnd(TTop, Mask), UNTy, UN, JN);
+  Builder.CreateCondBr(Builder.CreateICmpSLT(TTop, Zero64), AddBack, Next);
+
+  // Subtracted too much: add the divisor back once.
+  Builder.SetInsertPoint(AddBack);
+  {
+    llvm::PHINode *I = Builder.CreatePHI(Int32Ty, 2, "i");
+    llvm::PHINode *K = Builder.CreatePHI(Int64Ty, 2, "k");
+    llvm::Value *Index = Builder.CreateAdd(I, J);
+    llvm::Value *T = Builder.CreateAdd(
+        Builder.CreateAdd(LoadDigit(UNTy, UN, Index), LoadDigit(VNTy, VN, I)),
+        K);
+    StoreDigit(Builder.CreateAnd(T, Mask), UNTy, UN, Index);
+    llvm::Value *K1 = Builder.CreateLShr(T, 32);
+    llvm::Value *I1 = Builder.CreateAdd(I, One32);
+    Builder.CreateCondBr(Builder.CreateICmpEQ(I1, N), AddBackExit, AddBack);
+    I->addIncoming(Zero32, MulSubExit);
+    I->addIncoming(I1, AddBack);
+    K->addIncoming(Zero64, MulSubExit);
+    K->addIncoming(K1, AddBack);
+
+    Builder.SetInsertPoint(AddBackExit);
+    StoreDigit(
+        Builder.CreateAnd(Builder.CreateAdd(LoadDigit(UNTy, UN, JN), K1), Mask),
+        UNTy, UN, JN);
+  }
+  llvm::Value *QDigitDec = Builder.CreateSub(QDigit, One64);
+  Builder.CreateBr(Next);
+
+  Builder.SetInsertPoint(Next);
+  llvm::PHINode *QFinal = Builder.CreatePHI(Int64Ty, 2, "qfinal");
+  QFinal->addIncoming(QDigit, MulSubExit);
+  QFinal->addIncoming(QDigitDec, AddBackExit);
+  StoreDigit(QFinal, QTy, QA, J);
+  llvm::Value *J1 = Builder.CreateSub(J, One32);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(J, Zero32), Finish, Outer);
+  J->addIncoming(JStart, Knuth);
+  J->addIncoming(J1, Next);
+
+  // The remainder is un[0..n) shifted back by s; every digit above it is
+  // zero by now.
+  Builder.SetInsertPoint(Finish);
+  {
+    llvm::Value *Shift = Builder.CreateSub(Builder.getInt64(32), S);
+    llvm::SmallVector<llvm::Value *, 8> Q, R;
+    for (unsigned I = 0; I < 8; ++I) {
+      Q.push_back(LoadDigit(QTy, QA, Builder.getInt32(I)));
+      llvm::Value *Lo =
+          Builder.CreateLShr(LoadDigit(UNTy, UN, Builder.getInt32(I)), S);
+      llvm::Value *Hi = Builder.CreateAnd(
+          Builder.CreateShl(LoadDigit(UNTy, UN, Builder.getInt32(I + 1)),
+                            Shift),
+          Mask);
+      R.push_back(Builder.CreateOr(Lo, Hi));
+    }
+    Builder.CreateStore(joinLimbs(Builder, Q, 32), QuotientPtr);
+    Builder.CreateStore(joinLimbs(Builder, R, 32), RemainderPtr);
+    Builder.CreateRetVoid();
+  }
+
+  return Result;
+}
+
+llvm::Function *
+LoweringInteger::CreateUDivRem256Wrapper(llvm::StringRef Name,
+                                         bool Remainder) {
+  llvm::LLVMContext &Context = TheModule->getContext();
+  llvm::IRBuilder<> Builder(Context);
+  llvm::IntegerType *Int256Ty = Builder.getIntNTy(256);
+  llvm::Function *Result = llvm::Function::Create(
+      llvm::FunctionType::get(Int256Ty, {Int256Ty, Int256Ty}, false),
+      llvm::Function::InternalLinkage, Name, *TheModule);
+  Result->addFnAttr(llvm::Attribute::AlwaysInline);
+
+  llvm::Argument *Dividend = Result->arg_begin();
+  Dividend->setName("dividend");
+  llvm::Argument *Divisor = Dividend + 1;
+  Divisor->setName("divisor");
+
+  llvm::BasicBlock *Entry = llvm::BasicBlock::Create(Context, "entry", Result);
+  Builder.SetInsertPoint(Entry);
+  llvm::Value *Quotient = Builder.CreateAlloca(Int256Ty, nullptr, "quotient");
+  llvm::Value *Rem = Builder.CreateAlloca(Int256Ty, nullptr, "remainder");
+  Builder.CreateCall(GetUDivRem256Function(),
+                     {Dividend, Divisor, Quotient, Rem});
+  Builder.CreateRet(
+      Builder.CreateLoad(Int256Ty, Remainder ? Rem : Quotient));
+  return Result;
+}
+
 llvm::Function *LoweringInteger::GetUDivFunction(const unsigned int BitWidth) {
   {
     auto iter = UDivFunction.find(BitWidth);
@@ -117,6 +597,11 @@ llvm::Function *LoweringInteger::GetUDivFunction(const unsigned int BitWidth) {
       return iter->getSecond();
     }
   }
+  if (BitWidth == 256) {
+    llvm::Function *Result = CreateUDivRem256Wrapper("__udiv256", false);
+    UDivFunction.try_emplace(BitWidth, Result);
+    return Result;
+  }
   llvm::LLVMContext &Context = TheModule->getContext();
   llvm::IRBuilder<> Builder(Context);
   llvm::IntegerType *DivTy = Builder.getIntNTy(BitWidth);
@@ -359,6 +844,11 @@ llvm::Function *LoweringInteger::GetURemFunction(const unsigned int BitWidth) {
       return iter->getSecond();
     }
   }
+  if (BitWidth == 256) {
+    llvm::Function *Result = CreateUDivRem256Wrapper("__urem256", true);
+    URemFunction.try_emplace(BitWidth, Result);
+    return Result;
+  }
   llvm::LLVMContext &Context = TheModule->getContext();
   llvm::IRBuilder<> Builder(Context);
   llvm::IntegerType *DivTy = Builder.getIntNTy(BitWidth);
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/NarrowInteger.h"
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Support/KnownBits.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+
+namespace soll {
+
+namespace {
+
+enum class NarrowKind { Narrow, Version };
+
+struct NarrowCandidate {
+  llvm::BinaryOperator *I;
+  NarrowKind Kind;
+  unsigned BitWidth;
+};
+
+static bool isNarrowableOpcode(unsigned OpCode) {
+  switch (OpCode) {
+  case llvm::Instruction::Mul:
+  case llvm::Instruction::UDiv:
+  case llvm::Instruction::URem:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Smallest of 64 and 128 bits that holds \p Bits, or 0 if neither is
+/// narrower than \p Width.
+static unsigned getNarrowWidth(unsigned Bits, unsigned Width) {
+  for (unsigned Narrow : {64u, 128u}) {
+    if (Bits <= Narrow && Narrow < Width) {
+      return Narrow;
+    }
+  }
+  return 0;
+}
+
+/// Emit \p I on operands truncated to \p Width bits. Native 64-bit division
+/// traps on zero, so a zero divisor yields zero like the wide helpers do.
+static llvm::Value *createNarrowOp(llvm::IRBuilder<> &Builder,
+                                   llvm::BinaryOperator *I, unsigned Width,
+                                   bool DivisorKnownNonZero) {
+  llvm::Type *NarrowTy = Builder.getIntNTy(Width);
+  llvm::Value *LHS = Builder.CreateTrunc(I->getOperand(0), NarrowTy);
+  llvm::Value *RHS = Builder.CreateTrunc(I->getOperand(1), NarrowTy);
+  llvm::Value *IsZero = nullptr;
+  if (I->getOpcode() != llvm::Instruction::Mul && Width <= 64 &&
+      !DivisorKnownNonZero) {
+    llvm::Constant *Zero = llvm::ConstantInt::get(NarrowTy, 0);
+    IsZero = Builder.CreateICmpEQ(RHS, Zero);
+    RHS = Builder.CreateSelect(IsZero, llvm::ConstantInt::get(NarrowTy, 1),
+                               RHS);
+  }
+  llvm::Value *Result = Builder.CreateBinOp(I->getOpcode(), LHS, RHS,
+                                            I->getName() + ".narrow");
+  if (IsZero) {
+    Result = Builder.CreateSelect(IsZero, llvm::ConstantInt::get(NarrowTy, 0),
+                                  Result);
+  }
+  return Builder.CreateZExt(Result, I->getType());
+}
+
+} // namespace
+
+llvm::PreservedAnalyses NarrowInteger::run(llvm::Function &F,
+                                           llvm::FunctionAnalysisManager &FAM) {
+  const llvm::DataLayout &DL = F.getParent()->getDataLayout();
+  auto &AC = FAM.getResult<llvm::AssumptionAnalysis>(F);
+  auto &DT = FAM.getResult<llvm::DominatorTreeAnalysis>(F);
+  auto &LI = FAM.getResult<llvm::LoopAnalysis>(F);
+
+  // Decide everything up front; versioning splits blocks and would
+  // invalidate the analyses used here.
+  std::vector<NarrowCandidate> Candidates;
+  for (llvm::BasicBlock &BB : F) {
+    for (llvm::Instruction &Inst : BB) {
+      auto *I = llvm::dyn_cast<llvm::BinaryOperator>(&Inst);
+      if (!I || !isNarrowableOpcode(I->getOpcode()) ||
+          !I->getType()->isIntegerTy()) {
+        continue;
+      }
+      const unsigned Width = I->getType()->getIntegerBitWidth();
+      if (Width <= 64) {
+        continue;
+      }
+
+      llvm::KnownBits LHS =
+          llvm::computeKnownBits(I->getOperand(0), DL, 0, &AC, I, &DT);
+      llvm::KnownBits RHS =
+          llvm::computeKnownBits(I->getOperand(1), DL, 0, &AC, I, &DT);
+      const unsigned LHSBits = Width - LHS.countMinLeadingZeros();
+      const unsigned RHSBits = Width - RHS.countMinLeadingZeros();
+      const unsigned Bits = I->getOpcode() == llvm::Instruction::Mul
+                                ? LHSBits + RHSBits
+                                : std::max(LHSBits, RHSBits);
+
+      if (unsigned Narrow = getNarrowWidth(Bits, Width)) {
+        Candidates.push_back({I, NarrowKind::Narrow, Narrow});
+      } else if (Versioning && LI.getLoopFor(&BB) &&
+                 (I->getOpcode() != llvm::Instruction::Mul || Width > 128)) {
+        Candidates.push_back({I, NarrowKind::Version, 0});
+      }
+    }
+  }
+
+  if (Candidates.empty()) {
+    return llvm::PreservedAnalyses::all();
+  }
+
+  for (const auto &C : Candidates) {
+    llvm::BinaryOperator *I = C.I;
+    if (C.Kind == NarrowKind::Narrow) {
+      llvm::IRBuilder<> Builder(I);
+      const bool NonZero = llvm::isKnownNonZero(I->getOperand(1), DL);
+      llvm::Value *Result = createNarrowOp(Builder, I, C.BitWidth, NonZero);
+      I->replaceAllUsesWith(Result);
+      I->eraseFromParent();
+      continue;
+    }
+
+    // if ((lhs | rhs) >> 64 == 0) fast path else wide op. A 64x64 bit
+    // product needs 128 bits.
+    const unsigned FastWidth =
+        I->getOpcode() == llvm::Instruction::Mul ? 128 : 64;
+    llvm::IRBuilder<> Builder(I);
+    llvm::Value *High = Builder.CreateLShr(
+        Builder.CreateOr(I->getOperand(0), I->getOperand(1)), 64);
+    llvm::Value *IsNarrow = Builder.CreateICmpEQ(
+        High, llvm::ConstantInt::get(I->getType(), 0), "is_narrow");
+
+    llvm::Instruction *ThenTerm = nullptr;
+    llvm::Instruction *ElseTerm = nullptr;
+    llvm::SplitBlockAndInsertIfThenElse(IsNarrow, I, &ThenTerm, &ElseTerm);
+    llvm::BasicBlock *Tail = I->getParent();
+
+    Builder.SetInsertPoint(ThenTerm);
+    llvm::Value *Fast = createNarrowOp(Builder, I, FastWidth, false);
+    I->moveBefore(ElseTerm);
+
+    llvm::PHINode *Phi = llvm::PHINode::Create(I->getType(), 2,
+                                               I->getName() + ".merge",
+                                               &Tail->front());
+    I->replaceAllUsesWith(Phi);
+    Phi->addIncoming(Fast, ThenTerm->getParent());
+    Phi->addIncoming(I, ElseTerm->getParent());
+  }
+
+  return llvm::PreservedAnalyses::none();
+}
+
+} // namespace soll
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/SimplifyBswap.h"
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+
+namespace soll {
+
+namespace {
+
+constexpr unsigned LimbCount = 4;
+
+/// Operand of \p V if it is a byte swap, either the solidity.bswapi256
+/// helper or the llvm.bswap intrinsic, otherwise nullptr.
+static llvm::Value *getSwappedOperand(llvm::Value *V,
+                                      const llvm::Function *Helper) {
+  auto *Call = llvm::dyn_cast<llvm::CallInst>(V);
+  if (!Call) {
+    return nullptr;
+  }
+  const llvm::Function *Callee = Call->getCalledFunction();
+  if (!Callee || (Callee != Helper &&
+                  Callee->getIntrinsicID() != llvm::Intrinsic::bswap)) {
+    return nullptr;
+  }
+  return Call->getArgOperand(0);
+}
+
+static llvm::Value *getLimbPointer(llvm::IRBuilder<> &Builder,
+                                   llvm::Value *Ptr, unsigned Index) {
+  const unsigned AddrSpace = Ptr->getType()->getPointerAddressSpace();
+  llvm::Value *LimbPtr =
+      Builder.CreateBitCast(Ptr, Builder.getInt64Ty()->getPointerTo(AddrSpace));
+  return Builder.CreateConstInBoundsGEP1_32(Builder.getInt64Ty(), LimbPtr,
+                                            Index);
+}
+
+/// Rewrite a call to the 256-bit helper whose operand is loaded from memory
+/// or whose result is only stored. Wasm memory is little-endian, so limb I
+/// of the result is the swapped limb 3 - I of the operand.
+static bool expandLimbs(llvm::CallInst *Call) {
+  llvm::Value *Arg = Call->getArgOperand(0);
+  auto *Load = llvm::dyn_cast<llvm::LoadInst>(Arg);
+  if (Load && (!Load->isSimple() || !Load->hasOneUse())) {
+    Load = nullptr;
+  }
+  llvm::StoreInst *Store = nullptr;
+  if (Call->hasOneUse()) {
+    Store = llvm::dyn_cast<llvm::StoreInst>(Call->user_back());
+    if (Store && (!Store->isSimple() || Store->getValueOperand() != Call)) {
+      Store = nullptr;
+    }
+  }
+  if (!Load && !Store) {
+    return false;
+  }
+
+  // Limbs are read where the operand is loaded, since memory may change
+  // between the load and the swap.
+  llvm::IRBuilder<> Builder(Load ? static_cast<llvm::Instruction *>(Load)
+                                 : Call);
+  llvm::Type *Int64Ty = Builder.getInt64Ty();
+  llvm::Function *Bswap64 = llvm::Intrinsic::getDeclaration(
+      Call->getModule(), llvm::Intrinsic::bswap, {Int64Ty});
+  llvm::Value *Limbs[LimbCount];
+  for (unsigned I = 0; I < LimbCount; ++I) {
+    const unsigned Source = LimbCount - 1 - I;
+    llvm::Value *Limb;
+    if (Load) {
+      Limb = Builder.CreateAlignedLoad(
+          Int64Ty, getLimbPointer(Builder, Load->getPointerOperand(), Source),
+          llvm::MaybeAlign(1));
+    } else {
+      Limb = Builder.CreateTrunc(
+          Source == 0 ? Arg : Builder.CreateLShr(Arg, Source * 64), Int64Ty);
+    }
+    Limbs[I] = Builder.CreateCall(Bswap64, {Limb});
+  }
+
+  if (Store) {
+    Builder.SetInsertPoint(Store);
+    for (unsigned I = 0; I < LimbCount; ++I) {
+      Builder.CreateAlignedStore(
+          Limbs[I], getLimbPointer(Builder, Store->getPointerOperand(), I),
+          llvm::MaybeAlign(1));
+    }
+  } else {
+    Builder.SetInsertPoint(Call);
+    llvm::Value *Result = nullptr;
+    for (unsigned I = 0; I < LimbCount; ++I) {
+      llvm::Value *Part = Builder.CreateZExt(Limbs[I], Call->getType());
+      if (I != 0) {
+        Part = Builder.CreateShl(Part, I * 64);
+      }
+      Result = Result ? Builder.CreateOr(Result, Part) : Part;
+    }
+    Call->replaceAllUsesWith(Result);
+  }
+
+  if (Store) {
+    Store->eraseFromParent();
+  }
+  Call->eraseFromParent();
+  if (Load) {
+    Load->eraseFromParent();
+  }
+  return true;
+}
+
+/// Rewrite each `lshr(bswap(x), C)` user of \p Call that shifts out whole
+/// bytes. It keeps only the low bytes of x, so it is a swap of those bytes
+/// alone. The dispatcher reads the selector from calldata this way.
+static bool narrowShiftedSwap(llvm::CallInst *Call) {
+  llvm::Value *Arg = Call->getArgOperand(0);
+  const unsigned BitWidth = Call->getType()->getIntegerBitWidth();
+  bool Changed = false;
+  for (llvm::User *U : llvm::make_early_inc_range(Call->users())) {
+    auto *Shift = llvm::dyn_cast<llvm::BinaryOperator>(U);
+    if (!Shift || Shift->getOpcode() != llvm::Instruction::LShr ||
+        Shift->getOperand(0) != Call) {
+      continue;
+    }
+    auto *Amount = llvm::dyn_cast<llvm::ConstantInt>(Shift->getOperand(1));
+    if (!Amount || Amount->isZero() || Amount->getValue().uge(BitWidth) ||
+        Amount->getZExtValue() % 8 != 0) {
+      continue;
+    }
+    const unsigned Width = BitWidth - Amount->getZExtValue();
+    if (Width != 8 && Width % 16 != 0) {
+      continue;
+    }
+    llvm::IRBuilder<> Builder(Shift);
+    llvm::Value *Low = Builder.CreateTrunc(Arg, Builder.getIntNTy(Width));
+    if (Width != 8) {
+      llvm::Function *Bswap = llvm::Intrinsic::getDeclaration(
+          Call->getModule(), llvm::Intrinsic::bswap, {Low->getType()});
+      Low = Builder.CreateCall(Bswap, {Low});
+    }
+    Shift->replaceAllUsesWith(Builder.CreateZExt(Low, Shift->getType()));
+    Shift->eraseFromParent();
+    Changed = true;
+  }
+  return Changed;
+}
+
+} // namespace
+
+llvm::PreservedAnalyses SimplifyBswap::run(llvm::Function &F,
+                                           llvm::FunctionAnalysisManager &FAM) {
+  const llvm::Function *Helper =
+      F.getParent()->getFunction("solidity.bswapi256");
+  if (&F == Helper) {
+    return llvm::PreservedAnalyses::all();
+  }
+
+  std::vector<llvm::CallInst *> Calls;
+  for (llvm::BasicBlock &BB : F) {
+    for (llvm::Instruction &I : BB) {
+      if (getSwappedOperand(&I, Helper)) {
+        Calls.push_back(llvm::cast<llvm::CallInst>(&I));
+      }
+    }
+  }
+
+  bool Changed = false;
+  std::vector<llvm::CallInst *> Expandable;
+  for (llvm::CallInst *Call : Calls) {
+    llvm::Value *Arg = Call->getArgOperand(0);
+    llvm::Value *Replacement = nullptr;
+    if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(Arg)) {
+      if (C->getBitWidth() % 16 == 0) {
+        Replacement = llvm::ConstantInt::get(Call->getType(),
+                                             C->getValue().byteSwap());
+      }
+    } else if (llvm::Value *Inner = getSwappedOperand(Arg, Helper)) {
+      if (Inner->getType() == Call->getType()) {
+        Replacement = Inner;
+      }
+    }
+    if (Replacement) {
+      Call->replaceAllUsesWith(Replacement);
+      Changed = true;
+      continue;
+    }
+    Changed |= narrowShiftedSwap(Call);
+    if (ExpandLimbs && Call->getCalledFunction() == Helper) {
+      Expandable.push_back(Call);
+    }
+  }
+
+  // Erase the swaps that became dead, innermost last so the outer ones drop
+  // their uses first.
+  llvm::SmallPtrSet<llvm::CallInst *, 16> Erased;
+  for (auto I = Calls.rbegin(); I != Calls.rend(); ++I) {
+    if ((*I)->use_empty()) {
+      Erased.insert(*I);
+      (*I)->eraseFromParent();
+      Changed = true;
+    }
+  }
+
+  for (llvm::CallInst *Call : Expandable) {
+    if (!Erased.count(Call)) {
+      Changed |= expandLimbs(Call);
+    }
+  }
+
+  return Changed ? llvm::PreservedAnalyses::none()
+                 : llvm::PreservedAnalyses::all();
+}
+
+} // namespace soll
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/SimplifyExp.h"
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+
+namespace soll {
+
+namespace {
+
+/// Longest multiplication chain a constant exponent is expanded into.
+constexpr unsigned MaxChainLength = 24;
+/// Largest table of powers emitted for a constant base.
+constexpr unsigned MaxTableSize = 80;
+
+/// Left-to-right binary method; it needs one squaring per bit below the
+/// top one and one multiplication per further set bit.
+static llvm::Value *createMulChain(llvm::IRBuilder<> &Builder,
+                                   llvm::Value *Base, const llvm::APInt &Exp) {
+  llvm::Value *Result = Base;
+  for (unsigned I = Exp.getActiveBits() - 1; I-- > 0;) {
+    Result = Builder.CreateMul(Result, Result, "exp.sqr");
+    if (Exp[I]) {
+      Result = Builder.CreateMul(Result, Base, "exp.mul");
+    }
+  }
+  return Result;
+}
+
+/// 2**(K*n) is a single shift, or zero once the shift reaches the width.
+static llvm::Value *createShift(llvm::IRBuilder<> &Builder, unsigned K,
+                                llvm::Value *Exp) {
+  llvm::Type *Ty = Exp->getType();
+  const unsigned Width = Ty->getIntegerBitWidth();
+  const unsigned Limit = (Width + K - 1) / K;
+  llvm::Value *InRange =
+      Builder.CreateICmpULT(Exp, llvm::ConstantInt::get(Ty, Limit));
+  llvm::Value *Amount = Builder.CreateSelect(
+      InRange, Builder.CreateTrunc(Exp, Builder.getInt32Ty()),
+      Builder.getInt32(0));
+  if (K != 1) {
+    Amount = Builder.CreateMul(Amount, Builder.getInt32(K));
+  }
+  llvm::Value *Shift = Builder.CreateShl(llvm::ConstantInt::get(Ty, 1),
+                                         Builder.CreateZExt(Amount, Ty));
+  return Builder.CreateSelect(InRange, Shift, llvm::ConstantInt::get(Ty, 0),
+                              "exp.shl");
+}
+
+/// Powers of \p Base until they no longer fit, or an empty vector if there
+/// are too many of them.
+static std::vector<llvm::APInt> getPowerTable(const llvm::APInt &Base) {
+  std::vector<llvm::APInt> Table;
+  const unsigned Width = Base.getBitWidth();
+  llvm::APInt Power(Width, 1);
+  while (Table.size() < MaxTableSize) {
+    Table.push_back(Power);
+    bool Overflow = false;
+    Power = Power.umul_ov(Base, Overflow);
+    if (Overflow) {
+      return Table;
+    }
+  }
+  return {};
+}
+
+/// Replace the call with a load from a table of powers of the base, falling
+/// back to the call for exponents past its end.
+static void createTableLookup(llvm::CallInst *Call,
+                              llvm::ArrayRef<llvm::APInt> Powers) {
+  llvm::Module &M = *Call->getModule();
+  llvm::Type *Ty = Call->getType();
+  llvm::Value *Exp = Call->getArgOperand(1);
+
+  std::vector<llvm::Constant *> Elements;
+  for (const llvm::APInt &Power : Powers) {
+    Elements.push_back(llvm::ConstantInt::get(Ty, Power));
+  }
+  auto *TableTy = llvm::ArrayType::get(Ty, Elements.size());
+  auto *Table = new llvm::GlobalVariable(
+      M, TableTy, true, llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantArray::get(TableTy, Elements), "solidity.exp.table");
+  Table->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+  llvm::IRBuilder<> Builder(Call);
+  llvm::Value *InRange = Builder.CreateICmpULT(
+      Exp, llvm::ConstantInt::get(Ty, Elements.size()));
+  llvm::Instruction *ThenTerm = nullptr;
+  llvm::Instruction *ElseTerm = nullptr;
+  llvm::SplitBlockAndInsertIfThenElse(InRange, Call, &ThenTerm, &ElseTerm);
+  llvm::BasicBlock *Tail = Call->getParent();
+
+  Builder.SetInsertPoint(ThenTerm);
+  llvm::Value *Index = Builder.CreateTrunc(Exp, Builder.getInt32Ty());
+  llvm::Value *Ptr = Builder.CreateInBoundsGEP(
+      TableTy, Table, {Builder.getInt32(0), Index}, "exp.table.ptr");
+  llvm::Value *Load = Builder.CreateLoad(Ty, Ptr, "exp.table");
+  Call->moveBefore(ElseTerm);
+
+  llvm::PHINode *Phi =
+      llvm::PHINode::Create(Ty, 2, "exp.merge", &Tail->front());
+  Call->replaceAllUsesWith(Phi);
+  Phi->addIncoming(Load, ThenTerm->getParent());
+  Phi->addIncoming(Call, ElseTerm->getParent());
+}
+
+/// Specialize one call; returns true if the IR changed.
+static bool simplifyExpCall(llvm::CallInst *Call) {
+  llvm::Value *Base = Call->getArgOperand(0);
+  llvm::Value *Exp = Call->getArgOperand(1);
+  auto *ConstBase = llvm::dyn_cast<llvm::ConstantInt>(Base);
+  auto *ConstExp = llvm::dyn_cast<llvm::ConstantInt>(Exp);
+  llvm::Type *Ty = Call->getType();
+  llvm::IRBuilder<> Builder(Call);
+  llvm::Value *Result = nullptr;
+
+  if (ConstExp) {
+    const llvm::APInt &E = ConstExp->getValue();
+    if (ConstBase) {
+      // Exponentiation by squaring on the constants themselves.
+      llvm::APInt B = ConstBase->getValue();
+      llvm::APInt Power(B.getBitWidth(), 1);
+      for (unsigned I = 0, N = E.getActiveBits(); I < N; ++I) {
+        if (E[I]) {
+          Power *= B;
+        }
+        B *= B;
+      }
+      Result = llvm::ConstantInt::get(Ty, Power);
+    } else if (E.isNullValue()) {
+      Result = llvm::ConstantInt::get(Ty, 1);
+    } else if (E.getActiveBits() - 1 + E.countPopulation() - 1 <=
+               MaxChainLength) {
+      Result = createMulChain(Builder, Base, E);
+    }
+  } else if (ConstBase) {
+    const llvm::APInt &B = ConstBase->getValue();
+    if (B.isNullValue()) {
+      Result = Builder.CreateZExt(
+          Builder.CreateICmpEQ(Exp, llvm::ConstantInt::get(Ty, 0)), Ty);
+    } else if (B.isOneValue()) {
+      Result = llvm::ConstantInt::get(Ty, 1);
+    } else if (B.isPowerOf2()) {
+      Result = createShift(Builder, B.logBase2(), Exp);
+    } else {
+      std::vector<llvm::APInt> Powers = getPowerTable(B);
+      if (Powers.empty()) {
+        return false;
+      }
+      createTableLookup(Call, Powers);
+      return true;
+    }
+  }
+
+  if (!Result) {
+    return false;
+  }
+  Call->replaceAllUsesWith(Result);
+  Call->eraseFromParent();
+  return true;
+}
+
+} // namespace
+
+llvm::PreservedAnalyses SimplifyExp::run(llvm::Function &F,
+                                         llvm::FunctionAnalysisManager &FAM) {
+  llvm::Function *Exp = F.getParent()->getFunction("solidity.expi256");
+  if (!Exp || &F == Exp) {
+    return llvm::PreservedAnalyses::all();
+  }
+
+  std::vector<llvm::CallInst *> Calls;
+  for (llvm::BasicBlock &BB : F) {
+    for (llvm::Instruction &I : BB) {
+      if (auto *Call = llvm::dyn_cast<llvm::CallInst>(&I)) {
+        if (Call->getCalledFunction() == Exp) {
+          Calls.push_back(Call);
+        }
+      }
+    }
+  }
+
+  bool Changed = false;
+  for (llvm::CallInst *Call : Calls) {
+    Changed |= simplifyExpCall(Call);
+  }
+  return Changed ? llvm::PreservedAnalyses::none()
+                 : llvm::PreservedAnalyses::all();
+}
+
+} // namespace soll
@@ -0,0 +1,436 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/StorageCache.h"
+#include <llvm/ADT/DepthFirstIterator.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+
+namespace soll {
+
+namespace {
+
+enum class AccessKind { None, Load, Store, Clobber };
+
+/// How far back to look for the store that fills a key or value buffer.
+constexpr unsigned MaxScanDistance = 32;
+
+static AccessKind classifyCall(const llvm::CallInst *Call) {
+  const llvm::Function *Callee = Call->getCalledFunction();
+  if (!Callee) {
+    return AccessKind::Clobber;
+  }
+  const llvm::StringRef Name = Callee->getName();
+  if (Name == "ethereum.storageLoad") {
+    return AccessKind::Load;
+  }
+  if (Name == "ethereum.storageStore") {
+    return AccessKind::Store;
+  }
+  if (Name.startswith("ethereum.")) {
+    // Host functions that only read the environment or copy into memory.
+    const bool Safe = Name.startswith("ethereum.get") ||
+                      llvm::StringSwitch<bool>(Name)
+                          .Case("ethereum.callDataCopy", true)
+                          .Case("ethereum.codeCopy", true)
+                          .Case("ethereum.externalCodeCopy", true)
+                          .Case("ethereum.returnDataCopy", true)
+                          .Case("ethereum.returnDataSize", true)
+                          .Case("ethereum.log", true)
+                          .Default(false);
+    return Safe ? AccessKind::None : AccessKind::Clobber;
+  }
+  // Compiler helpers and precompile wrappers never touch contract storage.
+  if (Name.startswith("solidity.") || Callee->isIntrinsic() ||
+      Callee->onlyReadsMemory()) {
+    return AccessKind::None;
+  }
+  return AccessKind::Clobber;
+}
+
+static bool isStorageLoad(const llvm::CallInst *Call) {
+  return classifyCall(Call) == AccessKind::Load;
+}
+
+/// Value most recently stored to the alloca \p Ptr before \p Before, if it
+/// can be found in the same block.
+static llvm::Value *findStoredValue(llvm::Value *Ptr,
+                                    llvm::Instruction *Before) {
+  if (!llvm::isa<llvm::AllocaInst>(Ptr->stripPointerCasts())) {
+    return nullptr;
+  }
+  unsigned Distance = 0;
+  for (llvm::Instruction *I = Before->getPrevNode();
+       I && Distance < MaxScanDistance; I = I->getPrevNode(), ++Distance) {
+    if (auto *Store = llvm::dyn_cast<llvm::StoreInst>(I)) {
+      llvm::Value *Dest = Store->getPointerOperand();
+      if (Dest == Ptr) {
+        return Store->isSimple() ? Store->getValueOperand() : nullptr;
+      }
+      if (llvm::isa<llvm::AllocaInst>(Dest->stripPointerCasts()) &&
+          Dest->stripPointerCasts() != Ptr->stripPointerCasts()) {
+        continue;
+      }
+      return nullptr;
+    }
+    if (auto *Call = llvm::dyn_cast<llvm::CallInst>(I)) {
+      // A storage load only writes its result buffer.
+      if (isStorageLoad(Call) && Call->arg_size() == 2 &&
+          Call->getArgOperand(1) != Ptr) {
+        continue;
+      }
+    }
+    if (I->mayWriteToMemory()) {
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+/// Fold keys computed from constant state variable addresses, so that every
+/// access to such a slot sees the same constant.
+static llvm::Value *canonicalizeKey(llvm::Value *Key) {
+  if (auto *Load = llvm::dyn_cast<llvm::LoadInst>(Key)) {
+    auto *GV = llvm::dyn_cast<llvm::GlobalVariable>(
+        Load->getPointerOperand()->stripPointerCasts());
+    if (GV && GV->isConstant() && GV->hasDefinitiveInitializer() &&
+        Load->isSimple() && GV->getInitializer()->getType() == Key->getType()) {
+      if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(GV->getInitializer())) {
+        return C;
+      }
+    }
+    return Key;
+  }
+  if (auto *BO = llvm::dyn_cast<llvm::BinaryOperator>(Key)) {
+    if (BO->getOpcode() == llvm::Instruction::Add) {
+      auto *LHS = llvm::dyn_cast<llvm::ConstantInt>(
+          canonicalizeKey(BO->getOperand(0)));
+      auto *RHS = llvm::dyn_cast<llvm::ConstantInt>(
+          canonicalizeKey(BO->getOperand(1)));
+      if (LHS && RHS) {
+        return llvm::ConstantInt::get(Key->getType(),
+                                      LHS->getValue() + RHS->getValue());
+      }
+    }
+    return Key;
+  }
+  if (auto *Call = llvm::dyn_cast<llvm::CallInst>(Key)) {
+    const llvm::Function *Callee = Call->getCalledFunction();
+    if (Callee && Call->arg_size() == 1 &&
+        (Callee->getName() == "solidity.bswapi256" ||
+         Callee->getIntrinsicID() == llvm::Intrinsic::bswap)) {
+      auto *C = llvm::dyn_cast<llvm::ConstantInt>(
+          canonicalizeKey(Call->getArgOperand(0)));
+      if (C && C->getBitWidth() % 16 == 0 && C->getType() == Key->getType()) {
+        return llvm::ConstantInt::get(Key->getType(),
+                                      C->getValue().byteSwap());
+      }
+    }
+  }
+  return Key;
+}
+
+/// A storage access whose slot is known as an SSA value.
+struct Access {
+  llvm::CallInst *Call = nullptr;
+  AccessKind Kind = AccessKind::None;
+  /// Slot in the representation the host function reads from memory.
+  llvm::Value *Key = nullptr;
+  /// Buffer the value is loaded into or stored from.
+  llvm::Value *ValuePtr = nullptr;
+};
+
+static Access analyzeAccess(llvm::CallInst *Call) {
+  Access A;
+  A.Call = Call;
+  A.Kind = classifyCall(Call);
+  if (A.Kind != AccessKind::Load && A.Kind != AccessKind::Store) {
+    return A;
+  }
+  if (Call->arg_size() != 2) {
+    A.Kind = AccessKind::Clobber;
+    return A;
+  }
+  A.Key = findStoredValue(Call->getArgOperand(0), Call);
+  A.ValuePtr = Call->getArgOperand(1);
+  if (A.Key) {
+    A.Key = canonicalizeKey(A.Key);
+  }
+  return A;
+}
+
+/// Two different SSA keys may still name the same slot at run time, unless
+/// both are distinct constants.
+static bool mayAlias(llvm::Value *LHS, llvm::Value *RHS) {
+  return LHS == RHS || !llvm::isa<llvm::ConstantInt>(LHS) ||
+         !llvm::isa<llvm::ConstantInt>(RHS);
+}
+
+/// Value held by a slot: either an SSA value, or the result buffer of a
+/// storage load that is read on demand.
+struct KnownValue {
+  llvm::Value *Key;
+  llvm::Value *Value;
+  llvm::CallInst *Source;
+  llvm::Value *SourcePtr;
+};
+
+struct CacheState {
+  llvm::SmallVector<KnownValue, 8> Known;
+
+  KnownValue *lookup(llvm::Value *Key) {
+    for (KnownValue &K : Known) {
+      if (K.Key == Key) {
+        return &K;
+      }
+    }
+    return nullptr;
+  }
+
+  void invalidate(llvm::Value *Key) {
+    llvm::erase_if(Known,
+                   [Key](const KnownValue &K) { return mayAlias(K.Key, Key); });
+  }
+};
+
+class StorageCacheImpl {
+  llvm::Function &F;
+  llvm::DominatorTree &DT;
+  llvm::LoopInfo &LI;
+  /// Result buffers of loads already read back into SSA values.
+  llvm::DenseMap<llvm::CallInst *, llvm::Value *> Materialized;
+  bool Changed = false;
+
+public:
+  StorageCacheImpl(llvm::Function &F, llvm::DominatorTree &DT,
+                   llvm::LoopInfo &LI)
+      : F(F), DT(DT), LI(LI) {}
+
+  bool run() {
+    for (llvm::Loop *L : llvm::reverse(LI.getLoopsInPreorder())) {
+      hoistInvariantLoads(L);
+    }
+    // Blocks inherit the cache of their immediate dominator when it is
+    // also their only predecessor.
+    llvm::DenseMap<llvm::BasicBlock *, CacheState> States;
+    for (llvm::BasicBlock *BB : llvm::depth_first(&F.getEntryBlock())) {
+      CacheState State;
+      if (llvm::BasicBlock *Pred = BB->getSinglePredecessor()) {
+        auto It = States.find(Pred);
+        if (It != States.end()) {
+          State = It->second;
+        }
+      }
+      forwardInBlock(*BB, State);
+      States[BB] = std::move(State);
+    }
+    return Changed;
+  }
+
+private:
+  /// SSA value of the slot read by the load \p Call.
+  llvm::Value *materialize(llvm::CallInst *Call, llvm::Value *ValuePtr,
+                           llvm::Type *Ty) {
+    auto It = Materialized.find(Call);
+    if (It != Materialized.end()) {
+      return It->second;
+    }
+    llvm::IRBuilder<> Builder(Call->getNextNode());
+    llvm::Value *Value = Builder.CreateLoad(Ty, ValuePtr, "storage.cached");
+    Materialized[Call] = Value;
+    return Value;
+  }
+
+  /// Replace the load \p A by the known slot value \p Value.
+  void replaceLoad(const Access &A, llvm::Value *Value) {
+    auto *Store = new llvm::StoreInst(Value, A.ValuePtr, A.Call);
+    forwardToBufferLoads(Store);
+    A.Call->eraseFromParent();
+    Changed = true;
+  }
+
+  /// Let the reads of a result buffer that follow \p Store use the
+  /// stored value directly, which exposes pairs of byte swaps around it.
+  void forwardToBufferLoads(llvm::StoreInst *Store) {
+    llvm::Value *Ptr = Store->getPointerOperand();
+    llvm::Value *Value = Store->getValueOperand();
+    for (llvm::Instruction *I = Store->getNextNode(); I;) {
+      llvm::Instruction *Next = I->getNextNode();
+      if (auto *Load = llvm::dyn_cast<llvm::LoadInst>(I)) {
+        if (Load->getPointerOperand() == Ptr && Load->isSimple() &&
+            Load->getType() == Value->getType()) {
+          // Left for DCE; the caller may be iterating over it.
+          Load->replaceAllUsesWith(Value);
+        }
+      } else if (auto *Other = llvm::dyn_cast<llvm::StoreInst>(I)) {
+        if (Other->getPointerOperand()->stripPointerCasts() ==
+                Ptr->stripPointerCasts() ||
+            !llvm::isa<llvm::AllocaInst>(
+                Other->getPointerOperand()->stripPointerCasts())) {
+          return;
+        }
+      } else if (I->mayWriteToMemory() && !llvm::isa<llvm::CallInst>(I)) {
+        return;
+      } else if (auto *Call = llvm::dyn_cast<llvm::CallInst>(I)) {
+        if (Call != Store->getNextNode() &&
+            llvm::is_contained(Call->args(), Ptr)) {
+          return;
+        }
+        if (Call->mayWriteToMemory() && !isStorageLoad(Call) &&
+            classifyCall(Call) != AccessKind::Store) {
+          return;
+        }
+      }
+      I = Next;
+    }
+  }
+
+  /// Whether \p BB runs on every iteration of \p L that leaves the loop,
+  /// so that a load hoisted out of it is not speculated: the host call
+  /// costs gas.
+  bool isGuaranteedToExecute(llvm::BasicBlock *BB,
+                             llvm::ArrayRef<llvm::BasicBlock *> Exits) const {
+    return !Exits.empty() &&
+           llvm::all_of(Exits, [this, BB](llvm::BasicBlock *Exit) {
+             return DT.dominates(BB, Exit);
+           });
+  }
+
+  void hoistInvariantLoads(llvm::Loop *L) {
+    llvm::BasicBlock *Preheader = L->getLoopPreheader();
+    if (!Preheader) {
+      return;
+    }
+    llvm::SmallVector<llvm::BasicBlock *, 4> Exits;
+    L->getExitBlocks(Exits);
+    std::vector<Access> Loads;
+    for (llvm::BasicBlock *BB : L->blocks()) {
+      const bool Hoistable = isGuaranteedToExecute(BB, Exits);
+      for (llvm::Instruction &I : *BB) {
+        auto *Call = llvm::dyn_cast<llvm::CallInst>(&I);
+        if (!Call) {
+          continue;
+        }
+        const AccessKind Kind = classifyCall(Call);
+        if (Kind == AccessKind::Store || Kind == AccessKind::Clobber) {
+          return;
+        }
+        if (Kind == AccessKind::Load && Hoistable) {
+          Loads.push_back(analyzeAccess(Call));
+        }
+      }
+    }
+
+    llvm::Instruction *InsertPt = Preheader->getTerminator();
+    for (const Access &A : Loads) {
+      if (!A.Key || !L->isLoopInvariant(A.Key)) {
+        continue;
+      }
+      if (auto *KeyInst = llvm::dyn_cast<llvm::Instruction>(A.Key);
+          KeyInst && !DT.dominates(KeyInst, InsertPt)) {
+        continue;
+      }
+      llvm::IRBuilder<> Builder(InsertPt);
+      // Fresh buffers in the entry block; the originals may be dynamic
+      // allocas inside the loop.
+      llvm::Type *Ty = A.Key->getType();
+      llvm::IRBuilder<> EntryBuilder(&*F.getEntryBlock().getFirstInsertionPt());
+      llvm::Value *KeyPtr = EntryBuilder.CreateAlloca(Ty, nullptr);
+      llvm::Value *ValuePtr = EntryBuilder.CreateAlloca(Ty, nullptr);
+      Builder.CreateStore(A.Key, KeyPtr);
+      llvm::Type *KeyPtrTy = A.Call->getArgOperand(0)->getType();
+      Builder.CreateCall(
+          A.Call->getFunctionType(), A.Call->getCalledOperand(),
+          {Builder.CreatePointerCast(KeyPtr, KeyPtrTy),
+           Builder.CreatePointerCast(ValuePtr, A.ValuePtr->getType())});
+      replaceLoad(A, Builder.CreateLoad(Ty, ValuePtr, "storage.hoisted"));
+    }
+  }
+
+  void forwardInBlock(llvm::BasicBlock &BB, CacheState &State) {
+    // Stores not yet observed by a load or a clobbering call, which a later
+    // store to the same slot makes dead. This only holds within a block.
+    llvm::SmallVector<Access, 4> Pending;
+
+    for (auto It = BB.begin(); It != BB.end();) {
+      auto *Call = llvm::dyn_cast<llvm::CallInst>(&*It++);
+      if (!Call) {
+        continue;
+      }
+      const Access A = analyzeAccess(Call);
+      switch (A.Kind) {
+      case AccessKind::None:
+        break;
+      case AccessKind::Clobber:
+        State.Known.clear();
+        Pending.clear();
+        break;
+      case AccessKind::Load: {
+        if (!A.Key) {
+          Pending.clear();
+          break;
+        }
+        if (KnownValue *K = State.lookup(A.Key)) {
+          llvm::Value *Value = K->Value;
+          if (!Value) {
+            Value = materialize(K->Source, K->SourcePtr, A.Key->getType());
+            K->Value = Value;
+          }
+          replaceLoad(A, Value);
+          break;
+        }
+        llvm::erase_if(Pending, [&A](const Access &P) {
+          return mayAlias(P.Key, A.Key);
+        });
+        State.Known.push_back({A.Key, nullptr, A.Call, A.ValuePtr});
+        break;
+      }
+      case AccessKind::Store: {
+        if (!A.Key) {
+          State.Known.clear();
+          break;
+        }
+        llvm::Value *Value = findStoredValue(A.ValuePtr, A.Call);
+        if (!Value) {
+          Value = new llvm::LoadInst(A.Key->getType(), A.ValuePtr,
+                                     "storage.stored", A.Call);
+          Changed = true;
+        }
+        auto Dead = llvm::find_if(
+            Pending, [&A](const Access &P) { return P.Key == A.Key; });
+        if (Dead != Pending.end()) {
+          Dead->Call->eraseFromParent();
+          Pending.erase(Dead);
+          Changed = true;
+        }
+        llvm::erase_if(Pending, [&A](const Access &P) {
+          return mayAlias(P.Key, A.Key);
+        });
+        Pending.push_back(A);
+        State.invalidate(A.Key);
+        State.Known.push_back({A.Key, Value, nullptr, nullptr});
+        break;
+      }
+      }
+    }
+  }
+};
+
+} // namespace
+
+llvm::PreservedAnalyses StorageCache::run(llvm::Function &F,
+                                          llvm::FunctionAnalysisManager &FAM) {
+  auto &DT = FAM.getResult<llvm::DominatorTreeAnalysis>(F);
+  auto &LI = FAM.getResult<llvm::LoopAnalysis>(F);
+  if (!StorageCacheImpl(F, DT, LI).run()) {
+    return llvm::PreservedAnalyses::all();
+  }
+  llvm::PreservedAnalyses PA;
+  PA.preserveSet<llvm::CFGAnalyses>();
+  return PA;
+}
+
+} // namespace soll
@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/Frontend/CompilationCache.h"
+#include "soll/Config/Config.h"
+#include "soll/Frontend/CompilerInvocation.h"
+#include <algorithm>
+#include <chrono>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <vector>
+
+namespace soll {
+
+namespace {
+
+constexpr llvm::StringLiteral EntryExtension = ".soll-cache";
+constexpr llvm::StringLiteral EntryMagic = "SOLLCACHE1\n";
+constexpr llvm::StringLiteral PrintedTag = "print";
+constexpr llvm::StringLiteral DiagnosticsTag = "diag";
+
+struct EntryFile {
+  std::string Path;
+  std::uint64_t Size;
+  llvm::sys::TimePoint<> LastUse;
+};
+
+std::vector<EntryFile> listEntries(llvm::StringRef Dir) {
+  std::vector<EntryFile> Entries;
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator It(Dir, EC), End; It != End && !EC;
+       It.increment(EC)) {
+    if (llvm::sys::path::extension(It->path()) != EntryExtension) {
+      continue;
+    }
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(It->path(), Status)) {
+      continue;
+    }
+    Entries.push_back(
+        {It->path(), Status.getSize(), Status.getLastModificationTime()});
+  }
+  return Entries;
+}
+
+/// Entries are a magic line followed by one record per output:
+///   <action number or "print"> <size>\n<out name>\n<size bytes of data>
+/// and at most one record, with an empty name, for the text written to
+/// standard error:
+///   diag <size>\n\n<size bytes of text>
+llvm::Optional<CompilationCache::Entry> parseEntry(llvm::StringRef Text) {
+  if (!Text.consume_front(EntryMagic)) {
+    return llvm::None;
+  }
+  CompilationCache::Entry Entry;
+  while (!Text.empty()) {
+    llvm::StringRef Header, OutName;
+    std::tie(Header, Text) = Text.split('\n');
+    std::tie(OutName, Text) = Text.split('\n');
+    llvm::StringRef Tag, SizeText;
+    std::tie(Tag, SizeText) = Header.split(' ');
+    std::uint64_t Size;
+    if (SizeText.getAsInteger(10, Size) || Size > Text.size()) {
+      return llvm::None;
+    }
+    if (Tag == DiagnosticsTag) {
+      Entry.Diagnostics = Text.take_front(Size).str();
+      Text = Text.drop_front(Size);
+      continue;
+    }
+    CompilationCache::Output Output;
+    unsigned Action;
+    if (Tag == PrintedTag) {
+      Output.Printed = true;
+    } else if (!Tag.getAsInteger(10, Action) &&
+               Action <= static_cast<unsigned>(BackendAction::EmitWasm)) {
+      Output.Action = static_cast<BackendAction>(Action);
+    } else {
+      return llvm::None;
+    }
+    Output.OutName = OutName.str();
+    Output.Data = Text.take_front(Size).str();
+    Text = Text.drop_front(Size);
+    Entry.Outputs.push_back(std::move(Output));
+  }
+  return Entry;
+}
+
+void writeEntry(llvm::raw_ostream &OS,
+                const CompilationCache::OutputList &Outputs,
+                llvm::StringRef Diagnostics) {
+  OS << EntryMagic;
+  if (!Diagnostics.empty()) {
+    OS << DiagnosticsTag << ' ' << Diagnostics.size() << "\n\n"
+       << Diagnostics;
+  }
+  for (const auto &Output : Outputs) {
+    if (Output.Printed) {
+      OS << PrintedTag;
+    } else {
+      OS << static_cast<unsigned>(Output.Action);
+    }
+    OS << ' ' << Output.Data.size() << '\n'
+       << Output.OutName << '\n'
+       << Output.Data;
+  }
+}
+
+} // namespace
+
+CompilationCache::CompilationCache(llvm::StringRef Dir,
+                                   std::uint64_t SizeLimit)
+    : Dir(Dir.str()), SizeLimit(SizeLimit) {}
+
+std::string
+CompilationCache::computeKey(const CompilerInvocation &Invocation,
+                             llvm::StringRef InFile,
+                             llvm::ArrayRef<llvm::StringRef> Buffers) {
+  llvm::MD5 Hash;
+  // Length-prefixed so that adjacent fields cannot run into each other.
+  auto Add = [&Hash](llvm::StringRef Field) {
+    Hash.update(std::to_string(Field.size()));
+    Hash.update(":");
+    Hash.update(Field);
+  };
+  auto AddInt = [&Add](int Value) { Add(std::to_string(Value)); };
+
+  Add("soll " SOLL_VERSION_STRING);
+  Add("llvm " LLVM_VERSION_STRING);
+
+  const FrontendOptions &FrontendOpts = Invocation.getFrontendOpts();
+  AddInt(FrontendOpts.ProgramAction);
+  AddInt(FrontendOpts.Language);
+  // The import graph report is replayed from the entry like an output.
+  AddInt(FrontendOpts.PrintImportGraph);
+  AddInt(FrontendOpts.LibrariesAddressMaps.size());
+  for (const auto &Libraries : FrontendOpts.LibrariesAddressMaps) {
+    Add(Libraries);
+  }
+
+  const TargetOptions &TargetOpts = Invocation.getTargetOpts();
+  AddInt(TargetOpts.BackendTarget);
+  AddInt(TargetOpts.DeployPlatform);
+
+  // NumThreads and TimePasses do not change the outputs.
+  const CodeGenOptions &CodeGenOpts = Invocation.getCodeGenOpts();
+  AddInt(CodeGenOpts.OptimizationLevel);
+  AddInt(CodeGenOpts.Runtime);
+  AddInt(static_cast<int>(CodeGenOpts.Keccak));
+  AddInt(static_cast<int>(CodeGenOpts.Dispatch));
+  AddInt(CodeGenOpts.ProfileGenerate);
+  Add(CodeGenOpts.ProfileUse);
+  if (!CodeGenOpts.ProfileUse.empty()) {
+    if (auto Profile = llvm::MemoryBuffer::getFile(CodeGenOpts.ProfileUse)) {
+      Add((*Profile)->getBuffer());
+    }
+  }
+
+  // The file name ends up in textual IR and in the output file names.
+  Add(InFile);
+  AddInt(Buffers.size());
+  for (llvm::StringRef Buffer : Buffers) {
+    Add(Buffer);
+  }
+
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  return Result.digest().str().str();
+}
+
+std::string CompilationCache::getEntryPath(llvm::StringRef Key) const {
+  llvm::SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, Key + EntryExtension);
+  return Path.str().str();
+}
+
+llvm::Optional<CompilationCache::Entry>
+CompilationCache::lookup(llvm::StringRef Key) {
+  const std::string Path = getEntryPath(Key);
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer) {
+    ++Misses;
+    return llvm::None;
+  }
+  auto Entry = parseEntry((*Buffer)->getBuffer());
+  if (!Entry) {
+    llvm::sys::fs::remove(Path);
+    ++Misses;
+    return llvm::None;
+  }
+
+  // Bump the modification time, which is what eviction goes by.
+  int FD;
+  if (!llvm::sys::fs::openFileForWrite(
+          Path, FD, llvm::sys::fs::CD_OpenExisting, llvm::sys::fs::OF_Append)) {
+    llvm::sys::fs::setLastAccessAndModificationTime(
+        FD, std::chrono::time_point_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now()));
+    llvm::sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+  ++Hits;
+  return Entry;
+}
+
+/// Best effort: an entry that cannot be written only costs a later miss.
+void CompilationCache::store(llvm::StringRef Key, const OutputList &Outputs,
+                             llvm::StringRef Diagnostics) {
+  if (llvm::sys::fs::create_directories(Dir)) {
+    return;
+  }
+  const std::string Path = getEntryPath(Key);
+  auto Temp = llvm::sys::fs::TempFile::create(Path + "-%%%%%%%%.tmp");
+  if (!Temp) {
+    llvm::consumeError(Temp.takeError());
+    return;
+  }
+  {
+    llvm::raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    writeEntry(OS, Outputs, Diagnostics);
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::consumeError(Temp->discard());
+      return;
+    }
+  }
+  if (llvm::Error E = Temp->keep(Path)) {
+    llvm::consumeError(std::move(E));
+    llvm::consumeError(Temp->discard());
+    return;
+  }
+  ++Stores;
+  prune();
+}
+
+/// Evicts the least recently used entries until the cache fits its limit.
+void CompilationCache::prune() {
+  std::vector<EntryFile> Entries = listEntries(Dir);
+  std::uint64_t Total = 0;
+  for (const auto &Entry : Entries) {
+    Total += Entry.Size;
+  }
+  if (Total <= SizeLimit) {
+    return;
+  }
+  llvm::sort(Entries, [](const EntryFile &L, const EntryFile &R) {
+    return L.LastUse < R.LastUse;
+  });
+  for (const auto &Entry : Entries) {
+    if (Total <= SizeLimit) {
+      break;
+    }
+    // Another compiler may have evicted it already.
+    if (!llvm::sys::fs::remove(Entry.Path, /*IgnoreNonExisting=*/false)) {
+      ++Evictions;
+    }
+    Total -= Entry.Size;
+  }
+}
+
+void CompilationCache::printStats(llvm::raw_ostream &OS) const {
+  std::uint64_t Total = 0;
+  const std::vector<EntryFile> Entries = listEntries(Dir);
+  for (const auto &Entry : Entries) {
+    Total += Entry.Size;
+  }
+  const unsigned Lookups = Hits + Misses;
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "  Compilation cache report for '" << Dir << "'\n"
+     << "===" << std::string(73, '-') << "===\n"
+     << "  Hits:      " << Hits
+     << llvm::format(" (%.1f%%)\n",
+                     Lookups ? Hits * 100.0 / Lookups : 0.0)
+     << "  Misses:    " << Misses << '\n'
+     << "  Stored:    " << Stores << '\n'
+     << "  Evicted:   " << Evictions << '\n'
+     << "  Entries:   " << Entries.size() << '\n'
+     << "  Size:      " << Total << " of " << SizeLimit << " bytes\n\n";
+}
+
+} // namespace soll
@@ -13,47 +13,218 @@
 #include "soll/Frontend/TextDiagnostic.h"
 #include "soll/Frontend/TextDiagnosticPrinter.h"
 #include "soll/Lex/Lexer.h"
+#include "soll/Parse/ModuleGraph.h"
 #include "soll/Sema/Sema.h"
 #include <cassert>
 #include <functional>
+#include <llvm/ADT/StringSet.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/Support/Errc.h>
 #include <llvm/Support/Signals.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
 #include <memory>
+#include <thread>
 
 namespace soll {
 
+namespace {
+
+/// Forwards to an output file while keeping a copy for the cache.
+class RecordingOutputStream : public llvm::raw_pwrite_stream {
+  std::unique_ptr<llvm::raw_pwrite_stream> OS;
+  std::string &Data;
+
+  void write_impl(const char *Ptr, size_t Size) override {
+    OS->write(Ptr, Size);
+    Data.append(Ptr, Size);
+  }
+
+  void pwrite_impl(const char *Ptr, size_t Size, uint64_t Offset) override {
+    OS->pwrite(Ptr, Size, Offset);
+    Data.replace(Offset, Size, Ptr, Size);
+  }
+
+  uint64_t current_pos() const override { return Data.size(); }
+
+public:
+  RecordingOutputStream(std::unique_ptr<llvm::raw_pwrite_stream> OS,
+                        std::string &Data)
+      : raw_pwrite_stream(/*Unbuffered=*/true), OS(std::move(OS)),
+        Data(Data) {}
+};
+
+/// Forwards to standard output, or nowhere, while keeping a copy.
+class RecordingPrintStream : public llvm::raw_ostream {
+  llvm::raw_ostream &OS;
+  std::string &Data;
+
+  void write_impl(const char *Ptr, size_t Size) override {
+    OS.write(Ptr, Size);
+    Data.append(Ptr, Size);
+  }
+
+  uint64_t current_pos() const override { return Data.size(); }
+
+public:
+  RecordingPrintStream(llvm::raw_ostream &OS, std::string &Data)
+      : raw_ostream(/*unbuffered=*/true), OS(OS), Data(Data) {}
+};
+
+/// Passes diagnostics on to \p Target while rendering a plain copy of them.
+class RecordingDiagnosticConsumer : public DiagnosticConsumer {
+  DiagnosticConsumer &Target;
+  TextDiagnosticPrinter Recorder;
+
+public:
+  RecordingDiagnosticConsumer(DiagnosticConsumer &Target, llvm::raw_ostream &OS,
+                              DiagnosticOptions *DiagOpts)
+      : Target(Target), Recorder(OS, DiagOpts) {}
+
+  void BeginSourceFile() override {
+    Target.BeginSourceFile();
+    Recorder.BeginSourceFile();
+  }
+  void EndSourceFile() override {
+    Recorder.EndSourceFile();
+    Target.EndSourceFile();
+  }
+  void finish() override { Target.finish(); }
+  bool IncludeInDiagnosticCounts() const override {
+    return Target.IncludeInDiagnosticCounts();
+  }
+  void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(DiagLevel, Info);
+    Target.HandleDiagnostic(DiagLevel, Info);
+    Recorder.HandleDiagnostic(DiagLevel, Info);
+  }
+};
+
+/// Keeps a copy of everything \p CI writes to standard error, diagnostics
+/// without colors, in \p Text for as long as it lives.
+class ErrorRecording {
+  CompilerInstance &CI;
+  llvm::raw_ostream &PrevErrorStream;
+  RecordingPrintStream ErrorOS;
+  RecordingPrintStream DiagOS;
+  llvm::IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts;
+  DiagnosticConsumer *Client;
+  std::unique_ptr<DiagnosticConsumer> OwnedClient;
+  RecordingDiagnosticConsumer Recorder;
+
+public:
+  ErrorRecording(CompilerInstance &CI, std::string &Text)
+      : CI(CI), PrevErrorStream(CI.getErrorStream()),
+        ErrorOS(PrevErrorStream, Text), DiagOS(llvm::nulls(), Text),
+        DiagOpts(new DiagnosticOptions(
+            CI.getInvocation().GetDiagnosticOptions())),
+        Client(CI.getDiagnostics().getClient()),
+        OwnedClient(CI.getDiagnostics().takeClient()),
+        Recorder(*Client, DiagOS, DiagOpts.get()) {
+    DiagOpts->ShowColors = false;
+    CI.setErrorStream(&ErrorOS);
+    CI.getDiagnostics().setClient(&Recorder, /*ShouldOwnClient=*/false);
+  }
+
+  ~ErrorRecording() {
+    const bool OwnsClient = OwnedClient != nullptr;
+    OwnedClient.release();
+    CI.getDiagnostics().setClient(Client, OwnsClient);
+    CI.setErrorStream(&PrevErrorStream);
+  }
+};
+
+/// Actions whose only effect is their output. Checking syntax or timing the
+/// backend must actually run.
+bool isCacheable(ActionKind Action) {
+  switch (Action) {
+  case ASTDump:
+  case EmitAssembly:
+  case EmitBC:
+  case EmitLLVM:
+  case EmitObj:
+  case EmitWasm:
+  case EmitFuncSig:
+  case EmitABI:
+    return true;
+  case EmitLLVMOnly:
+  case EmitCodeGenOnly:
+  case InitOnly:
+  case ParseSyntaxOnly:
+    return false;
+  }
+  llvm_unreachable("Invalid action!");
+}
+
+} // namespace
+
 CompilerInstance::CompilerInstance()
     : Invocation(std::make_unique<CompilerInvocation>()) {}
 
+std::unique_ptr<llvm::raw_pwrite_stream>
+CompilerInstance::createBackendOutputFile(llvm::StringRef InFile,
+                                          BackendAction Action,
+                                          llvm::StringRef OutName) {
+  switch (Action) {
+  case BackendAction::EmitAssembly:
+    return createDefaultOutputFile(false, InFile, "s", OutName);
+  case BackendAction::EmitLL:
+    return createDefaultOutputFile(false, InFile, "ll", OutName);
+  case BackendAction::EmitBC:
+    return createDefaultOutputFile(true, InFile, "bc", OutName);
+  case BackendAction::EmitNothing:
+    return nullptr;
+  case BackendAction::EmitMCNull:
+    return createNullOutputFile();
+  case BackendAction::EmitObj:
+    return createDefaultOutputFile(true, InFile, "o", OutName);
+  case BackendAction::EmitWasm:
+    return createDefaultOutputFile(true, InFile, "wasm", OutName);
+  }
+
+  llvm_unreachable("Invalid action!");
+}
+
 std::function<std::unique_ptr<llvm::raw_pwrite_stream>(
     llvm::StringRef, BackendAction, llvm::StringRef)>
 CompilerInstance::GetOutputStreamFunc() {
   return
       [&](llvm::StringRef InFile, BackendAction Action,
           llvm::StringRef OutName) -> std::unique_ptr<llvm::raw_pwrite_stream> {
-        switch (Action) {
-        case BackendAction::EmitAssembly:
-          return createDefaultOutputFile(false, InFile, "s", OutName);
-        case BackendAction::EmitLL:
-          return createDefaultOutputFile(false, InFile, "ll", OutName);
-        case BackendAction::EmitBC:
-          return createDefaultOutputFile(true, InFile, "bc", OutName);
-        case BackendAction::EmitNothing:
-          return nullptr;
-        case BackendAction::EmitMCNull:
-          return createNullOutputFile();
-        case BackendAction::EmitObj:
-          return createDefaultOutputFile(true, InFile, "o", OutName);
-        case BackendAction::EmitWasm:
-          return createDefaultOutputFile(true, InFile, "wasm", OutName);
+        std::unique_ptr<llvm::raw_pwrite_stream> OS;
+        if (!CapturedOutputs) {
+          OS = createBackendOutputFile(InFile, Action, OutName);
+        } else if (Action != BackendAction::EmitNothing) {
+          OS = std::make_unique<llvm::raw_null_ostream>();
         }
-
-        llvm_unreachable("Invalid action!");
+        CompilationCache::OutputList *Record = getOutputRecord();
+        if (!OS || !Record) {
+          return OS;
+        }
+        CompilationCache::Output &Output = Record->emplace_back();
+        Output.Action = Action;
+        Output.OutName = OutName.str();
+        return std::make_unique<RecordingOutputStream>(std::move(OS),
+                                                       Output.Data);
       };
 }
 
+llvm::raw_ostream &CompilerInstance::getPrintStream() {
+  CompilationCache::OutputList *Record = getOutputRecord();
+  if (!Record) {
+    return llvm::outs();
+  }
+  if (!PrintStream) {
+    CompilationCache::Output &Output = Record->emplace_back();
+    Output.Printed = true;
+    PrintStream = std::make_unique<RecordingPrintStream>(
+        CapturedOutputs ? llvm::nulls() : llvm::outs(), Output.Data);
+  }
+  return *PrintStream;
+}
+
 CompilerInvocation &CompilerInstance::getInvocation() {
   assert(Invocation.get() != nullptr);
   return *Invocation;
@@ -318,18 +489,236 @@ bool CompilerInstance::InitializeSourceManager(const FrontendInputFile &Input) {
   return true;
 }
 
-bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
-  if (!hasDiagnostics()) {
-    createDiagnostics();
+/// Key of the cache entry for \p Input, or empty if it cannot be cached.
+std::string CompilerInstance::getCacheKey(const FrontendInputFile &Input) {
+  if (Input.getFile() == "-") {
+    return {};
+  }
+  if (!hasVirtualFileSystem()) {
+    setVirtualFileSystem(llvm::vfs::getRealFileSystem());
+  }
+  auto Buffer = getVirtualFileSystem().getBufferForFile(Input.getFile());
+  if (!Buffer) {
+    // Compile as usual and let that report the error.
+    return {};
+  }
+
+  // Imported files are part of the input too. Any file the scan finds is
+  // hashed along with its path; a missing one leaves its path in the key.
+  std::vector<std::string> Names = {Input.getFile().str()};
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> Sources;
+  Sources.push_back(std::move(*Buffer));
+  std::vector<llvm::StringRef> Buffers = {Sources.front()->getBuffer()};
+  llvm::StringSet<> Seen;
+  Seen.insert(Input.getFile());
+  for (size_t I = 0; I < Sources.size(); ++I) {
+    for (const auto &Path : ModuleGraph::scanImports(Sources[I]->getBuffer())) {
+      std::string Resolved = ModuleGraph::resolvePath(Names[I], Path);
+      if (!Seen.insert(Resolved).second) {
+        continue;
+      }
+      Buffers.push_back(Seen.find(Resolved)->first());
+      auto Imported = getVirtualFileSystem().getBufferForFile(Resolved);
+      if (!Imported) {
+        continue;
+      }
+      Names.push_back(std::move(Resolved));
+      Sources.push_back(std::move(*Imported));
+      Buffers.push_back(Sources.back()->getBuffer());
+    }
+  }
+  return CompilationCache::computeKey(getInvocation(), Input.getFile(),
+                                      Buffers);
+}
+
+void CompilerInstance::replayOutputs(
+    const FrontendInputFile &Input,
+    const CompilationCache::OutputList &Outputs) {
+  if (CapturedOutputs) {
+    CapturedOutputs->insert(CapturedOutputs->end(), Outputs.begin(),
+                            Outputs.end());
+    return;
+  }
+  for (const auto &Output : Outputs) {
+    if (Output.Printed) {
+      llvm::outs() << Output.Data;
+    } else if (auto OS = createBackendOutputFile(Input.getFile(),
+                                                 Output.Action,
+                                                 Output.OutName)) {
+      *OS << Output.Data;
+    }
+  }
+}
+
+unsigned CompilerInstance::getNumInputThreads() const {
+  const unsigned NumThreads = getCodeGenOpts().NumThreads;
+  if (NumThreads == 0) {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+  return NumThreads;
+}
+
+/// Compiles each input in a compiler instance of its own on a thread pool.
+/// Outputs and rendered diagnostics wait in memory and are written out here
+/// in input order, as soon as all earlier inputs are done. The cache is only
+/// touched from this thread.
+bool CompilerInstance::executeConcurrently(const ActionFactory &CreateAction,
+                                           unsigned NumThreads) {
+  struct InputJob {
+    std::string Key;
+    bool Cached = false;
+    bool Success = false;
+    CompilationCache::OutputList Outputs;
+    std::string Diagnostics;
+  };
+
+  const std::vector<FrontendInputFile> &Inputs = getFrontendOpts().Inputs;
+  std::vector<InputJob> Jobs(Inputs.size());
+  if (Cache) {
+    for (size_t I = 0; I < Inputs.size(); ++I) {
+      Jobs[I].Key = getCacheKey(Inputs[I]);
+      if (Jobs[I].Key.empty()) {
+        continue;
+      }
+      if (auto Entry = Cache->lookup(Jobs[I].Key)) {
+        Jobs[I].Outputs = std::move(Entry->Outputs);
+        Jobs[I].Diagnostics = std::move(Entry->Diagnostics);
+        Jobs[I].Cached = true;
+        Jobs[I].Success = true;
+      }
+    }
   }
 
+  // Threads left over when there are fewer inputs than threads go to the
+  // contracts within each input.
+  const unsigned EntryThreads = std::max<size_t>(
+      1, NumThreads / std::min<size_t>(NumThreads, Inputs.size()));
+  const bool ShowColors = Invocation->GetDiagnosticOptions().ShowColors;
+  auto Compile = [&](const FrontendInputFile &Input, InputJob &Job) {
+    llvm::raw_string_ostream DiagOS(Job.Diagnostics);
+    CompilerInstance Child;
+    CompilerInvocation &ChildInvocation = Child.getInvocation();
+    ChildInvocation.getCodeGenOpts() = getCodeGenOpts();
+    ChildInvocation.getCodeGenOpts().NumThreads = EntryThreads;
+    ChildInvocation.getFileSystemOpts() = getFileSystemOpts();
+    ChildInvocation.getFrontendOpts() = getFrontendOpts();
+    ChildInvocation.getFrontendOpts().Inputs = {Input};
+    ChildInvocation.getFrontendOpts().CacheDir.clear();
+    ChildInvocation.getTargetOpts() = getTargetOpts();
+    ChildInvocation.GetDiagnosticOptions().ShowColors = ShowColors;
+    if (hasVirtualFileSystem()) {
+      Child.setVirtualFileSystem(VirtualFileSystem);
+    }
+    Child.createDiagnostics(new TextDiagnosticPrinter(
+        DiagOS, &ChildInvocation.GetDiagnosticOptions()));
+    Child.setErrorStream(&DiagOS);
+    Child.captureOutputs(&Job.Outputs);
+    std::unique_ptr<FrontendAction> Act = CreateAction(Child);
+    Job.Success = Act && Child.ExecuteAction(*Act);
+    DiagOS.flush();
+  };
+
+  bool Success = true;
+  {
+#if LLVM_VERSION_MAJOR >= 11
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+#else
+    llvm::ThreadPool Pool(NumThreads);
+#endif
+    std::vector<std::shared_future<void>> Done(Inputs.size());
+    for (size_t I = 0; I < Inputs.size(); ++I) {
+      if (!Jobs[I].Cached) {
+        Done[I] = Pool.async(
+            [&Compile, &Input = Inputs[I], &Job = Jobs[I]] {
+              Compile(Input, Job);
+            });
+      }
+    }
+
+    for (size_t I = 0; I < Inputs.size(); ++I) {
+      InputJob &Job = Jobs[I];
+      if (Done[I].valid()) {
+        Done[I].wait();
+      }
+      llvm::errs() << Job.Diagnostics;
+      if (!Job.Key.empty() && !Job.Cached && Job.Success) {
+        Cache->store(Job.Key, Job.Outputs, Job.Diagnostics);
+      }
+      replayOutputs(Inputs[I], Job.Outputs);
+      Success &= Job.Success;
+    }
+  }
+  return Success;
+}
+
+void CompilerInstance::executeSequentially(FrontendAction &Act) {
   for (FrontendInputFile &InputFile : getFrontendOpts().Inputs) {
+    std::string Key;
+    if (Cache) {
+      Key = getCacheKey(InputFile);
+    }
+    // A hit skips parsing, analysis and code generation altogether. Only
+    // compilations without errors are stored, along with the warnings and
+    // reports they wrote to standard error.
+    if (!Key.empty()) {
+      if (auto Entry = Cache->lookup(Key)) {
+        getErrorStream() << Entry->Diagnostics;
+        replayOutputs(InputFile, Entry->Outputs);
+        continue;
+      }
+    }
+
+    CompilationCache::OutputList Outputs;
+    std::string Diagnostics;
+    std::unique_ptr<ErrorRecording> Recording;
+    const unsigned NumErrors = getDiagnostics().getClient()->getNumErrors();
+    if (!Key.empty()) {
+      CacheRecord = &Outputs;
+      Recording = std::make_unique<ErrorRecording>(*this, Diagnostics);
+    }
+    bool Compiled = false;
     if (Act.BeginSourceFile(*this, InputFile)) {
       Act.Execute();
       Act.EndSourceFile();
+      Compiled = true;
     }
+    Recording.reset();
+    CacheRecord = nullptr;
+    PrintStream.reset();
+    if (!Key.empty() && Compiled &&
+        getDiagnostics().getClient()->getNumErrors() == NumErrors) {
+      Cache->store(Key, Outputs, Diagnostics);
+    }
+    if (CapturedOutputs) {
+      CapturedOutputs->splice(CapturedOutputs->end(), Outputs);
+    }
+  }
+}
+
+bool CompilerInstance::ExecuteAction(FrontendAction &Act,
+                                     ActionFactory CreateAction) {
+  if (!hasDiagnostics()) {
+    createDiagnostics();
+  }
+
+  const FrontendOptions &Opts = getFrontendOpts();
+  if (!Opts.CacheDir.empty() && isCacheable(Opts.ProgramAction)) {
+    Cache =
+        std::make_unique<CompilationCache>(Opts.CacheDir, Opts.CacheSizeLimit);
+  }
+
+  bool Success = true;
+  const unsigned NumThreads = getNumInputThreads();
+  if (CreateAction && NumThreads > 1 && Opts.Inputs.size() > 1) {
+    Success = executeConcurrently(CreateAction, NumThreads);
+  } else {
+    executeSequentially(Act);
+  }
+
+  if (Cache && Opts.ShowCacheStats) {
+    Cache->printStats(llvm::errs());
   }
-  return !getDiagnostics().getClient()->getNumErrors();
+  return Success && !getDiagnostics().getClient()->getNumErrors();
 }
 
 } // namespace soll
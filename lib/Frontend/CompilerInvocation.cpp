@@ -7,6 +7,7 @@
 #include "soll/Frontend/FrontendActions.h"
 #include "soll/Frontend/TextDiagnostic.h"
 #include "soll/Frontend/TextDiagnosticPrinter.h"
+#include <llvm/IR/PassTimingInfo.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Process.h>
 #include <llvm/Support/raw_ostream.h>
@@ -68,6 +69,94 @@ static cl::opt<OptLevel> OptimizationLevel(
 static cl::opt<bool> Runtime("runtime", cl::desc("Generate for runtime code"),
                              cl::cat(SollCategory));
 
+static cl::opt<unsigned>
+    NumThreads("j", cl::Prefix, cl::init(1),
+               cl::desc("Number of inputs and contracts to compile and link "
+                        "in parallel (0 uses all available cores)"),
+               cl::value_desc("N"), cl::cat(SollCategory));
+
+static cl::opt<KeccakKind> Keccak(
+    "keccak", cl::Optional, cl::ValueRequired,
+    cl::init(KeccakKind::Precompile),
+    cl::desc("How keccak256 is computed on Ewasm"),
+    cl::values(
+        clEnumValN(KeccakKind::Inline, "inline", "Hash in wasm code"),
+        clEnumValN(KeccakKind::Precompile, "precompile",
+                   "Call the precompiled contract"),
+        clEnumValN(KeccakKind::Auto, "auto",
+                   "Hash inputs of at most 136 bytes in wasm code")),
+    cl::cat(SollCategory));
+
+static cl::opt<DispatchKind> Dispatch(
+    "dispatch", cl::Optional, cl::ValueRequired, cl::init(DispatchKind::Auto),
+    cl::desc("How the dispatcher finds the function for a selector"),
+    cl::values(
+        clEnumValN(DispatchKind::Switch, "switch",
+                   "Switch on the selector, usually a binary search"),
+        clEnumValN(DispatchKind::PHF, "phf",
+                   "Jump table indexed by a perfect hash of the selector"),
+        clEnumValN(DispatchKind::Linear, "linear",
+                   "Compare the selector against each function in turn"),
+        clEnumValN(DispatchKind::Auto, "auto",
+                   "Use the perfect hash for contracts with many functions")),
+    cl::cat(SollCategory));
+
+static cl::opt<unsigned> DispatchPHFTries(
+    "dispatch-phf-tries", cl::init(1u << 16), cl::Hidden,
+    cl::desc("Multipliers to try per table size when searching for a "
+             "perfect hash of the selectors"),
+    cl::cat(SollCategory));
+
+static cl::opt<bool> ProfileGenerate(
+    "fprofile-generate",
+    cl::desc("Record function entries and dispatched selectors through "
+             "debug.print32 (Ewasm only)"),
+    cl::cat(SollCategory));
+
+static cl::opt<std::string>
+    ProfileUse("fprofile-use", cl::Optional, cl::ValueRequired,
+               cl::desc("Optimize for the call trace recorded by a "
+                        "-fprofile-generate build"),
+               cl::value_desc("file"), cl::cat(SollCategory));
+
+static cl::opt<std::string>
+    CacheDir("cache-dir", cl::Optional, cl::ValueRequired,
+             cl::desc("Reuse the outputs of earlier compilations of the same "
+                      "sources and options stored in <dir>"),
+             cl::value_desc("dir"), cl::cat(SollCategory));
+
+static cl::opt<unsigned>
+    CacheSize("cache-size", cl::Optional, cl::init(1024),
+              cl::desc("Evict the least recently used cache entries above "
+                       "this many megabytes"),
+              cl::value_desc("MB"), cl::cat(SollCategory));
+
+static cl::opt<bool>
+    CacheStats("cache-stats",
+               cl::desc("Print compilation cache statistics on exit"),
+               cl::cat(SollCategory));
+
+static cl::opt<bool> PrintImportGraph(
+    "print-import-graph",
+    cl::desc("Print the imported modules with their parse times"),
+    cl::cat(SollCategory));
+
+static cl::opt<bool>
+    PreLex("prelex",
+           cl::desc("Lex every source file in full before parsing it"),
+           cl::cat(SollCategory));
+
+static cl::opt<bool>
+    Server("server",
+           cl::desc("Serve JSON compile requests, one per line, instead of "
+                    "compiling the inputs"),
+           cl::cat(SollCategory));
+
+static cl::opt<std::string>
+    ServerSocket("server-socket", cl::Optional, cl::ValueRequired,
+                 cl::desc("Serve on a Unix socket instead of standard input"),
+                 cl::value_desc("path"), cl::cat(SollCategory));
+
 static cl::opt<TargetKind>
     Target("target", cl::Optional, cl::ValueRequired, cl::init(EWASM),
            cl::values(clEnumVal(EWASM, "Generate LLVM IR for Ewasm backend")),
@@ -79,9 +168,12 @@ static void printSOLLVersion(llvm::raw_ostream &OS) {
 }
 
 bool CompilerInvocation::ParseCommandLineOptions(
-    llvm::ArrayRef<const char *> Arg, DiagnosticsEngine &Diags) {
+    llvm::ArrayRef<const char *> Arg, DiagnosticsEngine &Diags,
+    llvm::raw_ostream *Errs) {
   llvm::cl::SetVersionPrinter(printSOLLVersion);
-  llvm::cl::ParseCommandLineOptions(Arg.size(), Arg.data());
+  if (!llvm::cl::ParseCommandLineOptions(Arg.size(), Arg.data(), "", Errs)) {
+    return false;
+  }
 
   DiagnosticOpts->ShowColors = llvm::sys::Process::StandardErrHasColors();
   DiagRenderer =
@@ -95,6 +187,13 @@ bool CompilerInvocation::ParseCommandLineOptions(
   }
   FrontendOpts.ProgramAction = Action;
   FrontendOpts.Language = Language;
+  FrontendOpts.CacheDir = CacheDir;
+  FrontendOpts.CacheSizeLimit = std::uint64_t(CacheSize) << 20;
+  FrontendOpts.ShowCacheStats = CacheStats;
+  FrontendOpts.PrintImportGraph = PrintImportGraph;
+  FrontendOpts.PreLex = PreLex;
+  FrontendOpts.Server = Server || !ServerSocket.empty();
+  FrontendOpts.ServerSocket = ServerSocket;
   if (Target == EWASM) {
     TargetOpts.DeployPlatform = DeployPlatform;
   }
@@ -102,6 +201,15 @@ bool CompilerInvocation::ParseCommandLineOptions(
 
   CodeGenOpts.OptimizationLevel = OptimizationLevel;
   CodeGenOpts.Runtime = Runtime;
+  CodeGenOpts.NumThreads = NumThreads;
+  CodeGenOpts.Keccak = Keccak;
+  CodeGenOpts.Dispatch = Dispatch;
+  CodeGenOpts.DispatchPHFTries = DispatchPHFTries;
+  CodeGenOpts.ProfileGenerate = ProfileGenerate;
+  CodeGenOpts.ProfileUse = ProfileUse;
+  // -time-passes is owned by LLVM, which also uses it to time the legacy
+  // codegen passes.
+  CodeGenOpts.TimePasses = llvm::TimePassesIsEnabled;
   return true;
 }
 
@@ -108,7 +108,10 @@ void ASTFrontendAction::ExecuteAction() {
   if (!CI.hasSema())
     CI.createSema();
 
-  ParseAST(CI.getSema(), CI.getASTConsumer(), CI.getASTContext(), true);
+  ParseAST(CI.getSema(), CI.getASTConsumer(), CI.getASTContext(), true,
+           CI.getFrontendOpts().PrintImportGraph ? &CI.getErrorStream()
+                                                 : nullptr,
+           CI.getFrontendOpts().PreLex);
 }
 
 } // namespace soll
@@ -16,18 +16,18 @@ void InitOnlyAction::ExecuteAction() {}
 std::unique_ptr<ASTConsumer>
 ASTPrintAction::CreateASTConsumer(CompilerInstance &CI,
                                   llvm::StringRef InFile) {
-  return CreateASTPrinter();
+  return CreateASTPrinter(CI.getPrintStream());
 }
 
 std::unique_ptr<ASTConsumer>
 EmitFuncSigAction::CreateASTConsumer(CompilerInstance &CI,
                                      llvm::StringRef InFile) {
-  return CreateFuncSigPrinter();
+  return CreateFuncSigPrinter(CI.getPrintStream());
 }
 
 std::unique_ptr<ASTConsumer>
 EmitABIAction::CreateASTConsumer(CompilerInstance &CI, llvm::StringRef InFile) {
-  return CreateABIPrinter();
+  return CreateABIPrinter(CI.getPrintStream());
 }
 
 SyntaxOnlyAction::~SyntaxOnlyAction() {}
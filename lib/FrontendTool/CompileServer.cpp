@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/Basic/DiagnosticIDs.h"
+#include "soll/Basic/DiagnosticOptions.h"
+#include "soll/Frontend/CompilerInstance.h"
+#include "soll/Frontend/CompilerInvocation.h"
+#include "soll/Frontend/FrontendAction.h"
+#include "soll/Frontend/TextDiagnosticPrinter.h"
+#include "soll/FrontendTool/Utils.h"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Errno.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace soll {
+
+namespace {
+
+llvm::Optional<ActionKind> parseActionName(llvm::StringRef Name) {
+  return llvm::StringSwitch<llvm::Optional<ActionKind>>(Name)
+      .Case("ASTDump", ASTDump)
+      .Case("EmitAssembly", EmitAssembly)
+      .Case("EmitBC", EmitBC)
+      .Case("EmitLLVM", EmitLLVM)
+      .Case("EmitObj", EmitObj)
+      .Case("EmitWasm", EmitWasm)
+      .Case("EmitFuncSig", EmitFuncSig)
+      .Case("EmitABI", EmitABI)
+      .Case("ParseSyntaxOnly", ParseSyntaxOnly)
+      .Default(llvm::None);
+}
+
+llvm::StringRef getExtension(BackendAction Action) {
+  switch (Action) {
+  case BackendAction::EmitAssembly:
+    return "s";
+  case BackendAction::EmitLL:
+    return "ll";
+  case BackendAction::EmitBC:
+    return "bc";
+  case BackendAction::EmitObj:
+    return "o";
+  case BackendAction::EmitWasm:
+    return "wasm";
+  case BackendAction::EmitNothing:
+  case BackendAction::EmitMCNull:
+    return "";
+  }
+  llvm_unreachable("Invalid action!");
+}
+
+bool isBinary(BackendAction Action) {
+  return Action == BackendAction::EmitBC || Action == BackendAction::EmitObj ||
+         Action == BackendAction::EmitWasm;
+}
+
+/// The file an output would have been written to by a normal compile.
+std::string getOutputName(llvm::StringRef InFile,
+                          const CompilationCache::Output &Output) {
+  if (Output.Printed) {
+    return InFile.str();
+  }
+  llvm::SmallString<128> Path(InFile);
+  if (!Output.OutName.empty()) {
+    llvm::sys::path::remove_filename(Path);
+    llvm::sys::path::append(Path, Output.OutName);
+  }
+  llvm::sys::path::replace_extension(Path, getExtension(Output.Action));
+  return Path.str().str();
+}
+
+/// Compiles the sources of one request. Requests look like
+///   {"id": 1, "args": ["-O2"], "actions": ["EmitWasm", "EmitABI"],
+///    "sources": [{"name": "a.sol", "contents": "contract A {}"}]}
+/// where "args" are ordinary soll options and "actions" defaults to the
+/// -action given in "args". Sources live in memory on top of the real file
+/// system. Binary outputs are hex encoded.
+void compile(const llvm::json::Object &Request, llvm::json::Object &Response) {
+  auto Fail = [&Response](const llvm::Twine &Message) {
+    Response["success"] = false;
+    Response["error"] = Message.str();
+  };
+
+  std::vector<std::string> Args = {"soll"};
+  if (const auto *Array = Request.getArray("args")) {
+    for (const auto &Arg : *Array) {
+      auto String = Arg.getAsString();
+      if (!String) {
+        return Fail("'args' must be strings");
+      }
+      Args.push_back(String->str());
+    }
+  }
+
+  llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> Sources(
+      new llvm::vfs::InMemoryFileSystem);
+  std::vector<std::string> Inputs;
+  if (const auto *Array = Request.getArray("sources")) {
+    for (const auto &Source : *Array) {
+      const auto *Object = Source.getAsObject();
+      auto Name = Object ? Object->getString("name") : llvm::None;
+      auto Contents = Object ? Object->getString("contents") : llvm::None;
+      if (!Name || !Contents) {
+        return Fail("'sources' must have a 'name' and 'contents'");
+      }
+      Sources->addFile(*Name, 0,
+                       llvm::MemoryBuffer::getMemBufferCopy(*Contents, *Name));
+      Inputs.push_back(Name->str());
+    }
+  }
+
+  // Options are global, so every request starts over from the defaults.
+  std::string DiagText;
+  llvm::raw_string_ostream DiagOS(DiagText);
+  std::vector<const char *> Argv;
+  for (const auto &Arg : Args) {
+    Argv.push_back(Arg.c_str());
+  }
+  auto Soll = std::make_unique<CompilerInstance>();
+  llvm::IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+  llvm::IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts =
+      new DiagnosticOptions();
+  DiagnosticsEngine Diags(DiagID, &*DiagOpts);
+  llvm::cl::ResetAllOptionOccurrences();
+  if (!Soll->getInvocation().ParseCommandLineOptions(Argv, Diags, &DiagOS)) {
+    return Fail(DiagOS.str());
+  }
+
+  std::vector<ActionKind> Actions;
+  if (const auto *Array = Request.getArray("actions")) {
+    for (const auto &Name : *Array) {
+      auto String = Name.getAsString();
+      auto Action = String ? parseActionName(*String) : llvm::None;
+      if (!Action) {
+        return Fail("unknown action in 'actions'");
+      }
+      Actions.push_back(*Action);
+    }
+  } else {
+    Actions.push_back(Soll->getFrontendOpts().ProgramAction);
+  }
+
+  for (const auto &Input : Soll->getFrontendOpts().Inputs) {
+    Inputs.push_back(Input.getFile().str());
+  }
+
+  llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> FS(
+      new llvm::vfs::OverlayFileSystem(llvm::vfs::getRealFileSystem()));
+  FS->pushOverlay(Sources);
+  Soll->setVirtualFileSystem(FS);
+  Soll->getInvocation().GetDiagnosticOptions().ShowColors = false;
+  Soll->createDiagnostics(new TextDiagnosticPrinter(
+      DiagOS, &Soll->getInvocation().GetDiagnosticOptions()));
+
+  bool Success = true;
+  llvm::json::Array Outputs;
+  for (ActionKind Action : Actions) {
+    Soll->getFrontendOpts().ProgramAction = Action;
+    for (const auto &Input : Inputs) {
+      Soll->getFrontendOpts().Inputs = {FrontendInputFile(Input)};
+      CompilationCache::OutputList Captured;
+      Soll->captureOutputs(&Captured);
+      std::unique_ptr<FrontendAction> Act = CreateFrontendAction(*Soll);
+      Success &= Soll->ExecuteAction(*Act);
+      Soll->captureOutputs(nullptr);
+
+      for (const auto &Output : Captured) {
+        const bool Hex = !Output.Printed && isBinary(Output.Action);
+        Outputs.push_back(llvm::json::Object{
+            {"input", Input},
+            {"name", getOutputName(Input, Output)},
+            {"encoding", Hex ? "hex" : "text"},
+            {"contents", Hex ? llvm::toHex(Output.Data, /*LowerCase=*/true)
+                             : Output.Data},
+        });
+      }
+    }
+  }
+
+  Response["success"] = Success;
+  Response["outputs"] = std::move(Outputs);
+  Response["diagnostics"] = DiagOS.str();
+}
+
+llvm::json::Object handleRequest(llvm::StringRef Line) {
+  const auto Start = std::chrono::steady_clock::now();
+  llvm::json::Object Response;
+  auto Request = llvm::json::parse(Line);
+  if (!Request) {
+    Response["success"] = false;
+    Response["error"] = llvm::toString(Request.takeError());
+  } else if (const auto *Object = Request->getAsObject()) {
+    if (const auto *ID = Object->get("id")) {
+      Response["id"] = *ID;
+    }
+    compile(*Object, Response);
+  } else {
+    Response["success"] = false;
+    Response["error"] = "request is not an object";
+  }
+  Response["time_ms"] = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - Start)
+                            .count();
+  return Response;
+}
+
+/// Answers the requests read from \p InFD, one JSON object per line, until
+/// end of file. Returns false if \p Out went away.
+bool serve(int InFD, llvm::raw_fd_ostream &Out) {
+  std::string Pending;
+  std::vector<char> Buffer(64 * 1024);
+  bool AtEnd = false;
+  while (!AtEnd) {
+    const ssize_t Size = llvm::sys::RetryAfterSignal(-1, ::read, InFD,
+                                                     Buffer.data(),
+                                                     Buffer.size());
+    if (Size <= 0) {
+      // Answer a last request that is not terminated by a newline.
+      AtEnd = true;
+      Pending.push_back('\n');
+    } else {
+      Pending.append(Buffer.data(), Size);
+    }
+
+    size_t Begin = 0;
+    for (size_t End = Pending.find('\n'); End != std::string::npos;
+         End = Pending.find('\n', Begin)) {
+      llvm::StringRef Line =
+          llvm::StringRef(Pending).slice(Begin, End).trim();
+      Begin = End + 1;
+      if (Line.empty()) {
+        continue;
+      }
+      Out << llvm::json::Value(handleRequest(Line)) << '\n';
+      Out.flush();
+      if (Out.has_error()) {
+        Out.clear_error();
+        return false;
+      }
+    }
+    Pending.erase(0, Begin);
+  }
+  return true;
+}
+
+bool serveSocket(llvm::StringRef Path) {
+  sockaddr_un Addr;
+  std::memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  if (Path.size() >= sizeof(Addr.sun_path)) {
+    llvm::errs() << "soll: socket path '" << Path << "' is too long\n";
+    return false;
+  }
+  std::memcpy(Addr.sun_path, Path.data(), Path.size());
+
+  const int Listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  llvm::sys::fs::remove(Path);
+  if (Listener < 0 ||
+      ::bind(Listener, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr)) ||
+      ::listen(Listener, SOMAXCONN)) {
+    llvm::errs() << "soll: cannot listen on '" << Path
+                 << "': " << llvm::sys::StrError() << '\n';
+    if (Listener >= 0) {
+      ::close(Listener);
+    }
+    return false;
+  }
+  // A client hanging up must not take the server down with it.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  // Connections are served one at a time: options are process-wide state.
+  while (true) {
+    const int Connection =
+        llvm::sys::RetryAfterSignal(-1, ::accept, Listener, nullptr, nullptr);
+    if (Connection < 0) {
+      break;
+    }
+    {
+      llvm::raw_fd_ostream Out(Connection, /*shouldClose=*/false);
+      serve(Connection, Out);
+    }
+    ::close(Connection);
+  }
+  llvm::errs() << "soll: accept failed: " << llvm::sys::StrError() << '\n';
+  ::close(Listener);
+  return false;
+}
+
+} // namespace
+
+bool RunCompileServer(llvm::StringRef SocketPath) {
+  if (!SocketPath.empty()) {
+    return serveSocket(SocketPath);
+  }
+  return serve(STDIN_FILENO, llvm::outs());
+}
+
+} // namespace soll
@@ -45,7 +45,7 @@ bool ExecuteCompilerInvocation(CompilerInstance *Soll) {
   std::unique_ptr<FrontendAction> Act(CreateFrontendAction(*Soll));
   if (!Act)
     return false;
-  bool Success = Soll->ExecuteAction(*Act);
+  bool Success = Soll->ExecuteAction(*Act, CreateFrontendAction);
   return Success;
 }
 
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 #include "soll/Lex/Lexer.h"
 #include "soll/Basic/CharInfo.h"
+#include "soll/Basic/CharScan.h"
 #include "soll/Basic/Diagnostic.h"
 #include "soll/Basic/DiagnosticLex.h"
 #include "soll/Lex/Token.h"
@@ -553,12 +554,8 @@ unsigned Lexer::getEscapedNewLineSize(const char *Ptr) {
 }
 
 Token Lexer::LexIdentifier(const char *CurPtr) {
-  // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
-  unsigned char C = *CurPtr++;
-  while (isIdentifierBody(C))
-    C = *CurPtr++;
-
-  --CurPtr; // Back up over the skipped character.
+  // Match [_A-Za-z0-9$]*, we have already matched [_A-Za-z$]
+  CurPtr = skipIdentifierBody(CurPtr, BufferEnd);
 
   const char *IdStart = BufferPtr;
   Token Result = FormTokenWithChars(CurPtr, tok::raw_identifier);
@@ -632,23 +629,8 @@ Token Lexer::LexEndOfFile(const char *CurPtr) {
 }
 
 void Lexer::SkipWhitespace(const char *CurPtr) {
-  unsigned char Char = *CurPtr;
-
-  // Skip consecutive spaces efficiently.
-  while (true) {
-    // Skip horizontal whitespace very aggressively.
-    while (isHorizontalWhitespace(Char))
-      Char = *++CurPtr;
-
-    // Otherwise if we have something other than whitespace, we're done.
-    if (!isVerticalWhitespace(Char))
-      break;
-
-    // OK, but handle newline.
-    Char = *++CurPtr;
-  }
-
-  BufferPtr = CurPtr;
+  // Skip horizontal and vertical whitespace alike, many bytes at a time.
+  BufferPtr = skipWhitespace(CurPtr, BufferEnd);
 }
 
 void Lexer::SkipLineComment(const char *CurPtr) {
@@ -660,11 +642,10 @@ void Lexer::SkipLineComment(const char *CurPtr) {
   // character that ends the line comment.
   char C;
   while (true) {
+    // Skip over characters in the fast loop, up to a newline, DOS-style
+    // newline or potential EOF.
+    CurPtr = findLineEnd(CurPtr, BufferEnd);
     C = *CurPtr;
-    // Skip over characters in the fast loop.
-    while (C != 0 &&               // Potentially EOF.
-           C != '\n' && C != '\r') // Newline or DOS-style newline.
-      C = *++CurPtr;
 
     const char *NextLine = CurPtr;
     if (C != 0) {
@@ -778,13 +759,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 void Lexer::SkipBlockComment(const char *CurPtr) {
   unsigned CharSize;
   unsigned char C = getCharAndSize(CurPtr, CharSize);
@@ -805,43 +779,10 @@ void Lexer::SkipBlockComment(const char *CurPtr) {
   while (true) {
     // Skip over all non-interesting characters until we find end of buffer or a
     // (probably ending) '/' character.
-    if (CurPtr + 24 < BufferEnd) {
-      // While not aligned to a 16-byte boundary.
-      while (C != '/' && ((intptr_t)CurPtr & 0x0F) != 0)
-        C = *CurPtr++;
-
-      if (C == '/')
-        goto FoundSlash;
-
-#ifdef __SSE2__
-      __m128i Slashes = _mm_set1_epi8('/');
-      while (CurPtr + 16 <= BufferEnd) {
-        int cmp = _mm_movemask_epi8(
-            _mm_cmpeq_epi8(*(const __m128i *)CurPtr, Slashes));
-        if (cmp != 0) {
-          // Adjust the pointer to point directly after the first slash. It's
-          // not necessary to set C here, it will be overwritten at the end of
-          // the outer loop.
-          CurPtr += llvm::countTrailingZeros<unsigned>(cmp) + 1;
-          goto FoundSlash;
-        }
-        CurPtr += 16;
-      }
-#elif __ALTIVEC__
-      __vector unsigned char Slashes = {'/', '/', '/', '/', '/', '/', '/', '/',
-                                        '/', '/', '/', '/', '/', '/', '/', '/'};
-      while (CurPtr + 16 <= BufferEnd &&
-             !vec_any_eq(*(const vector unsigned char *)CurPtr, Slashes))
-        CurPtr += 16;
-#else
-      // Scan for '/' quickly.  Many block comments are very large.
-      while (CurPtr[0] != '/' && CurPtr[1] != '/' && CurPtr[2] != '/' &&
-             CurPtr[3] != '/' && CurPtr + 4 < BufferEnd) {
-        CurPtr += 4;
-      }
-#endif
-
-      // It has to be one of the bytes scanned, increment to it and read one.
+    if (C != '/' && CurPtr + 24 < BufferEnd) {
+      // Scan for '/' quickly.  Many block comments are very large.  This
+      // stops at the nul terminator if there is none.
+      CurPtr = findSlash(CurPtr, BufferEnd);
       C = *CurPtr++;
     }
 
@@ -850,7 +791,6 @@ void Lexer::SkipBlockComment(const char *CurPtr) {
       C = *CurPtr++;
 
     if (C == '/') {
-    FoundSlash:
       if (CurPtr[-2] == '*') // We found the final */.  We're done!
         break;
 
@@ -899,6 +839,21 @@ void Lexer::EnterTokenStream(const Token *Toks, unsigned NumToks) {
                       Toks + NumToks);
 }
 
+const TokenStream &Lexer::lexAll() {
+  Stream = std::make_unique<TokenStream>(FileLoc);
+  // Documented contracts average around ten bytes a token.
+  Stream->reserve((BufferEnd - BufferPtr) / 8 + 1);
+  while (true) {
+    if (auto Result = CachedLex()) {
+      Stream->push_back(*Result);
+      if (Result->is(tok::eof)) {
+        break;
+      }
+    }
+  }
+  return *Stream;
+}
+
 unsigned Lexer::MeasureTokenLength(SourceLocation Loc,
                                    const SourceManager &SM) {
   std::pair<FileID, unsigned> LocInfo = SM.getDecomposedLoc(Loc);
@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/Parse/ModuleGraph.h"
+#include "soll/AST/Decl.h"
+#include "soll/Basic/CharInfo.h"
+#include "soll/Basic/DiagnosticParse.h"
+#include "soll/Basic/FileManager.h"
+#include "soll/Basic/SourceManager.h"
+#include "soll/Lex/Lexer.h"
+#include "soll/Parse/Parser.h"
+#include "soll/Sema/Sema.h"
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/Path.h>
+
+namespace soll {
+
+namespace {
+
+std::string hashContents(llvm::StringRef Contents) {
+  llvm::MD5 Hash;
+  Hash.update(Contents);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  return Result.digest().str().str();
+}
+
+bool isRelative(llvm::StringRef Path) {
+  return Path.startswith("./") || Path.startswith("../");
+}
+
+bool hasRelativeImports(llvm::StringRef Source) {
+  return llvm::any_of(ModuleGraph::scanImports(Source),
+                      [](const std::string &Path) { return isRelative(Path); });
+}
+
+double toMilliseconds(std::chrono::steady_clock::duration Time) {
+  return std::chrono::duration<double, std::milli>(Time).count();
+}
+
+} // namespace
+
+ModuleGraph::ModuleGraph(
+    Sema &Actions, const llvm::StringMap<llvm::APInt> &LibrariesAddressMap,
+    bool PreLex)
+    : Actions(Actions), LibrariesAddressMap(LibrariesAddressMap),
+      PreLex(PreLex) {}
+
+ModuleGraph::~ModuleGraph() = default;
+
+SourceModule &ModuleGraph::addModule(llvm::StringRef Path, FileID FID,
+                                     std::string Hash, const FileEntry *File) {
+  Modules.push_back(std::make_unique<SourceModule>());
+  SourceModule &M = *Modules.back();
+  M.Path = Path.str();
+  M.Hash = std::move(Hash);
+  M.FID = FID;
+  ByPath[M.Path] = &M;
+  ByHash.try_emplace(M.Hash, &M);
+  if (File) {
+    ByFile.emplace(File->getUniqueID(), &M);
+  }
+  return M;
+}
+
+std::vector<DeclPtr> ModuleGraph::parse(Parser &P) {
+  SourceManager &SM = Actions.SourceMgr;
+  const FileID FID = SM.getMainFileID();
+  const FileEntry *File = SM.getFileEntryForID(FID);
+  SourceModule &Main =
+      addModule(File ? File->getName() : "", FID,
+                hashContents(SM.getBuffer(FID)->getBuffer()), File);
+  P.setModuleGraph(this, &Main);
+  parseModule(Main, P);
+
+  std::vector<DeclPtr> Nodes;
+  llvm::SmallPtrSet<SourceModule *, 16> Visited;
+  link(Main, Visited, Nodes);
+  return Nodes;
+}
+
+/// Times the parse of \p M, leaving out the modules it imports, which are
+/// parsed while it is.
+void ModuleGraph::parseModule(SourceModule &M, Parser &P) {
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point Start = Clock::now();
+  const Clock::duration OuterNestedTime = NestedTime;
+  NestedTime = Clock::duration::zero();
+  M.Nodes = P.parseSourceUnitParts();
+  const Clock::duration Elapsed = Clock::now() - Start;
+  M.ParseTime += Elapsed - NestedTime;
+  NestedTime = OuterNestedTime + Elapsed;
+}
+
+/// Appends the declarations of \p M after those of the modules it imports.
+/// Import cycles are broken at the first module seen again.
+void ModuleGraph::link(SourceModule &M,
+                       llvm::SmallPtrSetImpl<SourceModule *> &Visited,
+                       std::vector<DeclPtr> &Nodes) {
+  if (!Visited.insert(&M).second) {
+    return;
+  }
+  for (const SourceModule *Import : M.Imports) {
+    link(const_cast<SourceModule &>(*Import), Visited, Nodes);
+  }
+  std::move(M.Nodes.begin(), M.Nodes.end(), std::back_inserter(Nodes));
+  M.Nodes.clear();
+}
+
+const SourceModule *ModuleGraph::import(SourceModule &Importer,
+                                        llvm::StringRef Path,
+                                        SourceLocation Loc) {
+  ++NumImports;
+  const std::string Resolved = resolvePath(Importer.Path, Path);
+  SourceModule *M = nullptr;
+  if (auto It = ByPath.find(Resolved); It != ByPath.end()) {
+    M = It->second;
+    ++NumReused;
+  } else if (!(M = load(Resolved, Loc))) {
+    return nullptr;
+  }
+  ++M->Importers;
+  if (llvm::find(Importer.Imports, M) == Importer.Imports.end()) {
+    Importer.Imports.push_back(M);
+  }
+  return M;
+}
+
+SourceModule *ModuleGraph::load(llvm::StringRef Path, SourceLocation Loc) {
+  SourceManager &SM = Actions.SourceMgr;
+  const FileEntry *File = SM.getFileManager().getFile(Path, /*OpenFile=*/true);
+  if (!File) {
+    Actions.Diag(Loc, diag::err_import_not_found) << Path;
+    return nullptr;
+  }
+  // Another spelling of a path seen before.
+  if (auto It = ByFile.find(File->getUniqueID()); It != ByFile.end()) {
+    ++NumReused;
+    return ByPath[Path] = It->second;
+  }
+  // The SourceManager outlives the compilation of one input, so a file
+  // imported by an earlier input is not read again.
+  const FileID FID = SM.getOrCreateFileID(File);
+  const llvm::MemoryBuffer *Buffer = SM.getBuffer(FID);
+  if (!Buffer) {
+    Actions.Diag(Loc, diag::err_import_not_found) << Path;
+    return nullptr;
+  }
+  // A copy of a module seen before, unless it imports relative to its own
+  // directory: the copy would resolve those imports to other files.
+  std::string Hash = hashContents(Buffer->getBuffer());
+  if (auto It = ByHash.find(Hash);
+      It != ByHash.end() && !hasRelativeImports(Buffer->getBuffer())) {
+    ++NumReused;
+    ByFile.emplace(File->getUniqueID(), It->second);
+    return ByPath[Path] = It->second;
+  }
+
+  SourceModule &M = addModule(Path, FID, std::move(Hash), File);
+  M.Lex = std::make_unique<Lexer>(FID, Buffer, SM);
+  M.Lex->Initialize();
+  if (PreLex) {
+    // Lexing is part of the module's parse time, not of its importer's.
+    const auto Start = std::chrono::steady_clock::now();
+    M.Lex->lexAll();
+    M.ParseTime = std::chrono::steady_clock::now() - Start;
+    NestedTime += M.ParseTime;
+  }
+  Parser P(*M.Lex, Actions, Actions.Diags, LibrariesAddressMap);
+  P.setModuleGraph(this, &M);
+  parseModule(M, P);
+  return &M;
+}
+
+void ModuleGraph::print(llvm::raw_ostream &OS) const {
+  std::chrono::steady_clock::duration Total{};
+  for (const auto &M : Modules) {
+    Total += M->ParseTime;
+  }
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "  Import graph\n"
+     << "===" << std::string(73, '-') << "===\n"
+     << "  Parse (ms)  Imported  Hash      Module\n";
+  for (const auto &M : Modules) {
+    OS << llvm::format("  %10.3f  %8u  ", toMilliseconds(M->ParseTime),
+                       M->Importers)
+       << llvm::StringRef(M->Hash).take_front(8) << "  " << M->Path << '\n';
+    for (const SourceModule *Import : M->Imports) {
+      OS << std::string(36, ' ') << "imports " << Import->Path << '\n';
+    }
+  }
+  OS << llvm::format("  %10.3f  ", toMilliseconds(Total)) << Modules.size()
+     << " modules parsed once for " << NumImports << " imports, "
+     << NumReused << " reused\n\n";
+}
+
+std::string ModuleGraph::resolvePath(llvm::StringRef Importer,
+                                     llvm::StringRef Path) {
+  llvm::SmallString<128> Resolved;
+  if (isRelative(Path)) {
+    Resolved = llvm::sys::path::parent_path(Importer);
+  }
+  llvm::sys::path::append(Resolved, Path);
+  llvm::sys::path::remove_dots(Resolved, /*remove_dot_dot=*/true);
+  return Resolved.str().str();
+}
+
+std::vector<std::string> ModuleGraph::scanImports(llvm::StringRef Source) {
+  std::vector<std::string> Paths;
+  bool InImport = false;
+  size_t I = 0;
+  while (I < Source.size()) {
+    const char C = Source[I];
+    if (Source.substr(I).startswith("//")) {
+      I = Source.find('\n', I);
+    } else if (Source.substr(I).startswith("/*")) {
+      I = Source.find("*/", I + 2);
+      I = I == llvm::StringRef::npos ? I : I + 2;
+    } else if (C == '"' || C == '\'') {
+      size_t End = I + 1;
+      while (End < Source.size() && Source[End] != C && Source[End] != '\n') {
+        End += Source[End] == '\\' ? 2 : 1;
+      }
+      if (InImport) {
+        Paths.push_back(Source.slice(I + 1, End).str());
+        InImport = false;
+      }
+      I = End + 1;
+    } else if (isIdentifierHead(C)) {
+      size_t End = I + 1;
+      while (End < Source.size() && isIdentifierBody(Source[End])) {
+        ++End;
+      }
+      if (Source.slice(I, End) == "import") {
+        InImport = true;
+      }
+      I = End;
+    } else {
+      if (C == ';') {
+        InImport = false;
+      }
+      ++I;
+    }
+  }
+  return Paths;
+}
+
+} // namespace soll
@@ -2,22 +2,34 @@
 #include "soll/Parse/ParseAST.h"
 #include "soll/AST/AST.h"
 #include "soll/AST/ASTConsumer.h"
+#include "soll/Basic/FileManager.h"
 #include "soll/Lex/Lexer.h"
+#include "soll/Parse/ModuleGraph.h"
 #include "soll/Parse/Parser.h"
 #include "soll/Sema/Sema.h"
 #include <memory>
 
 namespace soll {
 
-void ParseAST(Sema &S, ASTConsumer &C, ASTContext &Ctx, bool PrintStats) {
-
+void ParseAST(Sema &S, ASTConsumer &C, ASTContext &Ctx, bool PrintStats,
+              llvm::raw_ostream *ImportGraphOS, bool PreLex) {
+  if (PreLex) {
+    S.Lex.lexAll();
+  }
   auto P =
       std::make_unique<Parser>(S.Lex, S, S.Diags, Ctx.getLibrariesAddressMap());
+  // Owns the lexers of imported files, so it must outlive the AST.
+  ModuleGraph Modules(S, Ctx.getLibrariesAddressMap(), PreLex);
   std::unique_ptr<SourceUnit> root;
 
   switch (Ctx.getLang()) {
   case InputKind::Sol:
+    P->setModuleGraph(&Modules);
     root = P->parse();
+    if (ImportGraphOS) {
+      Modules.print(*ImportGraphOS);
+      S.SourceMgr.getFileManager().PrintStats(*ImportGraphOS);
+    }
     break;
   case InputKind::Yul:
     root = P->parseYul();
@@ -190,7 +190,7 @@ std::unique_ptr<Expr> Parser::parseElementaryOperation() {
   case tok::kw_address:
   case tok::identifier: {
     bool IsCall = false;
-    if (auto Next = TheLexer.LookAhead(0); Next && Next->is(tok::l_paren)) {
+    if (NextToken().is(tok::l_paren)) {
       IsCall = true;
     }
     Expression = Actions.CreateAsmIdentifier(Tok, IsCall);
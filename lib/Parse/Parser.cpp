@@ -6,6 +6,7 @@
 #include "soll/Basic/TokenKinds.h"
 #include "soll/Lex/Lexer.h"
 #include "soll/Lex/Token.h"
+#include "soll/Parse/ModuleGraph.h"
 #include <llvm/Support/Compiler.h>
 namespace soll {
 
@@ -348,37 +349,20 @@ uint64_t token2UnitMultiplier(const Token &Tok) {
 Parser::Parser(Lexer &TheLexer, Sema &Actions, DiagnosticsEngine &Diags,
                const llvm::StringMap<llvm::APInt> &LibrariesAddressMap)
     : TheLexer(TheLexer), Actions(Actions), Diags(Diags),
-      LibrariesAddressMap(LibrariesAddressMap) {
-  Tok = *TheLexer.CachedLex();
+      LibrariesAddressMap(LibrariesAddressMap),
+      Stream(TheLexer.getTokenStream()) {
+  if (Stream)
+    Tok = (*Stream)[StreamPos];
+  else
+    Tok = *TheLexer.CachedLex();
 }
 
 std::unique_ptr<SourceUnit> Parser::parse() {
   std::unique_ptr<SourceUnit> SU;
   {
-    std::vector<std::unique_ptr<Decl>> Nodes;
     const SourceLocation Begin = Tok.getLocation();
-
-    while (Tok.isNot(tok::eof)) {
-      switch (Tok.getKind()) {
-      case tok::kw_pragma:
-        Nodes.push_back(parsePragmaDirective());
-        break;
-      case tok::kw_import:
-        ConsumeToken();
-        break;
-      case tok::kw_abstract:
-      case tok::kw_interface:
-      case tok::kw_library:
-      case tok::kw_contract: {
-        Nodes.push_back(parseContractDefinition());
-        break;
-      }
-      default:
-        ConsumeAnyToken();
-        // TODO : fatalParserError
-        break;
-      }
-    }
+    std::vector<std::unique_ptr<Decl>> Nodes =
+        Modules ? Modules->parse(*this) : parseSourceUnitParts();
     SU = std::make_unique<SourceUnit>(SourceRange(Begin, Tok.getLocation()),
                                       std::move(Nodes));
   }
@@ -390,6 +374,32 @@ std::unique_ptr<SourceUnit> Parser::parse() {
   return SU;
 }
 
+std::vector<std::unique_ptr<Decl>> Parser::parseSourceUnitParts() {
+  std::vector<std::unique_ptr<Decl>> Nodes;
+  while (Tok.isNot(tok::eof)) {
+    switch (Tok.getKind()) {
+    case tok::kw_pragma:
+      Nodes.push_back(parsePragmaDirective());
+      break;
+    case tok::kw_import:
+      parseImportDirective();
+      break;
+    case tok::kw_abstract:
+    case tok::kw_interface:
+    case tok::kw_library:
+    case tok::kw_contract: {
+      Nodes.push_back(parseContractDefinition());
+      break;
+    }
+    default:
+      ConsumeAnyToken();
+      // TODO : fatalParserError
+      break;
+    }
+  }
+  return Nodes;
+}
+
 std::unique_ptr<PragmaDirective> Parser::parsePragmaDirective() {
   // pragma anything* ;
   // Currently supported:
@@ -433,6 +443,36 @@ std::unique_ptr<PragmaDirective> Parser::parsePragmaDirective() {
   return std::make_unique<PragmaDirective>(SourceRange(Begin, End));
 }
 
+void Parser::parseImportDirective() {
+  // import "path" ;
+  // import {Symbol, ...} from "path" ;
+  // Either way every declaration of the imported file becomes visible.
+  // Aliases, as in `import * as X from "path"`, are not supported yet.
+  ConsumeToken(); // 'import'
+  llvm::Optional<std::string> Path;
+  SourceLocation PathLoc;
+  while (!Tok.isOneOf(tok::semi, tok::eof)) {
+    if (Tok.isOneOf(tok::kw_as, tok::star)) {
+      Diag(diag::err_unimplemented_import_alias);
+    } else if (Tok.is(tok::string_literal) && !Path) {
+      Path = stringUnquote(
+          llvm::StringRef(Tok.getLiteralData(), Tok.getLength()));
+      PathLoc = Tok.getLocation();
+    }
+    ConsumeAnyToken();
+  }
+  if (!Path) {
+    Diag(diag::err_expected) << tok::string_literal;
+  }
+  if (ExpectAndConsumeSemi() || !Path) {
+    return;
+  }
+
+  if (Modules && CurrentModule) {
+    Modules->import(*CurrentModule, *Path, PathLoc);
+  }
+}
+
 std::pair<ContractDecl::ContractKind, bool> Parser::parseContractKind() {
   ContractDecl::ContractKind Kind;
   bool Abstract = false;
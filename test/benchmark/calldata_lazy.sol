@@ -0,0 +1,27 @@
+// RUN: %soll %s
+// RUN: %soll --runtime -action=EmitLLVM - < %s | FileCheck %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract CALLDATALAZY {
+  uint total;
+
+  function first(uint a, uint b, uint c, uint d) public pure returns(uint) {
+    return a;
+  }
+  function last(uint a, uint b, uint c, uint d) public pure returns(uint) {
+    return d;
+  }
+  function middle(uint a, uint b, uint c, uint d) public pure returns(uint) {
+    return b + c;
+  }
+  function skipString(string memory s, uint x) public {
+    total += x;
+  }
+  function initOnly(uint a, uint b) public pure returns(uint) {
+    uint x = a + 1;
+    return x;
+  }
+}
+// Only the head of `a` is copied, so the length of the whole head is checked.
+// CHECK: icmp uge i32 %size{{[0-9]*}}, 68
+// CHECK: call i256 @"{{[^"]*}}initOnly(uint256,uint256)"(i256 %{{[^,]+}}, i256 undef)
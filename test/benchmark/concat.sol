@@ -0,0 +1,21 @@
+// RUN: %soll %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract CONCAT {
+	// repeatedly append a large payload, dominated by memory copies
+	function concat(bytes memory data, uint times) public pure returns(uint) {
+		bytes memory result = data;
+		for(uint i = uint(0); i < times; i += 1) {
+			result = abi.encodePacked(result, data);
+		}
+		return result.length;
+	}
+	function encode(bytes memory data, uint times) public pure returns(uint) {
+		uint length = uint(0);
+		for(uint i = uint(0); i < times; i += 1) {
+			bytes memory encoded = abi.encode(data, data, data, data);
+			length += encoded.length;
+		}
+		return length;
+	}
+}
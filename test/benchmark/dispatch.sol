@@ -0,0 +1,287 @@
+// RUN: %soll -dispatch=switch %s
+// RUN: %soll -dispatch=phf %s
+// RUN: %soll -dispatch=linear %s
+// RUN: %soll -O2 %s
+// RUN: %soll --runtime -dispatch=phf -action=EmitLLVM - < %s | FileCheck --check-prefix=PHF %s
+// RUN: %soll --runtime -dispatch=phf -dispatch-phf-tries=1 -action=EmitLLVM - < %s | FileCheck --check-prefix=FALLBACK --implicit-check-not=dispatch.mul %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract DISPATCH {
+  uint total;
+
+  function f00(uint x) public {
+    total += x + 0;
+  }
+
+  function f01(uint x) public {
+    total += x + 1;
+  }
+
+  function f02(uint x) public {
+    total += x + 2;
+  }
+
+  function f03(uint x) public {
+    total += x + 3;
+  }
+
+  function f04(uint x) public {
+    total += x + 4;
+  }
+
+  function f05(uint x) public {
+    total += x + 5;
+  }
+
+  function f06(uint x) public {
+    total += x + 6;
+  }
+
+  function f07(uint x) public {
+    total += x + 7;
+  }
+
+  function f08(uint x) public {
+    total += x + 8;
+  }
+
+  function f09(uint x) public {
+    total += x + 9;
+  }
+
+  function f10(uint x) public {
+    total += x + 10;
+  }
+
+  function f11(uint x) public {
+    total += x + 11;
+  }
+
+  function f12(uint x) public {
+    total += x + 12;
+  }
+
+  function f13(uint x) public {
+    total += x + 13;
+  }
+
+  function f14(uint x) public {
+    total += x + 14;
+  }
+
+  function f15(uint x) public {
+    total += x + 15;
+  }
+
+  function f16(uint x) public {
+    total += x + 16;
+  }
+
+  function f17(uint x) public {
+    total += x + 17;
+  }
+
+  function f18(uint x) public {
+    total += x + 18;
+  }
+
+  function f19(uint x) public {
+    total += x + 19;
+  }
+
+  function f20(uint x) public {
+    total += x + 20;
+  }
+
+  function f21(uint x) public {
+    total += x + 21;
+  }
+
+  function f22(uint x) public {
+    total += x + 22;
+  }
+
+  function f23(uint x) public {
+    total += x + 23;
+  }
+
+  function f24(uint x) public {
+    total += x + 24;
+  }
+
+  function f25(uint x) public {
+    total += x + 25;
+  }
+
+  function f26(uint x) public {
+    total += x + 26;
+  }
+
+  function f27(uint x) public {
+    total += x + 27;
+  }
+
+  function f28(uint x) public {
+    total += x + 28;
+  }
+
+  function f29(uint x) public {
+    total += x + 29;
+  }
+
+  function f30(uint x) public {
+    total += x + 30;
+  }
+
+  function f31(uint x) public {
+    total += x + 31;
+  }
+
+  function f32(uint x) public {
+    total += x + 32;
+  }
+
+  function f33(uint x) public {
+    total += x + 33;
+  }
+
+  function f34(uint x) public {
+    total += x + 34;
+  }
+
+  function f35(uint x) public {
+    total += x + 35;
+  }
+
+  function f36(uint x) public {
+    total += x + 36;
+  }
+
+  function f37(uint x) public {
+    total += x + 37;
+  }
+
+  function f38(uint x) public {
+    total += x + 38;
+  }
+
+  function f39(uint x) public {
+    total += x + 39;
+  }
+
+  function f40(uint x) public {
+    total += x + 40;
+  }
+
+  function f41(uint x) public {
+    total += x + 41;
+  }
+
+  function f42(uint x) public {
+    total += x + 42;
+  }
+
+  function f43(uint x) public {
+    total += x + 43;
+  }
+
+  function f44(uint x) public {
+    total += x + 44;
+  }
+
+  function f45(uint x) public {
+    total += x + 45;
+  }
+
+  function f46(uint x) public {
+    total += x + 46;
+  }
+
+  function f47(uint x) public {
+    total += x + 47;
+  }
+
+  function f48(uint x) public {
+    total += x + 48;
+  }
+
+  function f49(uint x) public {
+    total += x + 49;
+  }
+
+  function f50(uint x) public {
+    total += x + 50;
+  }
+
+  function f51(uint x) public {
+    total += x + 51;
+  }
+
+  function f52(uint x) public {
+    total += x + 52;
+  }
+
+  function f53(uint x) public {
+    total += x + 53;
+  }
+
+  function f54(uint x) public {
+    total += x + 54;
+  }
+
+  function f55(uint x) public {
+    total += x + 55;
+  }
+
+  function f56(uint x) public {
+    total += x + 56;
+  }
+
+  function f57(uint x) public {
+    total += x + 57;
+  }
+
+  function f58(uint x) public {
+    total += x + 58;
+  }
+
+  function f59(uint x) public {
+    total += x + 59;
+  }
+
+  function f60(uint x) public {
+    total += x + 60;
+  }
+
+  function f61(uint x) public {
+    total += x + 61;
+  }
+
+  function f62(uint x) public {
+    total += x + 62;
+  }
+
+  function f63(uint x) public {
+    total += x + 63;
+  }
+}
+
+// The 64 selectors hash into 256 slots. f00 has selector 0x763dac47, loaded
+// as the little-endian i32 1202470262, and lands in slot 202.
+// PHF: %dispatch.mul = mul i32 %hash, -1595333711
+// PHF-NEXT: %dispatch.slot = lshr i32 %dispatch.mul, 24
+// PHF-NEXT: switch i32 %dispatch.slot, label %dispatch.unreachable [
+// PHF-NEXT: i32 0, label
+// PHF: i32 202, label %"{{[^"]*}}f00(uint256).check"
+// PHF: i32 255, label
+// PHF-NEXT: ]
+// PHF: {{^}}dispatch.unreachable:
+// PHF-NEXT: unreachable
+// PHF: {{^}}"{{[^"]*}}f00(uint256).check":
+// PHF-NEXT: %dispatch.cmp{{[0-9]*}} = icmp eq i32 %hash, 1202470262
+// PHF-NEXT: br i1 %dispatch.cmp{{[0-9]*}}, label %"{{[^"]*}}f00(uint256)", label
+
+// With a single multiplier per table size no perfect hash is found, and the
+// dispatcher switches on the selector itself.
+// FALLBACK: switch i32 %hash, label
+// FALLBACK-NEXT: i32 1202470262, label %"{{[^"]*}}f00(uint256)"
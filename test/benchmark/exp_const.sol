@@ -0,0 +1,32 @@
+// RUN: %soll %s
+// RUN: %soll --runtime -action=EmitLLVM - < %s | FileCheck %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract EXPCONST {
+  function cube(uint x) public pure returns(uint) {
+    return x ** 3;
+  }
+  function pow2(uint n) public pure returns(uint) {
+    return 2 ** n;
+  }
+  function decimals(uint amount, uint n) public pure returns(uint) {
+    return amount * 10 ** n;
+  }
+}
+
+// 10**0 up to 10**77 fit in 256 bits.
+// CHECK: @solidity.exp.table = private unnamed_addr constant [78 x i256] [i256 1, i256 10, i256 100,
+// CHECK-LABEL: define {{.*}}pow2(uint256)
+// CHECK: [[IN:%[0-9]+]] = icmp ult i256 [[N:%[0-9a-z.]+]], 256
+// CHECK: [[SHL:%[0-9]+]] = shl i256 1,
+// CHECK-NEXT: %exp.shl = select i1 [[IN]], i256 [[SHL]], i256 0
+// CHECK-NOT: @solidity.expi256(
+// CHECK-LABEL: define {{.*}}decimals(uint256,uint256)
+// CHECK: [[IN:%[0-9]+]] = icmp ult i256 [[N:%[0-9a-z.]+]], 78
+// CHECK-NEXT: br i1 [[IN]], label %[[LOAD:[0-9]+]], label %[[CALL:[0-9]+]]
+// CHECK: [[LOAD]]:
+// CHECK: %exp.table.ptr = getelementptr inbounds [78 x i256], [78 x i256]* @solidity.exp.table, i32 0, i32
+// CHECK-NEXT: %exp.table = load i256, i256* %exp.table.ptr
+// CHECK: [[CALL]]:
+// CHECK-NEXT: [[POW:%[0-9]+]] = call i256 @solidity.expi256(i256 10, i256 [[N]])
+// CHECK: %exp.merge = phi i256 [ %exp.table, %[[LOAD]] ], [ [[POW]], %[[CALL]] ]
@@ -0,0 +1,24 @@
+// RUN: %soll -deploy=Normal -keccak=inline %s
+// RUN: %soll -deploy=Normal -keccak=precompile %s
+// RUN: %soll -deploy=Normal -keccak=auto -O2 %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract KECCAKMAPPING {
+  mapping(address => uint) balanceOf;
+  mapping(address => mapping(address => uint)) allowance;
+
+  function approve(address spender, uint value) public returns(bool) {
+    allowance[msg.sender][spender] = value;
+    return true;
+  }
+  function transferFrom(address from, address to, uint value) public
+      returns(bool) {
+    allowance[from][msg.sender] -= value;
+    balanceOf[from] -= value;
+    balanceOf[to] += value;
+    return true;
+  }
+  function digest(bytes memory data) public pure returns(bytes32) {
+    return keccak256(data);
+  }
+}
@@ -0,0 +1,25 @@
+// RUN: %soll %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract MULDIV {
+	// full width operands, exercising the general division path
+	function muldiv(uint x, uint n) public pure returns(uint) {
+		uint MOD = 0xfffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f;
+		uint r = uint(1);
+		for(uint i = uint(0); i < n; i += 1) {
+			r = (r * x + i) % MOD;
+			x = x / 3 + r;
+		}
+		return r;
+	}
+	// operands that fit in 64 bits, exercising the fast path
+	function muldiv64(uint x, uint n) public pure returns(uint) {
+		uint MOD = 1000000007;
+		uint r = uint(1);
+		for(uint i = uint(0); i < n; i += 1) {
+			r = (r * x) % MOD;
+			x = (x + r) / 2;
+		}
+		return r;
+	}
+}
@@ -0,0 +1,30 @@
+// RUN: %soll -O2 %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract PACKING {
+  struct Position {
+    uint64 amount;
+    uint32 since;
+    bool open;
+  }
+  uint64 a;
+  uint64 b;
+  address owner;
+  bool paused;
+  uint16[20] counters;
+  Position pos;
+
+  function update(uint64 x, uint64 y) public {
+    a = x;
+    b = y;
+    paused = x > y;
+  }
+  function bump(uint i) public {
+    counters[i] += 1;
+    pos.amount += a;
+    pos.open = true;
+  }
+  function total() public view returns(uint) {
+    return a + b + counters[3] + pos.amount;
+  }
+}
@@ -0,0 +1,36 @@
+// RUN: %soll -fprofile-generate %s
+// RUN: printf '0xbb9c05a9 950\n0xb3a75e09 40\n0x3182a070\n' > %t && %soll -fprofile-use=%t %s
+// RUN: %soll -fprofile-use=%t -action=EmitLLVM - < %s | FileCheck %s --implicit-check-not=cold
+// The trace only has selectors, whose counts become the entry counts of the
+// public functions. Nothing is known to be cold.
+// CHECK: define {{.*}}@"{{[^"]*}}transfer(address,uint256)"({{[^)]*}}) [[HOT:#[0-9]+]] !prof [[TRANSFER:![0-9]+]] {
+// CHECK: define {{.*}}@"{{[^"]*}}approve(address,uint256)"({{[^)]*}}) !prof [[APPROVE:![0-9]+]] {
+// CHECK: define {{.*}}@"{{[^"]*}}balanceOf(address)"({{[^)]*}}) !prof [[BALANCE:![0-9]+]] {
+// CHECK: define {{.*}}@"{{[^"]*}}totalSupply()"() {
+// CHECK: attributes [[HOT]] = { inlinehint }
+// CHECK-DAG: [[TRANSFER]] = !{!"function_entry_count", i64 950}
+// CHECK-DAG: [[APPROVE]] = !{!"function_entry_count", i64 40}
+// CHECK-DAG: [[BALANCE]] = !{!"function_entry_count", i64 1}
+pragma solidity >0.4.0 <=0.7.0;
+
+contract PROFILE {
+  mapping(address => uint) balances;
+  mapping(address => mapping(address => uint)) allowances;
+  uint supply;
+
+  function transfer(address to, uint value) public returns(bool) {
+    balances[msg.sender] -= value;
+    balances[to] += value;
+    return true;
+  }
+  function approve(address spender, uint value) public returns(bool) {
+    allowances[msg.sender][spender] = value;
+    return true;
+  }
+  function balanceOf(address owner) public view returns(uint) {
+    return balances[owner];
+  }
+  function totalSupply() public view returns(uint) {
+    return supply;
+  }
+}
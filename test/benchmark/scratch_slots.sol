@@ -0,0 +1,16 @@
+// RUN: %soll %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract SCRATCHSLOTS {
+  mapping(uint => uint) balances;
+  uint total;
+
+  function sum(uint n) public returns(uint) {
+    for (uint i = 0; i < n; ++i) {
+      uint v = balances[i];
+      total += v;
+      balances[i] = v + uint(msg.sender);
+    }
+    return total;
+  }
+}
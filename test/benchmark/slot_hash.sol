@@ -0,0 +1,30 @@
+// RUN: %soll -O2 %s
+// RUN: %soll -O2 -action=EmitLLVM - < %s | FileCheck %s --implicit-check-not='@solidity.slothash2('
+// The markers are lowered to the hash bodies after optimization.
+// CHECK: define internal i256 @solidity.slothash2.body(
+// CHECK: call i256 @solidity.slothash2.body(
+pragma solidity >0.4.0 <=0.7.0;
+
+contract SLOTHASH {
+  struct Account {
+    uint balance;
+    uint nonce;
+  }
+  mapping(address => Account) accounts;
+  uint[] values;
+
+  function push(uint x) public {
+    values.push(x);
+  }
+  function sum() public view returns(uint) {
+    uint s = 0;
+    for (uint i = 0; i < values.length; i += 1) {
+      s += values[i];
+    }
+    return s;
+  }
+  function touch(address a, uint x) public {
+    accounts[a].balance += x;
+    accounts[a].nonce += 1;
+  }
+}
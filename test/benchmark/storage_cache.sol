@@ -0,0 +1,20 @@
+// RUN: %soll -O2 %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract STORAGECACHE {
+  mapping(address => uint) balance;
+  uint total;
+
+  function transfer(address to, uint x, uint fee) public {
+    balance[to] += x;
+    balance[to] -= fee;
+    total = total + x - fee;
+  }
+  function sum(uint n) public view returns(uint) {
+    uint s = 0;
+    for (uint i = 0; i < n; i += 1) {
+      s += total;
+    }
+    return s;
+  }
+}
@@ -0,0 +1,163 @@
+; RUN: %soll-opt -passes=soll-fold-hash %s | FileCheck %s
+
+%bytes = type { i256, i8* }
+
+@transfer = private unnamed_addr constant [33 x i8] c"Transfer(address,address,uint256)"
+@abc = private unnamed_addr constant [3 x i8] c"abc"
+@two.blocks = private unnamed_addr constant [56 x i8] c"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+@zeros = private unnamed_addr constant [128 x i8] zeroinitializer
+
+declare i256 @solidity.keccak256(%bytes)
+declare i256 @solidity.sha256(%bytes)
+
+; keccak256 of an event signature is its topic,
+; 0xddf252ad1be2c89b69c2b068fc378daa952ba7f163c4a11628f55a4df523b3ef.
+; CHECK-LABEL: define i256 @keccak_string(
+; CHECK-NOT: call
+; CHECK: ret i256 -15402802100530019096323380498944738953123845089667699673314898783681816316945
+define i256 @keccak_string() {
+entry:
+  %b0 = insertvalue %bytes undef, i256 33, 0
+  %b1 = insertvalue %bytes %b0, i8* getelementptr inbounds ([33 x i8], [33 x i8]* @transfer, i32 0, i32 0), 1
+  %h = call i256 @solidity.keccak256(%bytes %b1)
+  ret i256 %h
+}
+
+; keccak256 of no bytes,
+; 0xc5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470.
+; CHECK-LABEL: define i256 @keccak_empty(
+; CHECK-NOT: call
+; CHECK: ret i256 -26314937019391520585146947054695941613947897212292807772047415823230471658384
+define i256 @keccak_empty(i8* %p) {
+entry:
+  %b0 = insertvalue %bytes undef, i256 0, 0
+  %b1 = insertvalue %bytes %b0, i8* %p, 1
+  %h = call i256 @solidity.keccak256(%bytes %b1)
+  ret i256 %h
+}
+
+; sha256("abc"),
+; 0xba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad.
+; CHECK-LABEL: define i256 @sha256_abc(
+; CHECK-NOT: call
+; CHECK: ret i256 -31449720750225395057047150080545644193165100970624049661994598178196312549971
+define i256 @sha256_abc() {
+entry:
+  %b0 = insertvalue %bytes undef, i256 3, 0
+  %b1 = insertvalue %bytes %b0, i8* getelementptr inbounds ([3 x i8], [3 x i8]* @abc, i32 0, i32 0), 1
+  %h = call i256 @solidity.sha256(%bytes %b1)
+  ret i256 %h
+}
+
+; 56 bytes leave no room for the length in the first block, so the padding
+; takes a second one,
+; 0x248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1.
+; CHECK-LABEL: define i256 @sha256_two_blocks(
+; CHECK-NOT: call
+; CHECK: ret i256 16533122207477069341668099752125637525043274373652441057433006174010909329089
+define i256 @sha256_two_blocks() {
+entry:
+  %b0 = insertvalue %bytes undef, i256 56, 0
+  %b1 = insertvalue %bytes %b0, i8* getelementptr inbounds ([56 x i8], [56 x i8]* @two.blocks, i32 0, i32 0), 1
+  %h = call i256 @solidity.sha256(%bytes %b1)
+  ret i256 %h
+}
+
+; Three blocks, read from a zero initializer,
+; 0x38723a2e5e8a17aa7950dc008209944e898f69a7bd10a23c839d341e935fd5ca.
+; CHECK-LABEL: define i256 @sha256_zeros(
+; CHECK-NOT: call
+; CHECK: ret i256 25531341637449477457836676944163874157144952606075658703806424446998761428426
+define i256 @sha256_zeros() {
+entry:
+  %b0 = insertvalue %bytes undef, i256 128, 0
+  %b1 = insertvalue %bytes %b0, i8* getelementptr inbounds ([128 x i8], [128 x i8]* @zeros, i32 0, i32 0), 1
+  %h = call i256 @solidity.sha256(%bytes %b1)
+  ret i256 %h
+}
+
+; A concatenation buffer whose words are all stored constants. The words
+; are laid out little-endian, as on Ewasm.
+; CHECK-LABEL: define i256 @keccak_buffer(
+; CHECK-NOT: call
+; CHECK: ret i256 34948812311164644363834174255840921648932937442284162214146836540116424346147
+define i256 @keccak_buffer() {
+entry:
+  %concat = alloca i8, i32 64
+  %p0 = bitcast i8* %concat to i256*
+  store i256 1, i256* %p0
+  %g1 = getelementptr inbounds i8, i8* %concat, i32 32
+  %p1 = bitcast i8* %g1 to i256*
+  store i256 2, i256* %p1
+  %b0 = insertvalue %bytes undef, i256 64, 0
+  %b1 = insertvalue %bytes %b0, i8* %concat, 1
+  %h = call i256 @solidity.keccak256(%bytes %b1)
+  ret i256 %h
+}
+
+; A word that is only known at run time keeps the call.
+; CHECK-LABEL: define i256 @keccak_unknown_word(
+; CHECK: call i256 @solidity.keccak256(
+define i256 @keccak_unknown_word(i256 %x) {
+entry:
+  %concat = alloca i8, i32 64
+  %p0 = bitcast i8* %concat to i256*
+  store i256 1, i256* %p0
+  %g1 = getelementptr inbounds i8, i8* %concat, i32 32
+  %p1 = bitcast i8* %g1 to i256*
+  store i256 %x, i256* %p1
+  %b0 = insertvalue %bytes undef, i256 64, 0
+  %b1 = insertvalue %bytes %b0, i8* %concat, 1
+  %h = call i256 @solidity.keccak256(%bytes %b1)
+  ret i256 %h
+}
+
+; So does a buffer that escapes, and one the function did not allocate.
+; CHECK-LABEL: define i256 @keccak_escaped(
+; CHECK: call i256 @solidity.keccak256(
+; CHECK-LABEL: define i256 @sha256_argument(
+; CHECK: call i256 @solidity.sha256(
+declare void @escape(i8*)
+define i256 @keccak_escaped() {
+entry:
+  %concat = alloca i8, i32 32
+  %p0 = bitcast i8* %concat to i256*
+  store i256 1, i256* %p0
+  call void @escape(i8* %concat)
+  %b0 = insertvalue %bytes undef, i256 32, 0
+  %b1 = insertvalue %bytes %b0, i8* %concat, 1
+  %h = call i256 @solidity.keccak256(%bytes %b1)
+  ret i256 %h
+}
+
+define i256 @sha256_argument(i8* %p) {
+entry:
+  %b0 = insertvalue %bytes undef, i256 3, 0
+  %b1 = insertvalue %bytes %b0, i8* %p, 1
+  %h = call i256 @solidity.sha256(%bytes %b1)
+  ret i256 %h
+}
+
+; A slot hash marker is folded with the hash its body computes, over the
+; little-endian words.
+; CHECK-LABEL: define i256 @slot_hash(
+; CHECK-NOT: call
+; CHECK: ret i256 -27396240960145556055250447427985022122446089636181175620039612304590674521517
+declare i256 @solidity.slothash1(i256) nounwind readnone
+
+define internal i256 @solidity.slothash1.body(i256 %word) nounwind {
+entry:
+  %concat = alloca i8, i32 32
+  %p0 = bitcast i8* %concat to i256*
+  store i256 %word, i256* %p0
+  %b0 = insertvalue %bytes undef, i256 32, 0
+  %b1 = insertvalue %bytes %b0, i8* %concat, 1
+  %h = call i256 @solidity.keccak256(%bytes %b1)
+  ret i256 %h
+}
+
+define i256 @slot_hash() {
+entry:
+  %h = call i256 @solidity.slothash1(i256 5)
+  ret i256 %h
+}
@@ -0,0 +1,31 @@
+; RUN: %soll-opt -passes='function(gvn),soll-lower-slot-hash' %s | FileCheck %s
+
+@llvm.compiler.used = appending global [1 x i8*] [i8* bitcast (i256 (i256, i256)* @solidity.slothash2.body to i8*)], section "llvm.metadata"
+
+declare i256 @solidity.slothash2(i256, i256) nounwind readnone
+
+declare void @sink(i256)
+
+; The markers are commoned up while they are pure, then call the body.
+; CHECK-LABEL: define i256 @twice(
+; CHECK: [[H:%[^ ]+]] = call i256 @solidity.slothash2.body(i256 %key, i256 3)
+; CHECK-NOT: call i256 @solidity.slothash2
+; CHECK: add i256 [[H]], 1
+define i256 @twice(i256 %key) {
+entry:
+  %a = call i256 @solidity.slothash2(i256 %key, i256 3)
+  %b = call i256 @solidity.slothash2(i256 %key, i256 3)
+  %c = add i256 %b, 1
+  call void @sink(i256 %a)
+  ret i256 %c
+}
+
+; The marker and the used list are gone, the body is kept.
+; CHECK-NOT: llvm.compiler.used
+; CHECK-NOT: declare i256 @solidity.slothash2(
+; CHECK: define internal i256 @solidity.slothash2.body(
+define internal i256 @solidity.slothash2.body(i256 %a, i256 %b) nounwind {
+entry:
+  %s = xor i256 %a, %b
+  ret i256 %s
+}
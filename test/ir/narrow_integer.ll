@@ -0,0 +1,92 @@
+; RUN: %soll-opt -passes=soll-narrow-integer %s | FileCheck %s
+
+; Both factors fit in 64 bits, so their product fits in 128.
+; CHECK-LABEL: define i256 @mul_zext64(
+; CHECK: [[A:%.*]] = trunc i256 %x to i128
+; CHECK-NEXT: [[B:%.*]] = trunc i256 %y to i128
+; CHECK-NEXT: [[M:%.*]] = mul i128 [[A]], [[B]]
+; CHECK-NEXT: [[R:%.*]] = zext i128 [[M]] to i256
+; CHECK-NOT: mul i256
+; CHECK: ret i256 [[R]]
+define i256 @mul_zext64(i64 %a, i64 %b) {
+entry:
+  %x = zext i64 %a to i256
+  %y = zext i64 %b to i256
+  %m = mul i256 %x, %y
+  ret i256 %m
+}
+
+; A divisor that may be zero still divides to zero instead of trapping.
+; CHECK-LABEL: define i256 @udiv_maybe_zero(
+; CHECK: [[A:%.*]] = trunc i256 %x to i64
+; CHECK-NEXT: [[B:%.*]] = trunc i256 %y to i64
+; CHECK-NEXT: [[Z:%.*]] = icmp eq i64 [[B]], 0
+; CHECK-NEXT: [[D:%.*]] = select i1 [[Z]], i64 1, i64 [[B]]
+; CHECK-NEXT: [[Q:%.*]] = udiv i64 [[A]], [[D]]
+; CHECK-NEXT: [[S:%.*]] = select i1 [[Z]], i64 0, i64 [[Q]]
+; CHECK-NEXT: [[R:%.*]] = zext i64 [[S]] to i256
+; CHECK: ret i256 [[R]]
+define i256 @udiv_maybe_zero(i64 %a, i64 %b) {
+entry:
+  %x = zext i64 %a to i256
+  %y = zext i64 %b to i256
+  %q = udiv i256 %x, %y
+  ret i256 %q
+}
+
+; A divisor known to be non-zero needs no guard.
+; CHECK-LABEL: define i256 @udiv_non_zero(
+; CHECK: [[A:%.*]] = trunc i256 %x to i64
+; CHECK-NEXT: [[B:%.*]] = trunc i256 %y to i64
+; CHECK-NEXT: [[Q:%.*]] = udiv i64 [[A]], [[B]]
+; CHECK-NEXT: [[R:%.*]] = zext i64 [[Q]] to i256
+; CHECK-NOT: select
+; CHECK: ret i256 [[R]]
+define i256 @udiv_non_zero(i64 %a, i64 %b) {
+entry:
+  %nz = or i64 %b, 1
+  %x = zext i64 %a to i256
+  %y = zext i64 %nz to i256
+  %q = udiv i256 %x, %y
+  ret i256 %q
+}
+
+; Nothing is known about the operands of a division in a loop, so it is
+; versioned on whether both happen to fit in 64 bits at run time.
+; CHECK-LABEL: define i256 @udiv_loop(
+; CHECK: loop:
+; CHECK: [[OR:%.*]] = or i256 %x, %y
+; CHECK-NEXT: [[HI:%.*]] = lshr i256 [[OR]], 64
+; CHECK-NEXT: %is_narrow = icmp eq i256 [[HI]], 0
+; CHECK-NEXT: br i1 %is_narrow, label %[[FAST:[0-9]+]], label %[[SLOW:[0-9]+]]
+; CHECK: [[FAST]]:
+; CHECK: [[Z:%.*]] = icmp eq i64 [[B:%.*]], 0
+; CHECK-NEXT: [[D:%.*]] = select i1 [[Z]], i64 1, i64 [[B]]
+; CHECK-NEXT: %q.narrow = udiv i64 {{%.*}}, [[D]]
+; CHECK-NEXT: [[S:%.*]] = select i1 [[Z]], i64 0, i64 %q.narrow
+; CHECK-NEXT: [[N:%.*]] = zext i64 [[S]] to i256
+; CHECK-NEXT: br label %[[TAIL:[0-9]+]]
+; CHECK: [[SLOW]]:
+; CHECK-NEXT: %q = udiv i256 %x, %y
+; CHECK-NEXT: br label %[[TAIL]]
+; CHECK: [[TAIL]]:
+; CHECK-NEXT: %q.merge = phi i256 [ [[N]], %[[FAST]] ], [ %q, %[[SLOW]] ]
+; CHECK-NEXT: %acc.next = add i256 %acc, %q.merge
+define i256 @udiv_loop(i256* %xs, i256 %y, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i256 [ 0, %entry ], [ %acc.next, %loop ]
+  %p = getelementptr i256, i256* %xs, i32 %i
+  %x = load i256, i256* %p
+  %q = udiv i256 %x, %y
+  %acc.next = add i256 %acc, %q
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i256 %acc.next
+}
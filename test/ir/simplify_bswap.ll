@@ -0,0 +1,100 @@
+; RUN: %soll-opt -passes=soll-simplify-bswap %s | FileCheck %s
+
+declare i64 @llvm.bswap.i64(i64)
+declare i256 @llvm.bswap.i256(i256)
+
+define internal i256 @solidity.bswapi256(i256 %data) {
+entry:
+  %swap = call i256 @llvm.bswap.i256(i256 %data)
+  ret i256 %swap
+}
+
+; Two swaps in a row cancel, both for the helper and for the intrinsic.
+; CHECK-LABEL: define i256 @double_swap(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: ret i256 %x
+define i256 @double_swap(i256 %x) {
+entry:
+  %a = call i256 @solidity.bswapi256(i256 %x)
+  %b = call i256 @solidity.bswapi256(i256 %a)
+  ret i256 %b
+}
+
+; CHECK-LABEL: define i64 @double_swap_i64(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: ret i64 %x
+define i64 @double_swap_i64(i64 %x) {
+entry:
+  %a = call i64 @llvm.bswap.i64(i64 %x)
+  %b = call i64 @llvm.bswap.i64(i64 %a)
+  ret i64 %b
+}
+
+; A swapped load reads the limbs of the operand in reverse order.
+; CHECK-LABEL: define i256 @swap_load(
+; CHECK-NOT: load i256
+; CHECK: [[P3:%[0-9]+]] = getelementptr inbounds i64, i64* %{{[0-9]+}}, i32 3
+; CHECK-NEXT: [[L3:%[0-9]+]] = load i64, i64* [[P3]], align 1
+; CHECK-NEXT: [[S3:%[0-9]+]] = call i64 @llvm.bswap.i64(i64 [[L3]])
+; CHECK: getelementptr inbounds i64, i64* %{{[0-9]+}}, i32 2
+; CHECK: getelementptr inbounds i64, i64* %{{[0-9]+}}, i32 1
+; CHECK: [[P0:%[0-9]+]] = getelementptr inbounds i64, i64* %{{[0-9]+}}, i32 0
+; CHECK-NEXT: [[L0:%[0-9]+]] = load i64, i64* [[P0]], align 1
+; CHECK-NEXT: [[S0:%[0-9]+]] = call i64 @llvm.bswap.i64(i64 [[L0]])
+; CHECK: zext i64 [[S3]] to i256
+; CHECK: [[H:%[0-9]+]] = zext i64 [[S0]] to i256
+; CHECK-NEXT: shl i256 [[H]], 192
+; CHECK-NOT: @solidity.bswapi256
+; CHECK: ret i256
+define i256 @swap_load(i256* %p) {
+entry:
+  %v = load i256, i256* %p
+  %s = call i256 @solidity.bswapi256(i256 %v)
+  ret i256 %s
+}
+
+; A stored swap writes the limbs of the result in reverse order.
+; CHECK-LABEL: define void @swap_store(
+; CHECK: [[H:%[0-9]+]] = lshr i256 %x, 192
+; CHECK-NEXT: [[T:%[0-9]+]] = trunc i256 [[H]] to i64
+; CHECK-NEXT: [[S3:%[0-9]+]] = call i64 @llvm.bswap.i64(i64 [[T]])
+; CHECK: [[T0:%[0-9]+]] = trunc i256 %x to i64
+; CHECK-NEXT: [[S0:%[0-9]+]] = call i64 @llvm.bswap.i64(i64 [[T0]])
+; CHECK: [[P0:%[0-9]+]] = getelementptr inbounds i64, i64* %{{[0-9]+}}, i32 0
+; CHECK-NEXT: store i64 [[S3]], i64* [[P0]], align 1
+; CHECK: [[P3:%[0-9]+]] = getelementptr inbounds i64, i64* %{{[0-9]+}}, i32 3
+; CHECK-NEXT: store i64 [[S0]], i64* [[P3]], align 1
+; CHECK-NOT: store i256
+; CHECK: ret void
+define void @swap_store(i256 %x, i256* %p) {
+entry:
+  %s = call i256 @solidity.bswapi256(i256 %x)
+  store i256 %s, i256* %p
+  ret void
+}
+
+; Shifting out 28 bytes keeps the swap of the low 4 bytes, which is how the
+; dispatcher reads the selector.
+; CHECK-LABEL: define i256 @swap_shift(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: [[T:%[0-9]+]] = trunc i256 %x to i32
+; CHECK-NEXT: [[S:%[0-9]+]] = call i32 @llvm.bswap.i32(i32 [[T]])
+; CHECK-NEXT: [[R:%[0-9]+]] = zext i32 [[S]] to i256
+; CHECK-NEXT: ret i256 [[R]]
+define i256 @swap_shift(i256 %x) {
+entry:
+  %s = call i256 @solidity.bswapi256(i256 %x)
+  %r = lshr i256 %s, 224
+  ret i256 %r
+}
+
+; Shifts by a part of a byte keep the swap.
+; CHECK-LABEL: define i256 @swap_shift_bits(
+; CHECK: call i256 @solidity.bswapi256(i256 %x)
+; CHECK-NEXT: lshr i256 %{{[0-9a-z]+}}, 4
+define i256 @swap_shift_bits(i256 %x) {
+entry:
+  %s = call i256 @solidity.bswapi256(i256 %x)
+  %r = lshr i256 %s, 4
+  ret i256 %r
+}
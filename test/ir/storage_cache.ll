@@ -0,0 +1,251 @@
+; RUN: %soll-opt -passes=soll-storage-cache %s | FileCheck %s
+; RUN: %soll-opt -passes='function(loop(loop-rotate),soll-storage-cache)' %s | FileCheck --check-prefix=ROTATE %s
+
+declare void @ethereum.storageLoad(i256*, i256*)
+declare void @ethereum.storageStore(i256*, i256*)
+declare void @ethereum.finish(i8*, i32)
+
+; A second load of a slot reads the first one's result buffer.
+; CHECK-LABEL: define i256 @load_load(
+; CHECK: call void @ethereum.storageLoad(
+; CHECK-NEXT: [[V:%[^ ]+]] = load i256, i256* %value1
+; CHECK-NOT: call void @ethereum.storageLoad(
+; CHECK: store i256 [[V]], i256* %value2
+; CHECK: ret i256 [[V]]
+define i256 @load_load() {
+entry:
+  %key1 = alloca i256
+  %value1 = alloca i256
+  %key2 = alloca i256
+  %value2 = alloca i256
+  store i256 7, i256* %key1
+  call void @ethereum.storageLoad(i256* %key1, i256* %value1)
+  %a = load i256, i256* %value1
+  store i256 7, i256* %key2
+  call void @ethereum.storageLoad(i256* %key2, i256* %value2)
+  %b = load i256, i256* %value2
+  ret i256 %b
+}
+
+; A load after a store to the same slot takes the stored value.
+; CHECK-LABEL: define i256 @store_load(
+; CHECK: call void @ethereum.storageStore(
+; CHECK-NOT: call void @ethereum.storageLoad(
+; CHECK: ret i256 %x
+define i256 @store_load(i256 %x) {
+entry:
+  %key1 = alloca i256
+  %value1 = alloca i256
+  %key2 = alloca i256
+  %value2 = alloca i256
+  store i256 7, i256* %key1
+  store i256 %x, i256* %value1
+  call void @ethereum.storageStore(i256* %key1, i256* %value1)
+  store i256 7, i256* %key2
+  call void @ethereum.storageLoad(i256* %key2, i256* %value2)
+  %b = load i256, i256* %value2
+  ret i256 %b
+}
+
+; A store whose value is not visible in the block is read back into an SSA
+; value before a later load of the slot is forwarded.
+; CHECK-LABEL: define i256 @store_unknown_load(
+; CHECK: [[S:%storage.stored[^ ]*]] = load i256, i256* %value1
+; CHECK-NEXT: call void @ethereum.storageStore(
+; CHECK-NOT: call void @ethereum.storageLoad(
+; CHECK: ret i256 [[S]]
+define i256 @store_unknown_load(i256* %value1) {
+entry:
+  %key1 = alloca i256
+  %key2 = alloca i256
+  %value2 = alloca i256
+  store i256 7, i256* %key1
+  call void @ethereum.storageStore(i256* %key1, i256* %value1)
+  store i256 7, i256* %key2
+  call void @ethereum.storageLoad(i256* %key2, i256* %value2)
+  %b = load i256, i256* %value2
+  ret i256 %b
+}
+
+; A store to a different constant slot keeps the cached value.
+; CHECK-LABEL: define i256 @store_other_slot(
+; CHECK: call void @ethereum.storageLoad(
+; CHECK: call void @ethereum.storageStore(
+; CHECK-NOT: call void @ethereum.storageLoad(
+; CHECK: ret i256
+define i256 @store_other_slot(i256 %x) {
+entry:
+  %key1 = alloca i256
+  %value1 = alloca i256
+  %key2 = alloca i256
+  %value2 = alloca i256
+  %key3 = alloca i256
+  %value3 = alloca i256
+  store i256 7, i256* %key1
+  call void @ethereum.storageLoad(i256* %key1, i256* %value1)
+  %a = load i256, i256* %value1
+  store i256 8, i256* %key2
+  store i256 %x, i256* %value2
+  call void @ethereum.storageStore(i256* %key2, i256* %value2)
+  store i256 7, i256* %key3
+  call void @ethereum.storageLoad(i256* %key3, i256* %value3)
+  %b = load i256, i256* %value3
+  ret i256 %b
+}
+
+; An unknown call may write any slot.
+; CHECK-LABEL: define i256 @clobber(
+; CHECK: call void @ethereum.storageLoad(
+; CHECK: call void @unknown()
+; CHECK: call void @ethereum.storageLoad(
+define i256 @clobber() {
+entry:
+  %key1 = alloca i256
+  %value1 = alloca i256
+  %key2 = alloca i256
+  %value2 = alloca i256
+  store i256 7, i256* %key1
+  call void @ethereum.storageLoad(i256* %key1, i256* %value1)
+  %a = load i256, i256* %value1
+  call void @unknown()
+  store i256 7, i256* %key2
+  call void @ethereum.storageLoad(i256* %key2, i256* %value2)
+  %b = load i256, i256* %value2
+  ret i256 %b
+}
+
+declare void @unknown()
+
+; A load of an invariant slot on every iteration moves to the preheader.
+; CHECK-LABEL: define i256 @hoist(
+; CHECK: entry:
+; CHECK: call void @ethereum.storageLoad(
+; CHECK: %storage.hoisted = load i256
+; CHECK: br label %loop
+; CHECK: loop:
+; CHECK-NOT: call void @ethereum.storageLoad(
+; CHECK: exit:
+define i256 @hoist(i256 %n) {
+entry:
+  %key = alloca i256
+  %value = alloca i256
+  br label %loop
+
+loop:
+  %i = phi i256 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i256 [ 0, %entry ], [ %sum.next, %loop ]
+  store i256 7, i256* %key
+  call void @ethereum.storageLoad(i256* %key, i256* %value)
+  %v = load i256, i256* %value
+  %sum.next = add i256 %sum, %v
+  %i.next = add i256 %i, 1
+  %cond = icmp ult i256 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret i256 %sum.next
+}
+
+; With the test at the top of the loop, the body does not run on the way
+; out of the loop, so the load stays. Once the loop is rotated, the body
+; dominates the exit and the load moves behind the loop-entry test.
+; CHECK-LABEL: define i256 @hoist_unrotated(
+; CHECK: body:
+; CHECK: call void @ethereum.storageLoad(
+; ROTATE-LABEL: define i256 @hoist_unrotated(
+; ROTATE: entry:
+; ROTATE: [[ENTER:%.*]] = icmp ult i256 0, %n
+; ROTATE-NEXT: br i1 [[ENTER]], label %[[PRE:.*]], label %exit
+; ROTATE: [[PRE]]:
+; ROTATE: call void @ethereum.storageLoad(
+; ROTATE-NEXT: %storage.hoisted = load i256
+; ROTATE: body:
+; ROTATE-NOT: call void @ethereum.storageLoad(
+; ROTATE: exit:
+define i256 @hoist_unrotated(i256 %n) {
+entry:
+  %key = alloca i256
+  %value = alloca i256
+  br label %loop
+
+loop:
+  %i = phi i256 [ 0, %entry ], [ %i.next, %body ]
+  %sum = phi i256 [ 0, %entry ], [ %sum.next, %body ]
+  %cond = icmp ult i256 %i, %n
+  br i1 %cond, label %body, label %exit
+
+body:
+  store i256 7, i256* %key
+  call void @ethereum.storageLoad(i256* %key, i256* %value)
+  %v = load i256, i256* %value
+  %sum.next = add i256 %sum, %v
+  %i.next = add i256 %i, 1
+  br label %loop
+
+exit:
+  ret i256 %sum
+}
+
+; A load that only runs on some iterations stays in the loop, since the
+; host call costs gas even when the loop never reaches it.
+; CHECK-LABEL: define i256 @no_hoist_conditional(
+; CHECK: entry:
+; CHECK-NOT: call void @ethereum.storageLoad(
+; CHECK: br label %loop
+; CHECK: then:
+; CHECK: call void @ethereum.storageLoad(
+define i256 @no_hoist_conditional(i256 %n) {
+entry:
+  %key = alloca i256
+  %value = alloca i256
+  br label %loop
+
+loop:
+  %i = phi i256 [ 0, %entry ], [ %i.next, %latch ]
+  %sum = phi i256 [ 0, %entry ], [ %sum.next, %latch ]
+  %odd = trunc i256 %i to i1
+  br i1 %odd, label %then, label %latch
+
+then:
+  store i256 7, i256* %key
+  call void @ethereum.storageLoad(i256* %key, i256* %value)
+  %v = load i256, i256* %value
+  br label %latch
+
+latch:
+  %add = phi i256 [ %v, %then ], [ 0, %loop ]
+  %sum.next = add i256 %sum, %add
+  %i.next = add i256 %i, 1
+  %cond = icmp ult i256 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret i256 %sum.next
+}
+
+; A store in the loop keeps loads from moving out of it.
+; CHECK-LABEL: define void @no_hoist_store(
+; CHECK: loop:
+; CHECK: call void @ethereum.storageLoad(
+; CHECK: call void @ethereum.storageStore(
+define void @no_hoist_store(i256 %n) {
+entry:
+  %key = alloca i256
+  %value = alloca i256
+  br label %loop
+
+loop:
+  %i = phi i256 [ 0, %entry ], [ %i.next, %loop ]
+  store i256 7, i256* %key
+  call void @ethereum.storageLoad(i256* %key, i256* %value)
+  %v = load i256, i256* %value
+  %w = add i256 %v, 1
+  store i256 %w, i256* %value
+  call void @ethereum.storageStore(i256* %key, i256* %value)
+  %i.next = add i256 %i, 1
+  %cond = icmp ult i256 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -21,7 +21,7 @@ config.test_format = lit.formats.ShTest(not llvm_config.use_lit_shell)
 
 # suffixes: A list of file extensions to treat as test files.
 config.suffixes = [
-    '.sol', '.yul'
+    '.sol', '.yul', '.ll'
 ]
 
 config.available_features = [
@@ -89,7 +89,8 @@ config.available_features = [
 
 # excludes: A list of directories to exclude from the testsuite.
 config.excludes = [
-    'CMakeLists.txt'
+    'CMakeLists.txt',
+    'Inputs'
 ]
 
 # test_source_root: The root path where tests are located.
@@ -101,6 +102,7 @@ config.test_exec_root = os.path.join(config.soll_obj_root, 'test')
 llvm_config.use_default_substitutions()
 
 tool_substitutions = [
+    ToolSubst('%soll-opt', command=config.soll_opt, extra_args=[]),
     ToolSubst('%soll', command=config.soll, extra_args=[]),
 ]
 llvm_config.add_tool_substitutions(tool_substitutions)
@@ -0,0 +1,10 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+pragma solidity >0.4.0 <=0.7.0;
+
+contract Ownable {
+  address owner;
+
+  function isOwner(address account) public view returns (bool) {
+    return account == owner;
+  }
+}
@@ -0,0 +1,10 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+pragma solidity >0.4.0 <=0.7.0;
+
+import "./Ownable.sol";
+
+contract Token is Ownable {
+  function transfer(address to, uint256 value) public returns (bool) {
+    return true;
+  }
+}
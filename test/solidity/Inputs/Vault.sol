@@ -0,0 +1,9 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+pragma solidity >0.4.0 <=0.7.0;
+
+import "./Ownable.sol";
+import {Token} from "./Token.sol";
+
+contract Vault is Ownable {
+  function f() public {}
+}
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// RUN: rm -rf %t && %soll -action=EmitFuncSig --cache-dir=%t %s 2>%t.miss | FileCheck %s
+// RUN: FileCheck --check-prefix=WARN %s < %t.miss
+// RUN: %soll -action=EmitFuncSig --cache-dir=%t --cache-stats %s 2>%t.stats | FileCheck %s
+// RUN: FileCheck --check-prefixes=WARN,STATS %s < %t.stats
+pragma solidity >0.4.0 <=0.7.0;
+
+contract CACHE {
+  function transfer(address to, uint256 value) public returns (bool) {
+    return true;
+  }
+  function balance() public virtual virtual returns (uint256) {
+    return 0;
+  }
+}
+// CHECK-DAG: a9059cbb: transfer(address,uint256)
+// CHECK-DAG: b69ef8a8: balance()
+// WARN: warning: Virtual already specified.
+// STATS: Hits: 1
+// STATS-NEXT: Misses: 0
+// STATS-NEXT: Stored: 0
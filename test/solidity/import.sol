@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// RUN: %soll -action=EmitFuncSig %s | FileCheck %s
+// RUN: %soll -action=EmitFuncSig -print-import-graph %s 2>&1 >/dev/null | FileCheck --check-prefix=GRAPH %s
+// RUN: rm -rf %t && %soll -action=EmitFuncSig -print-import-graph --cache-dir=%t %s 2>&1 >/dev/null | FileCheck --check-prefix=GRAPH %s
+// RUN: %soll -action=EmitFuncSig -print-import-graph --cache-dir=%t %s 2>&1 >/dev/null | FileCheck --check-prefix=GRAPH %s
+// RUN: %soll -action=EmitFuncSig -prelex %s | FileCheck %s
+pragma solidity >0.4.0 <=0.7.0;
+
+import "./Inputs/Token.sol";
+import "./Inputs/Vault.sol";
+import "./Inputs/../Inputs/Ownable.sol";
+
+contract Bank is Token {
+  function balanceOf(address account) public view returns (uint256) {
+    return 0;
+  }
+}
+// Ownable is imported three times but declared once, before its users.
+// CHECK: isOwner(address)
+// CHECK: a9059cbb: transfer(address,uint256)
+// CHECK: 26121ff0: f()
+// CHECK: 70a08231: balanceOf(address)
+
+// GRAPH: Import graph
+// GRAPH: Parse (ms) Imported Hash Module
+// GRAPH-NEXT: {{[0-9.]+}} 0 {{[0-9a-f]{8}}} {{.*}}import.sol
+// GRAPH-NEXT: imports {{.*}}Inputs/Token.sol
+// GRAPH-NEXT: imports {{.*}}Inputs/Vault.sol
+// GRAPH-NEXT: imports {{.*}}Inputs/Ownable.sol
+// GRAPH-NEXT: {{[0-9.]+}} 2 {{[0-9a-f]{8}}} {{.*}}Inputs/Token.sol
+// GRAPH-NEXT: imports {{.*}}Inputs/Ownable.sol
+// GRAPH-NEXT: {{[0-9.]+}} 3 {{[0-9a-f]{8}}} {{.*}}Inputs/Ownable.sol
+// GRAPH-NEXT: {{[0-9.]+}} 1 {{[0-9a-f]{8}}} {{.*}}Inputs/Vault.sol
+// GRAPH-NEXT: imports {{.*}}Inputs/Ownable.sol
+// GRAPH-NEXT: imports {{.*}}Inputs/Token.sol
+// GRAPH-NEXT: {{[0-9.]+}} 4 modules parsed once for 6 imports, 3 reused
+// GRAPH: File Manager Stats
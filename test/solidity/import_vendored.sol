@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// RUN: %soll -action=EmitFuncSig %s | FileCheck %s
+// RUN: %soll -action=EmitFuncSig -print-import-graph %s 2>&1 >/dev/null | FileCheck --check-prefix=GRAPH %s
+pragma solidity >0.4.0 <=0.7.0;
+
+// The two Lib.sol files are identical, but each imports the Base.sol next
+// to it, so they are parsed separately. The two Plain.sol files have no
+// relative imports and share one parse.
+import "./Inputs/vendor/a/Lib.sol";
+import "./Inputs/vendor/b/Lib.sol";
+import "./Inputs/vendor/a/Plain.sol";
+import "./Inputs/vendor/b/Plain.sol";
+
+contract User {
+  function g() public {}
+}
+// CHECK: fromA()
+// CHECK: fromB()
+// CHECK: plain()
+// CHECK-NOT: plain()
+// CHECK: g()
+
+// GRAPH: Import graph
+// GRAPH: imports {{.*}}vendor/a/Base.sol
+// GRAPH: imports {{.*}}vendor/b/Base.sol
+// GRAPH: {{[0-9.]+}} 6 modules parsed once for 6 imports, 1 reused
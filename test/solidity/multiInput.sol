@@ -0,0 +1,10 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// RUN: %soll -j2 -action=EmitFuncSig %s %S/cache.sol | FileCheck %s
+// Inputs compiled concurrently still print in input order.
+// CHECK: 26121ff0: f()
+// CHECK-NEXT: a9059cbb: transfer(address,uint256)
+pragma solidity >0.4.0 <=0.7.0;
+
+contract MULTIINPUT {
+  function f() public {}
+}
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// RUN: %soll --runtime -action=EmitLLVM - < %s | FileCheck %s
+pragma solidity >0.4.0 <=0.7.0;
+
+contract PACKEDSIGNED {
+  int8 small;
+  uint8 other;
+
+  function set(int8 v) public {
+    small = v;
+  }
+  function setMinusOne() public {
+    small = -1;
+  }
+  function setOther(uint8 w) public {
+    other = w;
+  }
+}
+// Packed values are cut to their own byte before they are merged into the
+// slot, so a negative int8 does not overwrite `other`.
+// CHECK-LABEL: define {{.*}}"{{[^"]*}}set(int8)"
+// CHECK: and i256 %{{[^,]+}}, 255
+// CHECK-LABEL: define {{.*}}"{{[^"]*}}setMinusOne()"
+// CHECK: or i256 %{{[^,]+}}, 255
+// CHECK-LABEL: define {{.*}}"{{[^"]*}}setOther(uint8)"
+// CHECK: [[W:%[^ ]+]] = and i256 %{{[^,]+}}, 255
+// CHECK-NEXT: shl i256 [[W]], 8
@@ -0,0 +1,11 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// RUN: printf '%%s\n' '{"id": 1, "actions": ["EmitFuncSig"], "sources": [{"name": "a.sol", "contents": "contract A { function f() public {} }"}]}' '{"id": 2, "sources": []' | %soll --server | FileCheck %s
+// CHECK: "id":1
+// CHECK-SAME: "contents":"26121ff0: f()\n"
+// CHECK-SAME: "name":"a.sol"
+// CHECK-SAME: "success":true
+// CHECK-SAME: "time_ms":
+// CHECK-NEXT: "success":false
+pragma solidity >0.4.0 <=0.7.0;
+
+contract SERVER {}
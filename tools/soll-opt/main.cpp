@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Runs soll's IR passes over an LLVM IR file, for testing them in isolation:
+//   soll-opt -passes=soll-storage-cache input.ll
+// The pipeline may mix soll passes with LLVM's own.
+#include "soll/CodeGen/CoalesceMemorySize.h"
+#include "soll/CodeGen/FoldHash.h"
+#include "soll/CodeGen/LowerSlotHash.h"
+#include "soll/CodeGen/LoweringInteger.h"
+#include "soll/CodeGen/NarrowInteger.h"
+#include "soll/CodeGen/SimplifyBswap.h"
+#include "soll/CodeGen/SimplifyExp.h"
+#include "soll/CodeGen/StorageCache.h"
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace soll;
+
+static llvm::cl::opt<std::string> InputFilename(llvm::cl::Positional,
+                                                llvm::cl::desc("<input file>"),
+                                                llvm::cl::init("-"));
+
+static llvm::cl::opt<std::string>
+    Passes("passes", llvm::cl::Required,
+           llvm::cl::desc("Pipeline of passes to run, as for opt -passes"));
+
+using PipelineElements =
+    llvm::ArrayRef<llvm::PassBuilder::PipelineElement>;
+
+static bool parseFunctionPass(llvm::StringRef Name,
+                              llvm::FunctionPassManager &FPM,
+                              PipelineElements) {
+  if (Name == "soll-fold-hash") {
+    FPM.addPass(FoldHash());
+  } else if (Name == "soll-storage-cache") {
+    FPM.addPass(StorageCache());
+  } else if (Name == "soll-simplify-bswap") {
+    FPM.addPass(SimplifyBswap(/*ExpandLimbs=*/true));
+  } else if (Name == "soll-simplify-exp") {
+    FPM.addPass(SimplifyExp());
+  } else if (Name == "soll-narrow-integer") {
+    FPM.addPass(NarrowInteger(/*Versioning=*/true));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool parseModulePass(llvm::StringRef Name, llvm::ModulePassManager &MPM,
+                            PipelineElements) {
+  if (Name == "soll-coalesce-memory-size") {
+    MPM.addPass(CoalesceMemorySize());
+  } else if (Name == "soll-lower-slot-hash") {
+    MPM.addPass(LowerSlotHash());
+  } else if (Name == "soll-lowering-integer") {
+    MPM.addPass(LoweringInteger());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  llvm::InitLLVM X(argc, argv);
+  llvm::cl::ParseCommandLineOptions(argc, argv, "soll IR pass driver\n");
+
+  llvm::LLVMContext Context;
+  llvm::SMDiagnostic Err;
+  std::unique_ptr<llvm::Module> M =
+      llvm::parseIRFile(InputFilename, Err, Context);
+  if (!M) {
+    Err.print(argv[0], llvm::errs());
+    return EXIT_FAILURE;
+  }
+
+  llvm::PassBuilder PB;
+  PB.registerPipelineParsingCallback(parseFunctionPass);
+  PB.registerPipelineParsingCallback(parseModulePass);
+  llvm::LoopAnalysisManager LAM;
+  llvm::FunctionAnalysisManager FAM;
+  llvm::CGSCCAnalysisManager CGAM;
+  llvm::ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  llvm::ModulePassManager MPM;
+  if (auto E = PB.parsePassPipeline(MPM, Passes)) {
+    llvm::errs() << argv[0] << ": " << llvm::toString(std::move(E)) << '\n';
+    return EXIT_FAILURE;
+  }
+  MPM.run(*M, MAM);
+
+  if (llvm::verifyModule(*M, &llvm::errs())) {
+    llvm::errs() << argv[0] << ": the passes produced invalid IR\n";
+    return EXIT_FAILURE;
+  }
+  M->print(llvm::outs(), nullptr);
+  return EXIT_SUCCESS;
+}
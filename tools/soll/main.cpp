@@ -5,6 +5,7 @@
 #include "soll/Frontend/TextDiagnosticPrinter.h"
 #include "soll/FrontendTool/Utils.h"
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/ManagedStatic.h>
 #include <llvm/Support/Process.h>
 #include <llvm/Support/TargetSelect.h>
 
@@ -14,6 +15,8 @@ int main(int argc, const char **argv) {
   if (llvm::sys::Process::FixupStandardFileDescriptors()) {
     return EXIT_FAILURE;
   }
+  // Flushes statistics requested with -stats on exit.
+  llvm::llvm_shutdown_obj Shutdown;
 
   llvm::SmallVector<const char *, 256> Args(argv, argv + argc);
   std::unique_ptr Soll = std::make_unique<CompilerInstance>();
@@ -31,6 +34,12 @@ int main(int argc, const char **argv) {
   llvm::InitializeAllAsmPrinters();
   llvm::InitializeAllAsmParsers();
 
+  if (Soll->getFrontendOpts().Server) {
+    return RunCompileServer(Soll->getFrontendOpts().ServerSocket)
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+  }
+
   if (!ExecuteCompilerInvocation(Soll.get())) {
     return EXIT_FAILURE;
   }
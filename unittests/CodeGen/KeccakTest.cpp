@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/CodeGenAction.h"
+#include "catch.hpp"
+#include "soll/Basic/CodeGenOptions.h"
+#include "soll/Basic/TargetOptions.h"
+#include "soll/Frontend/CompilerInstance.h"
+#include <algorithm>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Transforms/IPO.h>
+
+using namespace soll;
+
+namespace {
+
+/// Compiles a contract that hashes with the inline sponge and returns the
+/// emitted module.
+std::unique_ptr<llvm::Module> emitInlineKeccak(llvm::LLVMContext &Context) {
+  auto InputFile = llvm::sys::fs::TempFile::create("test-%%%%%%.sol");
+  REQUIRE(bool(InputFile));
+  {
+    llvm::raw_fd_ostream OS(InputFile->FD, /*shouldClose*/ false);
+    OS << "contract C {\n"
+          "  function f(bytes memory b) public pure returns (bytes32) {\n"
+          "    return keccak256(b);\n"
+          "  }\n"
+          "}\n";
+    OS.flush();
+  }
+  auto OutputFile = llvm::sys::fs::TempFile::create("test-%%%%%%.ll");
+  REQUIRE(bool(OutputFile));
+
+  CompilerInstance Compiler;
+  auto &Invocation = Compiler.getInvocation();
+  Invocation.getFrontendOpts().Inputs.push_back(
+      FrontendInputFile(InputFile->TmpName));
+  Invocation.getFrontendOpts().OutputFile = OutputFile->TmpName;
+  Invocation.getFrontendOpts().ProgramAction = EmitLLVM;
+  Invocation.getTargetOpts().BackendTarget = EWASM;
+  Invocation.getCodeGenOpts().OptimizationLevel = O0;
+  Invocation.getCodeGenOpts().Keccak = KeccakKind::Inline;
+  Compiler.createDiagnostics();
+  REQUIRE(Compiler.hasDiagnostics());
+
+  EmitLLVMAction Act;
+  REQUIRE(Compiler.ExecuteAction(Act));
+
+  llvm::SMDiagnostic Err;
+  std::unique_ptr<llvm::Module> Module =
+      llvm::parseIRFile(OutputFile->TmpName, Err, Context);
+  REQUIRE(Module);
+  llvm::consumeError(InputFile->discard());
+  llvm::consumeError(OutputFile->discard());
+  return Module;
+}
+
+/// Strips \p Module down to \p Root and the globals it reaches, so that
+/// nothing calls into the Ewasm host, and retargets it to the host machine.
+void extractForHost(llvm::Module &Module, llvm::Function *Root) {
+  llvm::SetVector<llvm::GlobalValue *> Keep;
+  Keep.insert(Root);
+  for (size_t I = 0; I < Keep.size(); ++I) {
+    auto *F = llvm::dyn_cast<llvm::Function>(Keep[I]);
+    if (!F) {
+      continue;
+    }
+    for (llvm::Instruction &Inst : llvm::instructions(F)) {
+      for (llvm::Value *Op : Inst.operands()) {
+        auto *GV = llvm::dyn_cast<llvm::GlobalValue>(Op->stripPointerCasts());
+        if (GV && !GV->isDeclaration()) {
+          Keep.insert(GV);
+        }
+      }
+    }
+  }
+
+  std::vector<llvm::GlobalValue *> GVs(Keep.begin(), Keep.end());
+  llvm::legacy::PassManager PM;
+  PM.add(llvm::createGVExtractionPass(GVs));
+  PM.add(llvm::createGlobalDCEPass());
+  PM.run(Module);
+
+  Module.setTargetTriple(llvm::sys::getProcessTriple());
+  Module.setDataLayout("");
+}
+
+/// Adds `void keccak_test(i8* ptr, i32 length, i256* digest)` around
+/// solidity.keccak256, which takes its input as a bytes value.
+void addTestEntry(llvm::Module &Module, llvm::Function *Keccak) {
+  llvm::LLVMContext &Context = Module.getContext();
+  llvm::IRBuilder<> Builder(Context);
+  llvm::Type *Int256Ty = Builder.getIntNTy(256);
+  auto *FT = llvm::FunctionType::get(
+      Builder.getVoidTy(),
+      {Builder.getInt8PtrTy(), Builder.getInt32Ty(), Int256Ty->getPointerTo()},
+      false);
+  auto *F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage,
+                                   "keccak_test", Module);
+  Builder.SetInsertPoint(llvm::BasicBlock::Create(Context, "entry", F));
+  llvm::Argument *Ptr = F->arg_begin();
+  llvm::Argument *Length = Ptr + 1;
+  llvm::Argument *Digest = Length + 1;
+  llvm::Type *BytesTy = Keccak->getFunctionType()->getParamType(0);
+  llvm::Value *Bytes = llvm::UndefValue::get(BytesTy);
+  Bytes =
+      Builder.CreateInsertValue(Bytes, Builder.CreateZExt(Length, Int256Ty), 0);
+  Bytes = Builder.CreateInsertValue(Bytes, Ptr, 1);
+  Builder.CreateAlignedStore(Builder.CreateCall(Keccak, {Bytes}), Digest,
+                             llvm::MaybeAlign(1));
+  Builder.CreateRetVoid();
+}
+
+TEST_CASE("TestInlineKeccakRateBoundaries", "[CodeGenTest]") {
+  // keccak256 of the bytes 0, 1, 2, ... of each length, around the
+  // 136-byte rate of the sponge.
+  static const std::pair<unsigned, const char *> Digests[] = {
+      {0, "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470"},
+      {135, "cbdfd9dee5faad3818d6b06f95a219fd290b0e1706f6a82e5a595b9ce9faca62"},
+      {136, "7ce759f1ab7f9ce437719970c26b0a66ff11fe3e38e17df89cf5d29c7d7f807e"},
+      {137, "ac73d4fae68b8453f764007c1a20ce95994187861f0c3227a3a8e99a73a3b1db"},
+      {272, "fdf2ec49e749960d3c8521a0219af8d03e30e2b3bf19bd16150ee0eaf133d66e"},
+  };
+
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  llvm::LLVMContext Context;
+  std::unique_ptr<llvm::Module> Module = emitInlineKeccak(Context);
+  llvm::Function *Keccak = Module->getFunction("solidity.keccak256");
+  REQUIRE(Keccak);
+  extractForHost(*Module, Keccak);
+  addTestEntry(*Module, Keccak);
+
+  std::string Error;
+  std::unique_ptr<llvm::ExecutionEngine> Engine(
+      llvm::EngineBuilder(std::move(Module))
+          .setEngineKind(llvm::EngineKind::JIT)
+          .setErrorStr(&Error)
+          .create());
+  INFO(Error);
+  REQUIRE(Engine);
+  using TestFn = void (*)(const uint8_t *, uint32_t, uint8_t *);
+  auto Test =
+      reinterpret_cast<TestFn>(Engine->getFunctionAddress("keccak_test"));
+  REQUIRE(Test);
+
+  for (const auto &[Length, Expected] : Digests) {
+    std::vector<uint8_t> Input(Length);
+    for (unsigned I = 0; I < Length; ++I) {
+      Input[I] = static_cast<uint8_t>(I);
+    }
+    // The digest is a big-endian number stored in host byte order.
+    uint8_t Digest[32];
+    Test(Input.data(), Length, Digest);
+    std::reverse(std::begin(Digest), std::end(Digest));
+    std::string Hex = llvm::toHex(
+        llvm::StringRef(reinterpret_cast<const char *>(Digest), 32),
+        /*LowerCase=*/true);
+    INFO("length " << Length);
+    CHECK(Hex == Expected);
+  }
+}
+
+} // namespace
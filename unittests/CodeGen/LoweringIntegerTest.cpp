@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/CodeGen/LoweringInteger.h"
+#include "catch.hpp"
+#include <cstring>
+#include <llvm/ADT/APInt.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetSelect.h>
+
+using namespace soll;
+
+namespace {
+
+/// Builds `void mul(i256* a, i256* b, i256* p)` and
+/// `void divrem(i256* a, i256* b, i256* q, i256* r)` around the plain i256
+/// operations, then lowers them onto the limb kernels.
+std::unique_ptr<llvm::Module> createLoweredModule(llvm::LLVMContext &Context) {
+  auto Module = std::make_unique<llvm::Module>("lowering", Context);
+  Module->setTargetTriple(llvm::sys::getProcessTriple());
+  llvm::IRBuilder<> Builder(Context);
+  llvm::Type *Int256Ty = Builder.getIntNTy(256);
+  llvm::Type *Int256PtrTy = Int256Ty->getPointerTo();
+
+  auto *MulFT = llvm::FunctionType::get(
+      Builder.getVoidTy(), {Int256PtrTy, Int256PtrTy, Int256PtrTy}, false);
+  auto *Mul = llvm::Function::Create(MulFT, llvm::Function::ExternalLinkage,
+                                     "mul", *Module);
+  Builder.SetInsertPoint(llvm::BasicBlock::Create(Context, "entry", Mul));
+  {
+    llvm::Argument *A = Mul->arg_begin();
+    llvm::Value *LHS = Builder.CreateLoad(Int256Ty, A);
+    llvm::Value *RHS = Builder.CreateLoad(Int256Ty, A + 1);
+    Builder.CreateStore(Builder.CreateMul(LHS, RHS), A + 2);
+    Builder.CreateRetVoid();
+  }
+
+  auto *DivRemFT = llvm::FunctionType::get(
+      Builder.getVoidTy(), {Int256PtrTy, Int256PtrTy, Int256PtrTy, Int256PtrTy},
+      false);
+  auto *DivRem = llvm::Function::Create(
+      DivRemFT, llvm::Function::ExternalLinkage, "divrem", *Module);
+  Builder.SetInsertPoint(llvm::BasicBlock::Create(Context, "entry", DivRem));
+  {
+    llvm::Argument *A = DivRem->arg_begin();
+    llvm::Value *LHS = Builder.CreateLoad(Int256Ty, A);
+    llvm::Value *RHS = Builder.CreateLoad(Int256Ty, A + 1);
+    Builder.CreateStore(Builder.CreateUDiv(LHS, RHS), A + 2);
+    Builder.CreateStore(Builder.CreateURem(LHS, RHS), A + 3);
+    Builder.CreateRetVoid();
+  }
+
+  llvm::ModuleAnalysisManager MAM;
+  LoweringInteger().run(*Module, MAM);
+  return Module;
+}
+
+/// Runs the lowered kernels on the host.
+class LoweredKernels {
+  std::unique_ptr<llvm::ExecutionEngine> Engine;
+  using MulFn = void (*)(const uint64_t *, const uint64_t *, uint64_t *);
+  using DivRemFn = void (*)(const uint64_t *, const uint64_t *, uint64_t *,
+                            uint64_t *);
+  MulFn MulPtr = nullptr;
+  DivRemFn DivRemPtr = nullptr;
+
+  static void store(const llvm::APInt &Value, uint64_t *Words) {
+    std::memcpy(Words, Value.getRawData(), 32);
+  }
+  static llvm::APInt load(const uint64_t *Words) {
+    return llvm::APInt(256, llvm::makeArrayRef(Words, 4));
+  }
+
+public:
+  LoweredKernels() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    static llvm::LLVMContext Context;
+    std::unique_ptr<llvm::Module> Module = createLoweredModule(Context);
+    REQUIRE(Module->getFunction("__mul256"));
+    REQUIRE(Module->getFunction("__udivrem256"));
+    std::string Error;
+    Engine.reset(llvm::EngineBuilder(std::move(Module))
+                     .setEngineKind(llvm::EngineKind::JIT)
+                     .setErrorStr(&Error)
+                     .create());
+    INFO(Error);
+    REQUIRE(Engine);
+    MulPtr = reinterpret_cast<MulFn>(Engine->getFunctionAddress("mul"));
+    DivRemPtr =
+        reinterpret_cast<DivRemFn>(Engine->getFunctionAddress("divrem"));
+    REQUIRE(MulPtr);
+    REQUIRE(DivRemPtr);
+  }
+
+  llvm::APInt mul(const llvm::APInt &LHS, const llvm::APInt &RHS) const {
+    uint64_t A[4], B[4], P[4];
+    store(LHS, A);
+    store(RHS, B);
+    MulPtr(A, B, P);
+    return load(P);
+  }
+
+  std::pair<llvm::APInt, llvm::APInt> divrem(const llvm::APInt &LHS,
+                                             const llvm::APInt &RHS) const {
+    uint64_t A[4], B[4], Q[4], R[4];
+    store(LHS, A);
+    store(RHS, B);
+    DivRemPtr(A, B, Q, R);
+    return {load(Q), load(R)};
+  }
+};
+
+llvm::APInt hex(llvm::StringRef Digits) { return llvm::APInt(256, Digits, 16); }
+
+void checkDivRem(const LoweredKernels &Kernels, llvm::StringRef Dividend,
+                 llvm::StringRef Divisor) {
+  const llvm::APInt U = hex(Dividend);
+  const llvm::APInt V = hex(Divisor);
+  auto [Q, R] = Kernels.divrem(U, V);
+  INFO(Dividend.str() << " / " << Divisor.str());
+  // Division by zero yields zero for both results, like the EVM.
+  CHECK(Q == (V.isNullValue() ? V : U.udiv(V)));
+  CHECK(R == (V.isNullValue() ? V : U.urem(V)));
+}
+
+TEST_CASE("TestMul256Carries", "[CodeGenTest]") {
+  LoweredKernels Kernels;
+  const char *Operands[][2] = {
+      // Every column carries into the next and the top limb wraps.
+      {"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+       "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"},
+      // (2^128 - 1)^2 fills all four limbs through the carry chain.
+      {"ffffffffffffffffffffffffffffffff", "ffffffffffffffffffffffffffffffff"},
+      {"ffffffffffffffff0000000000000001", "ffffffffffffffffffffffffffffffff"},
+      // The carry out of the middle word comes from adding the carry out of
+      // the low word.
+      {"2ffffffffffffffff", "ffffffffffffffffffffffffffffffff"},
+      {"123456789abcdef0fedcba9876543210"
+       "0f1e2d3c4b5a69788796a5b4c3d2e1f0",
+       "fedcba98765432100123456789abcdef"
+       "8000000000000001ffffffffffffffff"},
+  };
+  for (const auto &[LHS, RHS] : Operands) {
+    INFO(LHS << " * " << RHS);
+    CHECK(Kernels.mul(hex(LHS), hex(RHS)) == hex(LHS) * hex(RHS));
+    CHECK(Kernels.mul(hex(RHS), hex(LHS)) == hex(LHS) * hex(RHS));
+  }
+}
+
+TEST_CASE("TestUDivRem256SingleLimbDivisor", "[CodeGenTest]") {
+  LoweredKernels Kernels;
+  // A single 32-bit digit takes the short division loop.
+  checkDivRem(Kernels,
+              "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+              "fffffffb");
+  checkDivRem(Kernels, "8000000000000000000000000000000000000000000000000000",
+              "3");
+  // A divisor in a single 64-bit limb still goes through algorithm D.
+  checkDivRem(Kernels,
+              "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+              "80000000ffffffff");
+  checkDivRem(Kernels, "10000000000000000000000000000000000000000000000000",
+              "100000001");
+}
+
+TEST_CASE("TestUDivRem256QuotientCorrection", "[CodeGenTest]") {
+  LoweredKernels Kernels;
+  // The first estimate of a quotient digit is two too large.
+  checkDivRem(Kernels, "ffffffff7fffffff00000001fffffffe", "80000000ffffffff");
+  // The estimate survives the two-digit test and the divisor is added back.
+  checkDivRem(Kernels, "fffffffe000000017fffffff00000000",
+              "1fffffffe00000001");
+  checkDivRem(Kernels, "800000007fffffffffffffff80000000",
+              "ffffffff00000001ffffffff");
+}
+
+TEST_CASE("TestUDivRem256SmallDividend", "[CodeGenTest]") {
+  LoweredKernels Kernels;
+  checkDivRem(Kernels, "ffffffffffffffffffffffffffffffff",
+              "100000000000000000000000000000000");
+  checkDivRem(Kernels, "0", "100000000000000000");
+  checkDivRem(Kernels, "fffffffffffffffffffffffffffffffffffffffffffffffe",
+              "ffffffffffffffffffffffffffffffffffffffffffffffff");
+  checkDivRem(Kernels, "100000000000000000000", "0");
+}
+
+} // namespace
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#include "soll/Lex/Lexer.h"
+#include "catch.hpp"
+#include "soll/Basic/CharInfo.h"
+#include "soll/Basic/CharScan.h"
+#include "soll/Basic/Diagnostic.h"
+#include "soll/Basic/DiagnosticOptions.h"
+#include "soll/Basic/FileManager.h"
+#include "soll/Basic/FileSystemOptions.h"
+#include "soll/Basic/SourceManager.h"
+#include "soll/Lex/TokenStream.h"
+#include <chrono>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+#include <random>
+#include <string>
+
+using namespace soll;
+
+namespace {
+
+/// A contract documented the way audited ones are, with about half of its
+/// bytes in NatSpec comments.
+const char *const NatSpecContract = R"(
+/// @title A token with a capped supply
+/// @author The soll developers
+/// @notice Holders can transfer tokens to each other and approve spenders
+///         to transfer on their behalf, up to an allowance.
+/// @dev Balances and allowances follow the ERC20 standard, see
+///      https://eips.ethereum.org/EIPS/eip-20 for the full interface.
+contract CappedToken {
+    /// @notice Balance of every holder.
+    mapping(address => uint256) public balanceOf;
+    /// @notice Remaining amount a spender may transfer for an owner.
+    mapping(address => mapping(address => uint256)) public allowance;
+    uint256 public totalSupply;
+    uint256 public constant cap = 1000000000000000000000000;
+
+    /**
+     * @notice Emitted when `value` tokens move from `from` to `to`.
+     * @param from  The account the tokens are taken from.
+     * @param to    The account the tokens are given to.
+     * @param value The amount of tokens moved, which may be zero.
+     */
+    event Transfer(address indexed from, address indexed to, uint256 value);
+
+    /**
+     * @notice Moves `value` tokens from the caller to `to`.
+     * @dev Reverts if the caller holds fewer than `value` tokens.
+     * @param to    The account receiving the tokens.
+     * @param value The amount of tokens to move.
+     * @return success Always true, as failures revert.
+     */
+    function transfer(address to, uint256 value) public returns (bool success) {
+        require(balanceOf[msg.sender] >= value, "insufficient balance");
+        balanceOf[msg.sender] -= value; // cannot underflow
+        balanceOf[to] += value;
+        emit Transfer(msg.sender, to, value);
+        return true;
+    }
+
+    /// @notice Creates `value` tokens for `to`, up to the cap.
+    /// @param to The account receiving the new tokens.
+    /// @param value The amount of tokens to create.
+    function mint(address to, uint256 value) internal {
+        require(totalSupply + value <= cap, "cap exceeded");
+        totalSupply += value;
+        balanceOf[to] += value;
+        emit Transfer(address(0), to, value);
+    }
+}
+)";
+
+/// A lexer over \p Source, with the managers it needs.
+class TestLexer {
+  DiagnosticsEngine Diags;
+  FileManager FileMgr;
+  SourceManager SourceMgr;
+
+public:
+  Lexer L;
+
+  explicit TestLexer(const std::string &Source)
+      : Diags(new DiagnosticIDs(), new DiagnosticOptions()),
+        FileMgr(FileSystemOptions()), SourceMgr(Diags, FileMgr),
+        L(SourceLocation(), Source.data(), Source.data(),
+          Source.data() + Source.size(), SourceMgr) {
+    L.Initialize();
+  }
+};
+
+size_t countTokens(const std::string &Source) {
+  TestLexer Lex(Source);
+  size_t Tokens = 0;
+  for (auto Tok = Lex.L.CachedLex(); Tok && Tok->isNot(tok::eof);
+       Tok = Lex.L.CachedLex()) {
+    ++Tokens;
+  }
+  return Tokens;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point Start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       Start)
+      .count();
+}
+
+} // namespace
+
+TEST_CASE("CharScanAgreesWithCharInfo", "[LexerTest]") {
+  std::mt19937 Random(2020);
+  // Mostly characters the scanners stop at, so runs end everywhere within
+  // the 16 and 32 byte blocks.
+  const std::string Alphabet = "aZ_$09 \t\n\r\v\f/*\\\"\x80\xff";
+  std::uniform_int_distribution<size_t> Pick(0, Alphabet.size() - 1);
+  std::uniform_int_distribution<int> Byte(0, 255);
+  for (size_t Size = 0; Size < 200; ++Size) {
+    std::string Buffer(Size, '\0');
+    for (char &C : Buffer) {
+      C = Random() % 4 ? Alphabet[Pick(Random)] : char(Byte(Random));
+    }
+    const char *Begin = Buffer.data();
+    const char *End = Begin + Size;
+    for (const char *Ptr = Begin; Ptr <= End; ++Ptr) {
+      const char *Identifier = Ptr;
+      while (Identifier != End && isIdentifierBody(*Identifier)) {
+        ++Identifier;
+      }
+      const char *Whitespace = Ptr;
+      while (Whitespace != End && isWhitespace(*Whitespace)) {
+        ++Whitespace;
+      }
+      const char *LineEnd = Ptr;
+      while (LineEnd != End && *LineEnd != '\n' && *LineEnd != '\r' &&
+             *LineEnd != '\0') {
+        ++LineEnd;
+      }
+      const char *Slash = Ptr;
+      while (Slash != End && *Slash != '/') {
+        ++Slash;
+      }
+      REQUIRE(skipIdentifierBody(Ptr, End) == Identifier);
+      REQUIRE(skipWhitespace(Ptr, End) == Whitespace);
+      REQUIRE(findLineEnd(Ptr, End) == LineEnd);
+      REQUIRE(findSlash(Ptr, End) == Slash);
+    }
+  }
+}
+
+TEST_CASE("LexerThroughput", "[LexerTest]") {
+  const std::string Contract = NatSpecContract;
+  const size_t Copies = (16 << 20) / Contract.size() + 1;
+  std::string Corpus;
+  Corpus.reserve(Contract.size() * Copies);
+  for (size_t I = 0; I < Copies; ++I) {
+    Corpus += Contract;
+  }
+
+  const size_t TokensPerCopy = countTokens(Contract);
+  auto Start = std::chrono::steady_clock::now();
+  const size_t Tokens = countTokens(Corpus);
+  const double Elapsed = secondsSince(Start);
+  REQUIRE(Tokens == TokensPerCopy * Copies);
+
+  TestLexer Lex(Corpus);
+  Start = std::chrono::steady_clock::now();
+  const TokenStream &Stream = Lex.L.lexAll();
+  const double StreamElapsed = secondsSince(Start);
+  REQUIRE(Stream.size() == Tokens + 1);
+
+  const double MB = Corpus.size() / 1e6;
+  llvm::outs() << llvm::format("Lexed %.1f MB, %zu tokens, in %.3f s: "
+                               "%.1f MB/s with %s scanners, "
+                               "%.1f MB/s into a token stream\n",
+                               MB, Tokens, Elapsed, MB / Elapsed,
+                               getCharScanKind(), MB / StreamElapsed);
+}
+
+TEST_CASE("TokenStreamMatchesLexer", "[LexerTest]") {
+  const std::string Contract = NatSpecContract;
+  TestLexer Expected(Contract);
+  TestLexer Actual(Contract);
+  // Tokens cached for lookahead are part of the stream.
+  REQUIRE(Actual.L.LookAhead(2));
+  const TokenStream &Stream = Actual.L.lexAll();
+  REQUIRE(Actual.L.getTokenStream() == &Stream);
+
+  size_t I = 0;
+  for (auto Tok = Expected.L.CachedLex(); Tok; Tok = Expected.L.CachedLex()) {
+    const Token Read = Stream[I];
+    REQUIRE(Stream.getKind(I) == Tok->getKind());
+    REQUIRE(Read.getKind() == Tok->getKind());
+    REQUIRE(Read.getLocation() == Tok->getLocation());
+    REQUIRE(Read.getLength() == Tok->getLength());
+    if (Tok->isLiteral()) {
+      REQUIRE(Read.getLiteralData() == Tok->getLiteralData());
+    } else if (Tok->isAnyIdentifier()) {
+      REQUIRE(Read.getIdentifierInfo()->getName() ==
+              Tok->getIdentifierInfo()->getName());
+    }
+    ++I;
+    if (Tok->is(tok::eof)) {
+      break;
+    }
+  }
+  REQUIRE(I == Stream.size());
+  // Reads past the end stay at eof.
+  REQUIRE(Stream[I + 10].is(tok::eof));
+}